@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""
+Expansor del registro diferido (dlog) de los nodos.
+
+Lee lo que se capturo de la uart (en binario) y reemplaza cada registro
+por el texto de su formato, tomado de dlog_formatos.h del proyecto. Los
+bytes que no forman parte de un registro (texto de PRINTF) se copian tal
+cual, por lo que se puede capturar la consola completa.
+
+Formato de cada registro:
+
+    0xA5 <formato> <largo> <argumentos...> <checksum>
+
+Los argumentos son enteros de 32 bits codificados de a 7 bits (el bit 7
+indica que sigue otro byte). El checksum es el complemento de la suma de
+los bytes desde <formato>. Un registro con checksum invalido (por ejemplo
+porque un PRINTF se intercalo en el medio) se descarta y se cuenta.
+
+Uso:
+    dlog_expand.py --formatos ../Nodo2_Qp/source/dlog_formatos.h captura.bin
+    dlog_expand.py --formatos dlog_formatos.h --puerto /dev/ttyACM0
+
+El modo --puerto lee el dispositivo serie directamente (ya configurado,
+por ejemplo con 'stty -F /dev/ttyACM0 115200 raw').
+
+Solo usa la biblioteca estandar de python.
+"""
+
+import argparse
+import re
+import sys
+
+SYNC = 0xA5
+CABECERA = 3            # sincronismo, formato y largo
+MAX_ARGS = 10
+MAX_PAYLOAD = MAX_ARGS * 5
+
+# El formato 0 lo genera dlog.c cuando descarta registros
+FORMATO_PERDIDOS = ("DLOG_PERDIDOS", "dlog: %u registros descartados")
+
+RE_ENTRADA = re.compile(r'X\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+RE_ESPECIFICADOR = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(?:l|ll|h|hh)?([diuxXc%])")
+
+
+def leer_formatos(ruta):
+    """Devuelve la lista de (nombre, texto) en el orden de la tabla."""
+    with open(ruta, errors="replace") as f:
+        contenido = f.read()
+
+    formatos = [FORMATO_PERDIDOS]
+    for nombre, texto in RE_ENTRADA.findall(contenido):
+        texto = bytes(texto, "ascii", "replace").decode("unicode_escape")
+        formatos.append((nombre, texto))
+
+    if len(formatos) == 1:
+        raise ValueError("%s no tiene entradas X(...)" % ruta)
+
+    return formatos
+
+
+def decodificar_args(payload):
+    """Separa los enteros codificados de a 7 bits. None si estan cortados."""
+    args = []
+    valor = 0
+    desplazamiento = 0
+
+    for b in payload:
+        valor |= (b & 0x7F) << desplazamiento
+        if b & 0x80:
+            desplazamiento += 7
+            if desplazamiento > 28:
+                return None
+            continue
+        args.append(valor & 0xFFFFFFFF)
+        valor = 0
+        desplazamiento = 0
+
+    if desplazamiento:
+        return None
+
+    return args
+
+
+def formatear(texto, args):
+    """Aplica los argumentos al formato respetando el signo de %d/%i."""
+    restantes = list(args)
+
+    def reemplazo(m):
+        flags, conv = m.group(1), m.group(2)
+        if conv == "%":
+            return "%"
+        valor = restantes.pop(0) if restantes else 0
+        if conv in "di" and valor & 0x80000000:
+            valor -= 1 << 32
+        if conv in "diu":
+            conv = "d"
+        return ("%" + flags + conv) % valor
+
+    return RE_ESPECIFICADOR.sub(reemplazo, texto)
+
+
+class Expansor:
+    """Maquina de estados que separa registros del texto plano."""
+
+    def __init__(self, formatos, salida):
+        self.formatos = formatos
+        self.salida = salida
+        self.pendiente = bytearray()
+        self.registros = 0
+        self.invalidos = 0
+
+    def texto(self, datos):
+        if datos:
+            self.salida.write(datos.decode("ascii", "replace"))
+
+    def registro(self, formato, args):
+        self.registros += 1
+        if formato < len(self.formatos):
+            nombre, texto = self.formatos[formato]
+            linea = formatear(texto, args)
+        else:
+            linea = "<formato %d desconocido> %s" % (
+                formato, " ".join(str(a) for a in args))
+        self.salida.write("\n[dlog] %s\n" % linea)
+
+    def procesar(self, datos, final=False):
+        buf = self.pendiente + datos
+        i = 0
+
+        while i < len(buf):
+            j = buf.find(SYNC, i)
+            if j < 0:
+                self.texto(bytes(buf[i:]))
+                i = len(buf)
+                break
+
+            self.texto(bytes(buf[i:j]))
+            i = j
+
+            if len(buf) - i < CABECERA:
+                break
+            largo = buf[i + 2]
+            if largo > MAX_PAYLOAD:
+                # No es un registro: el byte se toma como texto
+                self.texto(bytes(buf[i:i + 1]))
+                i += 1
+                continue
+            if len(buf) - i < CABECERA + largo + 1:
+                break
+
+            cuerpo = buf[i + 1:i + CABECERA + largo]
+            checksum = buf[i + CABECERA + largo]
+            args = decodificar_args(cuerpo[2:])
+
+            if (~sum(cuerpo)) & 0xFF != checksum or args is None:
+                self.invalidos += 1
+                i += 1
+                continue
+
+            self.registro(cuerpo[0], args)
+            i += CABECERA + largo + 1
+
+        self.pendiente = buf[i:]
+        if final:
+            self.texto(bytes(self.pendiente))
+            self.pendiente = bytearray()
+        self.salida.flush()
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(
+        description="Expande a texto el registro diferido de los nodos.")
+    parser.add_argument("--formatos", required=True,
+                        help="dlog_formatos.h del proyecto")
+    fuente = parser.add_mutually_exclusive_group(required=True)
+    fuente.add_argument("--puerto", help="dispositivo serie a leer")
+    fuente.add_argument("captura", nargs="?",
+                        help="archivo binario capturado de la uart")
+    args = parser.parse_args(argv)
+
+    expansor = Expansor(leer_formatos(args.formatos), sys.stdout)
+
+    if args.puerto:
+        with open(args.puerto, "rb", buffering=0) as f:
+            try:
+                while True:
+                    datos = f.read(256)
+                    if not datos:
+                        break
+                    expansor.procesar(datos)
+            except KeyboardInterrupt:
+                pass
+    else:
+        with open(args.captura, "rb") as f:
+            expansor.procesar(f.read())
+
+    expansor.procesar(b"", final=True)
+
+    print("\nRegistros: %d  Invalidos: %d" % (expansor.registros,
+                                              expansor.invalidos),
+          file=sys.stderr)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
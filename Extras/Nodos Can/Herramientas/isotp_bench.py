@@ -0,0 +1,251 @@
+#!/usr/bin/env python3
+"""
+Modelo del bus CAN para medir el rendimiento del transporte ISO-TP.
+
+Simula en la pc una transferencia de isotp_send() a isotp_receive()
+(isotp.h en Nodo1_Freertos) entre dos nodos y calcula cuanto tarda y
+cuantos bytes por segundo se obtienen, para varias velocidades del bus y
+tamaños de bloque (BS).
+
+Cada trama se arma bit a bit como la transmite el controlador (SOF, id de
+11 bits, control, datos y CRC de 15 bits) y se le agregan los bits de
+relleno que corresponden a esos datos, mas delimitadores, ACK, EOF y el
+espacio entre tramas. Sobre eso se modela:
+
+  * el tiempo de software del emisor para armar y encolar cada trama
+    (--tx-sw) y los 3 buffers de transmision del mcp2515, con los que el
+    emisor adelanta tramas mientras el bus esta ocupado.
+  * el tiempo del receptor desde que termina la ultima trama de un bloque
+    hasta que encola el control de flujo (--rx-sw).
+  * la separacion STmin entre consecutivas, redondeada a ticks como en
+    isotp_send().
+
+Uso:
+    isotp_bench.py
+    isotp_bench.py --largo 4095 --bitrate 125 500 --bloques 0 2 4 8
+
+Los bloques fuera de 1..ISOTP_BLOQUE_MAX (0 sin limite o mayores) no los
+anuncia el firmware: se marcan con '*' como hipoteticos.
+    isotp_bench.py --stmin 1 --tick 1000 --rx-sw 300
+
+Solo usa la biblioteca estandar de python.
+"""
+
+import argparse
+import random
+import sys
+
+# Bits fijos despues del CRC: delimitador, ACK y su delimitador, EOF y el
+# espacio entre tramas (no llevan relleno)
+BITS_COLA = 1 + 2 + 7 + 3
+
+BUFFERS_TX = 3
+
+DATOS_SIMPLE = 7
+DATOS_PRIMERA = 6
+DATOS_CONSECUTIVA = 7
+
+RELLENO = 0xCC
+
+# Bloque maximo que anuncia el firmware (ISOTP_BLOQUE_MAX en isotp.h): la
+# cola de la subscripcion tiene 5 lugares. BS 0 o mayores son hipoteticos.
+ISOTP_BLOQUE_MAX = 5
+
+
+def crc15(bits):
+    """CRC de 15 bits de CAN (polinomio 0x4599)."""
+    crc = 0
+    for b in bits:
+        sale = ((crc >> 14) & 1) ^ b
+        crc = (crc << 1) & 0x7FFF
+        if sale:
+            crc ^= 0x4599
+    return crc
+
+
+def a_bits(valor, cantidad):
+    return [(valor >> i) & 1 for i in range(cantidad - 1, -1, -1)]
+
+
+def bits_trama(ident, datos):
+    """Bits en el bus de una trama de datos estandar, con relleno."""
+    bits = [0] + a_bits(ident, 11) + [0, 0, 0] + a_bits(len(datos), 4)
+    for d in datos:
+        bits += a_bits(d, 8)
+    bits += a_bits(crc15(bits), 15)
+
+    # Despues de 5 bits iguales se inserta uno opuesto, que tambien cuenta
+    rellenos = 0
+    anterior = None
+    iguales = 0
+    for b in bits:
+        if b == anterior:
+            iguales += 1
+        else:
+            anterior = b
+            iguales = 1
+        if iguales == 5:
+            rellenos += 1
+            anterior = 1 - b
+            iguales = 1
+
+    return len(bits) + rellenos + BITS_COLA
+
+
+def tramas_isotp(mensaje):
+    """Tramas de datos (8 bytes con relleno) que manda el emisor."""
+    largo = len(mensaje)
+    if largo <= DATOS_SIMPLE:
+        return [bytes([largo]) + mensaje.ljust(7, bytes([RELLENO]))]
+
+    tramas = [bytes([0x10 | (largo >> 8), largo & 0xFF]) + mensaje[:DATOS_PRIMERA]]
+    secuencia = 1
+    for i in range(DATOS_PRIMERA, largo, DATOS_CONSECUTIVA):
+        parte = mensaje[i:i + DATOS_CONSECUTIVA].ljust(7, bytes([RELLENO]))
+        tramas.append(bytes([0x20 | secuencia]) + parte)
+        secuencia = (secuencia + 1) & 0x0F
+    return tramas
+
+
+def stmin_us(stmin, tick_hz):
+    """STmin de la norma a microsegundos, redondeado a ticks."""
+    if stmin <= 0x7F:
+        us = stmin * 1000
+    elif 0xF1 <= stmin <= 0xF9:
+        us = (stmin - 0xF0) * 100
+    else:
+        us = 127000
+    ticks = -(-us * tick_hz // 1000000)
+    return ticks * 1000000 / tick_hz
+
+
+class Bus:
+    """Bus con un solo emisor por vez: las tramas se serializan."""
+
+    def __init__(self, bitrate):
+        self.bit_us = 1e6 / bitrate
+        self.libre = 0.0
+        self.ocupado = 0.0
+        self.bits = 0
+
+    def transmitir(self, encolada, bits):
+        """Devuelve (inicio, fin) de una trama encolada en el instante dado."""
+        inicio = max(encolada, self.libre)
+        duracion = bits * self.bit_us
+        self.libre = inicio + duracion
+        self.ocupado += duracion
+        self.bits += bits
+        return inicio, self.libre
+
+
+def simular(mensaje, bitrate, bloque, stmin, tick_hz, tx_sw, rx_sw,
+            id_tx=0x700, id_rx=0x708):
+    """Simula una transferencia y devuelve un diccionario con los resultados."""
+    bus = Bus(bitrate)
+    tramas = tramas_isotp(mensaje)
+    fc = bytes([0x30, bloque, stmin]) + bytes([RELLENO] * 5)
+    bits_fc = bits_trama(id_rx, fc)
+    separacion = stmin_us(stmin, tick_hz)
+
+    cpu = 0.0           # proxima vez que el emisor puede encolar
+    finales = []        # fin en el bus de las tramas encoladas por el emisor
+    controles = 0
+    enviadas = 0
+    en_bloque = None    # consecutivas que faltan hasta el proximo control
+
+    for i, datos in enumerate(tramas):
+        encolada = cpu + tx_sw
+        # Con los buffers del mcp2515 llenos se espera a que salga una trama
+        if len(finales) >= BUFFERS_TX and finales[-BUFFERS_TX] > encolada:
+            encolada = finales[-BUFFERS_TX]
+        _, fin = bus.transmitir(encolada, bits_trama(id_tx, datos))
+        finales.append(fin)
+        enviadas += 1
+        cpu = encolada + (separacion if i > 0 else 0.0)
+
+        ultima = i == len(tramas) - 1
+        if i == 0:
+            en_bloque = 0
+        else:
+            en_bloque -= 1
+
+        # Despues de la primera o de cada bloque completo el receptor
+        # contesta y el emisor espera el control de flujo
+        if not ultima and en_bloque == 0:
+            _, fin_fc = bus.transmitir(fin + rx_sw, bits_fc)
+            controles += 1
+            cpu = fin_fc
+            en_bloque = bloque if bloque else len(tramas)
+
+    total_us = bus.libre
+    return {
+        "tramas": enviadas,
+        "controles": controles,
+        "bits": bus.bits,
+        "tiempo_ms": total_us / 1000.0,
+        "bytes_s": len(mensaje) / (total_us / 1e6),
+        "uso": bus.ocupado / total_us,
+        "eficiencia": len(mensaje) * 8 / bus.bits,
+    }
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(
+        description="Rendimiento de ISO-TP sobre un modelo del bus CAN")
+    parser.add_argument("--largo", type=int, default=4095,
+                        help="bytes del mensaje (maximo 4095)")
+    parser.add_argument("--bitrate", type=int, nargs="+", default=[125, 500],
+                        help="velocidades del bus [kbps]")
+    parser.add_argument("--bloques", type=int, nargs="+",
+                        default=list(range(1, ISOTP_BLOQUE_MAX + 1)),
+                        help="tamaños de bloque BS a comparar (0 sin limite, "
+                             "fuera de 1..%d hipoteticos)" % ISOTP_BLOQUE_MAX)
+    parser.add_argument("--stmin", type=lambda v: int(v, 0), default=0,
+                        help="STmin codificado como en la norma (0x00-0x7F ms, 0xF1-0xF9)")
+    parser.add_argument("--tick", type=int, default=1000,
+                        help="configTICK_RATE_HZ del emisor")
+    parser.add_argument("--tx-sw", type=float, default=60.0,
+                        help="software del emisor por trama [us]")
+    parser.add_argument("--rx-sw", type=float, default=150.0,
+                        help="del fin de un bloque al control de flujo [us]")
+    parser.add_argument("--ceros", action="store_true",
+                        help="mensaje de ceros (mas relleno) en lugar de aleatorio")
+    parser.add_argument("--semilla", type=int, default=1)
+    args = parser.parse_args(argv)
+
+    if not 1 <= args.largo <= 4095:
+        parser.error("el largo debe estar entre 1 y 4095")
+
+    if args.ceros:
+        mensaje = bytes(args.largo)
+    else:
+        azar = random.Random(args.semilla)
+        mensaje = bytes(azar.randrange(256) for _ in range(args.largo))
+
+    print("Mensaje de %d bytes, STmin 0x%02X, tx %.0f us, rx %.0f us"
+          % (args.largo, args.stmin, args.tx_sw, args.rx_sw))
+
+    for kbps in args.bitrate:
+        print()
+        print("%d kbps" % kbps)
+        print("%4s %7s %6s %10s %10s %7s %11s"
+              % ("BS", "tramas", "FC", "tiempo ms", "bytes/s", "uso", "eficiencia"))
+        for bloque in args.bloques:
+            r = simular(mensaje, kbps * 1000, bloque, args.stmin, args.tick,
+                        args.tx_sw, args.rx_sw)
+            hipotetico = not 1 <= bloque <= ISOTP_BLOQUE_MAX
+            print("%4s %7d %6d %10.1f %10.0f %6.1f%% %10.1f%%%s"
+                  % (bloque if bloque else "-", r["tramas"], r["controles"],
+                     r["tiempo_ms"], r["bytes_s"], r["uso"] * 100,
+                     r["eficiencia"] * 100, " *" if hipotetico else ""))
+
+    if any(not 1 <= b <= ISOTP_BLOQUE_MAX for b in args.bloques):
+        print()
+        print("* hipotetico: el firmware anuncia BS de 1 a %d"
+              % ISOTP_BLOQUE_MAX)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
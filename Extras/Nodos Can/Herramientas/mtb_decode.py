@@ -0,0 +1,275 @@
+#!/usr/bin/env python3
+"""
+Decodificador de trazas del Micro Trace Buffer (MTB) del Cortex-M0+.
+
+Lee el volcado que imprime mtb_trace_dump() por la consola y lo cruza con
+la tabla de simbolos del elf para obtener:
+
+  * un perfil plano: instrucciones estimadas y entradas por funcion.
+  * los caminos de llamadas mas calientes.
+
+Cada paquete del MTB tiene la direccion de origen y de destino de un salto.
+Entre el destino de un paquete y el origen del siguiente la ejecucion es
+secuencial, por lo que la cantidad de instrucciones se estima como
+(fin - inicio) / 2 + 1 (thumb, instrucciones de 16 bits en su mayoria).
+
+Uso:
+    mtb_decode.py --elf Nodo1_Freertos.axf captura.txt
+    mtb_decode.py --nm simbolos.nm captura.txt
+
+El archivo de simbolos para --nm se genera con:
+    arm-none-eabi-nm -S --defined-only Nodo1_Freertos.axf > simbolos.nm
+
+Solo usa la biblioteca estandar de python, por lo que puede correrse en
+linux sin la placa a partir de volcados guardados.
+"""
+
+import argparse
+import bisect
+import re
+import struct
+import sys
+from collections import Counter
+
+SHT_SYMTAB = 2
+STT_FUNC = 2
+
+RE_INICIO = re.compile(r"MTB INICIO\s+(\d+)")
+RE_PAQUETE = re.compile(r"^\s*([0-9a-fA-F]{8})\s+([0-9a-fA-F]{8})\s*$")
+RE_FIN = re.compile(r"MTB FIN")
+
+
+class Simbolos:
+    """Tabla de funciones ordenada por direccion."""
+
+    def __init__(self, funciones):
+        # funciones: lista de (direccion, tamaño, nombre)
+        funciones = sorted(set(funciones))
+        self.inicios = [f[0] for f in funciones]
+        self.funciones = funciones
+        self.por_inicio = {f[0]: f[2] for f in funciones}
+
+    def buscar(self, direccion):
+        """Devuelve (nombre, inicio) de la funcion que contiene la direccion."""
+        i = bisect.bisect_right(self.inicios, direccion) - 1
+        if i < 0:
+            return ("?%08x" % direccion, None)
+        inicio, tam, nombre = self.funciones[i]
+        if tam and direccion >= inicio + tam:
+            return ("?%08x" % direccion, None)
+        return (nombre, inicio)
+
+    def es_inicio(self, direccion):
+        return direccion in self.por_inicio
+
+
+def leer_elf(ruta):
+    """Lee los simbolos de tipo funcion de un elf de 32 o 64 bits."""
+    with open(ruta, "rb") as f:
+        datos = f.read()
+
+    if datos[:4] != b"\x7fELF":
+        raise ValueError("%s no es un archivo elf" % ruta)
+
+    clase = datos[4]
+    orden = "<" if datos[5] == 1 else ">"
+
+    if clase == 1:
+        e_shoff, = struct.unpack_from(orden + "I", datos, 0x20)
+        e_shentsize, e_shnum = struct.unpack_from(orden + "HH", datos, 0x2E)
+        fmt_sh = orden + "IIIIIIIIII"
+    elif clase == 2:
+        e_shoff, = struct.unpack_from(orden + "Q", datos, 0x28)
+        e_shentsize, e_shnum = struct.unpack_from(orden + "HH", datos, 0x3A)
+        fmt_sh = orden + "IIQQQQIIQQ"
+    else:
+        raise ValueError("clase de elf desconocida: %d" % clase)
+
+    secciones = []
+    for i in range(e_shnum):
+        sh = struct.unpack_from(fmt_sh, datos, e_shoff + i * e_shentsize)
+        # name, type, flags, addr, offset, size, link, info, addralign, entsize
+        secciones.append(sh)
+
+    funciones = []
+    for sh in secciones:
+        if sh[1] != SHT_SYMTAB:
+            continue
+        offset, tam, link, entsize = sh[4], sh[5], sh[6], sh[9]
+        strtab = secciones[link]
+        str_off = strtab[4]
+
+        for n in range(tam // entsize):
+            base = offset + n * entsize
+            if clase == 1:
+                st_name, st_value, st_size, st_info = struct.unpack_from(
+                    orden + "IIIB", datos, base)
+            else:
+                st_name, st_info = struct.unpack_from(orden + "IB", datos, base)
+                st_value, st_size = struct.unpack_from(orden + "QQ", datos,
+                                                       base + 8)
+            if (st_info & 0xF) != STT_FUNC or st_value == 0:
+                continue
+            fin = datos.index(b"\0", str_off + st_name)
+            nombre = datos[str_off + st_name:fin].decode("ascii", "replace")
+            # El bit 0 indica thumb, no forma parte de la direccion
+            funciones.append((st_value & ~1, st_size, nombre))
+
+    if not funciones:
+        raise ValueError("%s no tiene tabla de simbolos" % ruta)
+
+    return Simbolos(funciones)
+
+
+def leer_nm(ruta):
+    """Lee la salida de 'nm -S --defined-only'."""
+    funciones = []
+    with open(ruta) as f:
+        for linea in f:
+            campos = linea.split()
+            if len(campos) == 4 and campos[2] in "tTwW":
+                funciones.append((int(campos[0], 16) & ~1, int(campos[1], 16),
+                                  campos[3]))
+            elif len(campos) == 3 and campos[1] in "tTwW":
+                funciones.append((int(campos[0], 16) & ~1, 0, campos[2]))
+    return Simbolos(funciones)
+
+
+def leer_capturas(lineas):
+    """Separa las capturas del volcado. Ignora el resto del texto."""
+    capturas = []
+    actual = None
+
+    for linea in lineas:
+        if RE_INICIO.search(linea):
+            actual = []
+            continue
+        if actual is None:
+            continue
+        if RE_FIN.search(linea):
+            capturas.append(actual)
+            actual = None
+            continue
+        m = RE_PAQUETE.match(linea)
+        if m:
+            actual.append((int(m.group(1), 16), int(m.group(2), 16)))
+
+    return capturas
+
+
+def analizar(paquetes, simbolos):
+    """Devuelve (perfil, entradas, caminos, llamadas)."""
+    perfil = Counter()
+    entradas = Counter()
+    caminos = Counter()
+    llamadas = Counter()
+    pila = []
+
+    for i, (origen, destino) in enumerate(paquetes):
+        excepcion = origen & 1      # bit A: salto por excepcion
+        destino_dir = destino & ~1  # bit S: inicio de traza
+        fn_origen, _ = simbolos.buscar(origen & ~1)
+        fn_destino, _ = simbolos.buscar(destino_dir)
+
+        if destino & 1:
+            pila = []
+
+        if simbolos.es_inicio(destino_dir):
+            # Llamada, salto de cola o entrada a una interrupcion
+            entradas[fn_destino] += 1
+            llamadas[(fn_origen, fn_destino)] += 1
+            if not pila:
+                pila.append(fn_origen)
+            pila.append(fn_destino)
+        elif fn_destino != fn_origen or excepcion:
+            # Retorno: se desarma la pila hasta la funcion de destino
+            if fn_destino in pila:
+                while pila[-1] != fn_destino:
+                    pila.pop()
+            else:
+                pila = [fn_destino]
+        elif not pila:
+            pila = [fn_destino]
+
+        # Tramo secuencial hasta el proximo salto
+        if i + 1 >= len(paquetes):
+            break
+        siguiente_origen = paquetes[i + 1][0]
+        fin = siguiente_origen & ~1
+        if fin < destino_dir:
+            continue
+        instrucciones = (fin - destino_dir) // 2 + 1
+        perfil[fn_destino] += instrucciones
+        caminos[tuple(pila)] += instrucciones
+
+    return perfil, entradas, caminos, llamadas
+
+
+def imprimir(perfil, entradas, caminos, llamadas, top, salida):
+    total = sum(perfil.values()) or 1
+
+    print("Perfil plano (instrucciones estimadas: %d)" % total, file=salida)
+    print("  %      instr  entradas  funcion", file=salida)
+    for fn, instr in perfil.most_common(top):
+        print("%6.2f %8d %9d  %s" % (100.0 * instr / total, instr,
+                                     entradas[fn], fn), file=salida)
+
+    print("", file=salida)
+    print("Caminos mas calientes", file=salida)
+    print("  %      instr  camino", file=salida)
+    for camino, instr in caminos.most_common(top):
+        print("%6.2f %8d  %s" % (100.0 * instr / total, instr,
+                                 " > ".join(camino)), file=salida)
+
+    print("", file=salida)
+    print("Llamadas mas frecuentes", file=salida)
+    print("  cuenta  origen -> destino", file=salida)
+    for (origen, destino), n in llamadas.most_common(top):
+        print("%8d  %s -> %s" % (n, origen, destino), file=salida)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(
+        description="Decodifica volcados del MTB de la KL46Z.")
+    fuente = parser.add_mutually_exclusive_group(required=True)
+    fuente.add_argument("--elf", help="elf (.axf) del proyecto")
+    fuente.add_argument("--nm", help="salida de 'nm -S' del elf")
+    parser.add_argument("--captura", type=int, default=None,
+                        help="analiza solo la captura N (desde 0); "
+                             "por defecto se suman todas")
+    parser.add_argument("--top", type=int, default=15,
+                        help="cantidad de filas por tabla")
+    parser.add_argument("volcado", help="texto capturado de la consola")
+    args = parser.parse_args(argv)
+
+    simbolos = leer_elf(args.elf) if args.elf else leer_nm(args.nm)
+
+    with open(args.volcado, errors="replace") as f:
+        capturas = leer_capturas(f)
+
+    if not capturas:
+        print("No se encontraron capturas del MTB.", file=sys.stderr)
+        return 1
+
+    if args.captura is not None:
+        capturas = [capturas[args.captura]]
+
+    perfil, entradas, caminos, llamadas = Counter(), Counter(), Counter(), \
+        Counter()
+    for paquetes in capturas:
+        p, e, c, l = analizar(paquetes, simbolos)
+        perfil.update(p)
+        entradas.update(e)
+        caminos.update(c)
+        llamadas.update(l)
+
+    print("Capturas: %d  Paquetes: %d" % (len(capturas),
+                                          sum(len(c) for c in capturas)))
+    print("")
+    imprimir(perfil, entradas, caminos, llamadas, args.top, sys.stdout)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""
+Reporte de ram por componente a partir del .map del enlazador.
+
+Suma las secciones de entrada de datos (.data, .bss, COMMON y .noinit) de
+cada archivo objeto, que es lo que ocupa cada modulo del proyecto en ram.
+Con RTOS_ESTATICO en 1 las pilas y los objetos de FreeRTOS de cada modulo
+quedan en su propio .bss, y el heap de FreeRTOS se ve aparte en heap_4.o
+(ucHeap), por lo que el reporte muestra todo el consumo de la aplicacion.
+
+Uso:
+    ram_reporte.py Debug/Nodo1_Freertos.map
+    ram_reporte.py --detalle 20 Debug/Nodo1_Freertos.map
+
+El .map lo genera MCUXpresso en la carpeta de la configuracion de
+compilacion. Con --detalle se listan ademas las secciones mas grandes,
+que llevan el nombre de la variable (el proyecto compila con
+-fdata-sections).
+
+Solo usa la biblioteca estandar de python.
+"""
+
+import argparse
+import os
+import re
+import sys
+from collections import defaultdict
+
+INICIO_MAPA = "Linker script and memory map"
+
+# Seccion de entrada en una linea o con la direccion en la linea siguiente
+RE_SECCION = re.compile(r"^ (\.\S+|COMMON)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*))?\s*$")
+RE_CONTINUACION = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+
+TIPOS = (("data", (".data",)), ("bss", (".bss", "COMMON")), ("noinit", (".noinit",)))
+
+
+def tipo_de(seccion):
+    """Devuelve el tipo de ram de una seccion de entrada, o None."""
+    for tipo, prefijos in TIPOS:
+        for prefijo in prefijos:
+            if seccion == prefijo or seccion.startswith(prefijo + ".") \
+                    or seccion.startswith(prefijo + "_"):
+                return tipo
+    return None
+
+
+def componente_de(objeto):
+    """Nombre corto del archivo objeto (o del miembro de una biblioteca)."""
+    m = re.match(r"(.*)\((.*)\)$", objeto)
+    if m:
+        return "%s(%s)" % (os.path.basename(m.group(1)), m.group(2))
+    return os.path.basename(objeto)
+
+
+def leer_mapa(lineas):
+    """Devuelve la lista de (seccion, tipo, tamaño, componente)."""
+    secciones = []
+    en_mapa = False
+    pendiente = None
+
+    for linea in lineas:
+        linea = linea.rstrip("\n")
+
+        if not en_mapa:
+            en_mapa = linea.startswith(INICIO_MAPA)
+            continue
+
+        if pendiente is not None:
+            m = RE_CONTINUACION.match(linea)
+            if m:
+                secciones.append((pendiente, int(m.group(1), 16),
+                                  int(m.group(2), 16), m.group(3)))
+            pendiente = None
+            continue
+
+        m = RE_SECCION.match(linea)
+        if not m:
+            continue
+        if m.group(2) is None:
+            pendiente = m.group(1)
+            continue
+        secciones.append((m.group(1), int(m.group(2), 16),
+                          int(m.group(3), 16), m.group(4)))
+
+    resultado = []
+    for nombre, direccion, tam, objeto in secciones:
+        tipo = tipo_de(nombre)
+        if tipo is None or tam == 0 or direccion == 0:
+            continue
+        resultado.append((nombre, tipo, tam, componente_de(objeto.strip())))
+
+    return resultado
+
+
+def imprimir(secciones, detalle, salida):
+    por_componente = defaultdict(lambda: defaultdict(int))
+    for _, tipo, tam, componente in secciones:
+        por_componente[componente][tipo] += tam
+
+    filas = sorted(por_componente.items(),
+                   key=lambda c: sum(c[1].values()), reverse=True)
+    total = defaultdict(int)
+
+    print("%-32s %8s %8s %8s %8s" % ("Componente", "data", "bss", "noinit",
+                                     "total"), file=salida)
+    for componente, tipos in filas:
+        for tipo, tam in tipos.items():
+            total[tipo] += tam
+        print("%-32s %8d %8d %8d %8d" % (componente, tipos["data"],
+                                         tipos["bss"], tipos["noinit"],
+                                         sum(tipos.values())), file=salida)
+    print("%-32s %8d %8d %8d %8d" % ("Total", total["data"], total["bss"],
+                                     total["noinit"], sum(total.values())),
+          file=salida)
+
+    if detalle:
+        print("", file=salida)
+        print("Secciones mas grandes", file=salida)
+        print("%8s  %-40s %s" % ("bytes", "seccion", "componente"),
+              file=salida)
+        for nombre, _, tam, componente in sorted(
+                secciones, key=lambda s: s[2], reverse=True)[:detalle]:
+            print("%8d  %-40s %s" % (tam, nombre, componente), file=salida)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(
+        description="Reporte de ram por componente a partir del .map.")
+    parser.add_argument("--detalle", type=int, default=0,
+                        help="lista las N secciones mas grandes")
+    parser.add_argument("mapa", help=".map generado por el enlazador")
+    args = parser.parse_args(argv)
+
+    with open(args.mapa, errors="replace") as f:
+        secciones = leer_mapa(f)
+
+    if not secciones:
+        print("No se encontraron secciones de ram en %s." % args.mapa,
+              file=sys.stderr)
+        return 1
+
+    imprimir(secciones, args.detalle, sys.stdout)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
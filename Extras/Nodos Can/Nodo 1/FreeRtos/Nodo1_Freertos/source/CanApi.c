@@ -21,14 +21,24 @@
 
 #include "FreeRTOS.h"
 #include "task.h"
-#include "timers.h"
 #include "queue.h"
+#include "semphr.h"
 #include "event_groups.h"
 
+#include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "can.h"
 #include "mcp2515.h"
+#include "prof.h"
+#include "mtb_trace.h"
+#include "dlog.h"
+#include "can_pool.h"
+#include "can_rueda.h"
+#include "diag.h"
+#include "tickless.h"
+#include "rtos_estatico.h"
 
 #include "Nodo1.h"
 #include "Nodo2.h"
@@ -54,6 +64,11 @@ typedef struct CANSubscription
 	 */
 	uint16_t nodeId;  // ID del nodo que envía el mensaje
 
+	/**
+	 * @brief Bits de la id que se comparan (CAN_SFF_MASK si es exacta).
+	 */
+	uint16_t mascara;
+
 	/**
 	 * @brief Tarea que maneja la recepción del mensaje.
 	 */
@@ -64,6 +79,71 @@ typedef struct CANSubscription
 	 */
 	QueueHandle_t queueHandle;  // Cola específica del nodo
 
+	/**
+	 * @brief Politica con la cola llena.
+	 */
+	CAN_Politica_t politica;
+
+	/**
+	 * @brief Tiempo maximo de retencion con CAN_POLITICA_ESPERAR.
+	 */
+	TickType_t plazo;
+
+	/**
+	 * @brief Mensaje retenido con CAN_POLITICA_ESPERAR, o NULL.
+	 */
+	CAN_FrameRef_t pendiente;
+
+	/**
+	 * @brief Tick en que vence el mensaje retenido.
+	 */
+	TickType_t vencimiento;
+
+	/**
+	 * @brief Mensajes entregados, para detectar valores nuevos o perdidos.
+	 */
+	uint32_t secuencia;
+
+	/**
+	 * @brief Mensajes que no se entregaron.
+	 */
+	uint32_t descartados;
+
+	/**
+	 * @brief Nodo de la rueda de supervision.
+	 */
+	RuedaNodo_t supervision;
+
+	/**
+	 * @brief Periodo mas tolerancia supervisados, 0 sin supervision.
+	 */
+	TickType_t limite;
+
+	/**
+	 * @brief Vencio el limite sin mensajes.
+	 */
+	bool perdida;
+
+	/**
+	 * @brief La senal volvio y falta avisarlo desde la tarea de recepcion.
+	 */
+	bool recuperada;
+
+	/**
+	 * @brief Veces que se perdio la senal.
+	 */
+	uint32_t perdidas;
+
+	/**
+	 * @brief Aviso de los cambios de la supervision.
+	 */
+	CAN_Supervisor_t aviso;
+
+	/**
+	 * @brief Contexto del aviso.
+	 */
+	void *avisoContexto;
+
 	/**
 	 * @brief Puntero al siguiente nodo de la lista enlazada.
 	 */
@@ -75,13 +155,356 @@ typedef struct CANSubscription
  */
 static CANSubscription_t *subscriptionList = NULL; // Inicio de la lista de suscripciones
 
-static struct can_frame canMsg_Receive;
-static struct can_frame canMsg_Transmision;
+/**
+ * @brief Cantidad de posiciones de la tabla hash del indice.
+ *
+ * Potencia de 2 y mayor a la cantidad de ids distintos suscriptos, para
+ * que las busquedas terminen en una o dos comparaciones.
+ */
+#ifndef CAN_INDICE_SLOTS
+#define CAN_INDICE_SLOTS		32
+#endif
+
+/**
+ * @brief Cantidad maxima de suscripciones (todas las ids juntas).
+ */
+#ifndef CAN_INDICE_MAX_SUBS
+#define CAN_INDICE_MAX_SUBS		32
+#endif
+
+#if (CAN_INDICE_SLOTS & (CAN_INDICE_SLOTS - 1)) || CAN_INDICE_SLOTS > 256
+#error CAN_INDICE_SLOTS debe ser una potencia de 2 menor o igual a 256
+#endif
+
+#if CAN_INDICE_MAX_SUBS > 255
+#error CAN_INDICE_MAX_SUBS debe ser menor a 256
+#endif
+
+/**
+ * @brief Entradas de las cubetas de suscripciones con mascara.
+ *
+ * Una suscripcion ocupa una entrada por cada cubeta que puede coincidir
+ * (hasta CAN_CUBETAS si su mascara no fija los bits altos de la id).
+ */
+#ifndef CAN_INDICE_MAX_MASCARAS
+#define CAN_INDICE_MAX_MASCARAS	32
+#endif
+
+#if CAN_INDICE_MAX_MASCARAS > 255
+#error CAN_INDICE_MAX_MASCARAS debe ser menor a 256
+#endif
+
+/**
+ * @brief Cubetas por los 4 bits altos de la id de 11 bits.
+ */
+#define CAN_CUBETAS				16
+#define CAN_CUBETA_BITS			0x780U
+#define CAN_CUBETA(id)			(((id) & CAN_CUBETA_BITS) >> 7)
+
+/**
+ * @brief Habilitacion de los filtros del mcp2515 segun las suscripciones.
+ */
+#ifndef CAN_FILTROS_HW
+#define CAN_FILTROS_HW			1
+#endif
+
+#define CAN_FILTROS_RXB0		2
+#define CAN_FILTROS_CANT		6
+
+#define CAN_INDICE_VACIO		0xFFFFU
+
+/**
+ * @brief Configuracion de mascaras y filtros del mcp2515.
+ *
+ * RXB0 compara con la mascara 0 y los filtros 0 y 1, RXB1 con la
+ * mascara 1 y los filtros 2 a 5.
+ */
+typedef struct
+{
+	uint16_t mascara[2];
+	uint16_t filtro[CAN_FILTROS_CANT];
+} CAN_FiltrosHw_t;
+
+/**
+ * @brief Posicion de la tabla hash: una id y sus suscriptores.
+ */
+typedef struct
+{
+	/**
+	 * @brief Id del mensaje o CAN_INDICE_VACIO.
+	 */
+	uint16_t id;
+
+	/**
+	 * @brief Primer suscriptor de la id en CAN_Indice_t::subs.
+	 */
+	uint8_t inicio;
+
+	/**
+	 * @brief Cantidad de suscriptores de la id.
+	 */
+	uint8_t cantidad;
+} CAN_IndiceSlot_t;
+
+/**
+ * @brief Indice de suscripciones por id.
+ *
+ * Tabla hash de direccionamiento abierto (sondeo lineal) de las ids de 11
+ * bits; cada posicion apunta a un tramo de subs con los suscriptores de
+ * esa id, contiguos.
+ */
+typedef struct
+{
+	CAN_IndiceSlot_t slots[CAN_INDICE_SLOTS];
+	/**
+	 * @brief Suscriptores exactos agrupados por id, seguidos de los de
+	 * mascara.
+	 */
+	CANSubscription_t *subs[CAN_INDICE_MAX_SUBS];
+	uint32_t cantidad;
+	/**
+	 * @brief Inicio de cada cubeta en mascaras (la ultima marca el fin).
+	 */
+	uint8_t cubetas[CAN_CUBETAS + 1];
+	/**
+	 * @brief Suscripciones con mascara que pueden coincidir con cada cubeta.
+	 */
+	CANSubscription_t *mascaras[CAN_INDICE_MAX_MASCARAS];
+	/**
+	 * @brief Filtros del mcp2515 que cubren todas las suscripciones.
+	 */
+	CAN_FiltrosHw_t filtros;
+} CAN_Indice_t;
+
+/**
+ * @brief Dos copias del indice: una activa y otra para reconstruir.
+ */
+static CAN_Indice_t indices[2];
+
+/**
+ * @brief Indice que usan la recepcion y las lecturas.
+ *
+ * Se reemplaza con una sola escritura al terminar la reconstruccion, por
+ * lo que los lectores nunca toman un lock.
+ */
+static const CAN_Indice_t *volatile indiceActivo = &indices[0];
+
+/**
+ * @brief Lectores recorriendo cada copia del indice.
+ *
+ * La reconstruccion no vuelve hasta que la copia anterior queda sin
+ * lectores: la proxima puede reescribirla y una baja puede liberar la
+ * subscripcion que ya no esta en el indice nuevo.
+ */
+static volatile uint8_t indiceLectores[2];
+
+/**
+ * @brief Serializa las altas y bajas de suscripciones.
+ */
+static SemaphoreHandle_t mutexSuscripciones;
+RTOS_OBJETO_MEMORIA(StaticSemaphore_t, mutexSuscripciones);
+
+/**
+ * @brief El indice cambio y la tarea de recepcion debe cargar sus filtros.
+ */
+static volatile bool filtrosPendientes = false;
 
-#define QUEUE_RECEIVE_LENGTH	5
-#define QUEUE_RECEIVE_SIZE		sizeof(canMsg_Receive)
 #define QUEUE_TRANSMISION_LENGTH	10
-#define QUEUE_TRANSMISION_SIZE	sizeof(canMsg_Transmision)
+
+/**
+ * @brief Elemento de la cola de transmision.
+ */
+typedef struct
+{
+	/**
+	 * @brief Mensaje a enviar.
+	 */
+	struct can_frame frame;
+
+	/**
+	 * @brief Tick en que se cargo en la cola, para medir la latencia.
+	 */
+	TickType_t encolado;
+
+	/**
+	 * @brief Clave de orden, menor sale primero (ver tx_clave()).
+	 */
+	uint32_t clave;
+
+	/**
+	 * @brief Orden de llegada, desempata mensajes de igual clave.
+	 */
+	uint32_t orden;
+
+	/**
+	 * @brief Reintentos de envio consumidos.
+	 */
+	uint32_t reintentos;
+} CAN_TxItem_t;
+
+/**
+ * @brief Cola de transmision con prioridad.
+ *
+ * Min-heap de mensajes ordenado por clave. Se accede siempre dentro de una
+ * seccion critica; los semaforos llevan la cuenta de lugares y mensajes.
+ */
+typedef struct
+{
+	CAN_TxItem_t items[QUEUE_TRANSMISION_LENGTH];
+	uint32_t cantidad;
+	uint32_t orden;
+} CAN_ColaTx_t;
+
+#define QUEUE_RECEIVE_LENGTH	5
+#define QUEUE_RECEIVE_SIZE		sizeof(CAN_FrameRef_t)
+
+/**
+ * @brief Periodo de reintento de los mensajes retenidos (CAN_POLITICA_ESPERAR).
+ */
+#define CAN_RX_REINTENTO		pdMS_TO_TICKS(5)
+
+/**
+ * @brief Cantidad maxima de ids declaradas con consumidores remotos.
+ */
+#ifndef CAN_MAX_REMOTAS
+#define CAN_MAX_REMOTAS		8
+#endif
+
+/**
+ * @brief Cantidad maxima de mensajes periodicos.
+ */
+#ifndef CAN_MAX_PERIODICAS
+#define CAN_MAX_PERIODICAS		8
+#endif
+
+/**
+ * @brief Cantidad maxima de ids con respondedor o pedidas con CAN_request().
+ */
+#ifndef CAN_MAX_RTR
+#define CAN_MAX_RTR			8
+#endif
+
+/**
+ * @brief Cantidad maxima de CAN_request() esperando respuesta a la vez.
+ *
+ * Cada uno usa un bit del grupo de eventos de los pedidos.
+ */
+#ifndef CAN_MAX_PEDIDOS
+#define CAN_MAX_PEDIDOS		4
+#endif
+
+/**
+ * @brief Id atendida con tramas remotas.
+ */
+typedef struct
+{
+	/**
+	 * @brief Id del mensaje.
+	 */
+	canid_t id;
+
+	/**
+	 * @brief Respondedor, o NULL si la id solo se pide.
+	 */
+	CAN_Responder_t responder;
+
+	/**
+	 * @brief Contexto del respondedor.
+	 */
+	void *contexto;
+} CAN_Rtr_t;
+
+/**
+ * @brief Estado de un lugar de pedidos.
+ *
+ * El lugar se libera recien cuando nadie puede volver a poner su bit de
+ * eventosPedidos: el que pide si no hubo respuesta o si el aviso ya se
+ * dio, o quien resolvio si el que pedia se fue mientras avisaba.
+ */
+typedef enum
+{
+	PEDIDO_LIBRE = 0,
+	PEDIDO_ESPERANDO,	/**< Sin respuesta todavia. */
+	PEDIDO_AVISANDO,	/**< Respuesta copiada, falta poner el bit. */
+	PEDIDO_RESUELTO,	/**< Respuesta copiada y bit puesto. */
+	PEDIDO_ABANDONADO,	/**< El que pedia se fue antes del bit. */
+} CAN_PedidoEstado_t;
+
+/**
+ * @brief Pedido de CAN_request() esperando respuesta.
+ */
+typedef struct
+{
+	/**
+	 * @brief Id pedida.
+	 */
+	canid_t id;
+
+	/**
+	 * @brief Donde se copia la respuesta.
+	 */
+	struct can_frame *respuesta;
+
+	/**
+	 * @brief Estado del lugar, se cambia en una seccion critica.
+	 */
+	CAN_PedidoEstado_t estado;
+} CAN_Pedido_t;
+
+/**
+ * @brief Mensaje publicado con CAN_publishPeriodic().
+ */
+typedef struct
+{
+	/**
+	 * @brief Mensaje del productor, se copia al enviarlo.
+	 */
+	const struct can_frame *frame;
+
+	/**
+	 * @brief Periodo de envio [ticks].
+	 */
+	TickType_t periodo;
+
+	/**
+	 * @brief Tick del proximo envio.
+	 */
+	TickType_t proximo;
+} CAN_Periodica_t;
+
+/**
+ * @brief Espera maxima al aviso de fin de transmision antes de reintentar.
+ */
+#define CAN_TX_ESPERA			pdMS_TO_TICKS(20)
+/**
+ * @brief Reintentos antes de descartar un mensaje.
+ */
+#define CAN_TX_REINTENTOS		5
+/**
+ * @brief Espera en la cola a partir de la cual un mensaje pasa adelante.
+ *
+ * Evita que un flujo continuo de ids bajos deje sin salir a los altos.
+ */
+#ifndef CAN_TX_ENVEJECIMIENTO
+#define CAN_TX_ENVEJECIMIENTO	pdMS_TO_TICKS(100)
+#endif
+/**
+ * @brief Clave de los mensajes envejecidos, por delante de cualquier id.
+ */
+#define CAN_TX_CLAVE_ENVEJECIDO	0
+
+/**
+ * @brief Registro de la latencia de cada mensaje transmitido.
+ *
+ * Por defecto se registra en debug y no en release.
+ */
+#ifndef CAN_TX_LATENCIA_LOG
+#if defined(NDEBUG)
+#define CAN_TX_LATENCIA_LOG		0
+#else
+#define CAN_TX_LATENCIA_LOG		1
+#endif
+#endif
 
 /**
  * @brief Cola de recepcion de datos.
@@ -90,408 +513,2648 @@ static struct can_frame canMsg_Transmision;
 /**
  * @brief Cola de transmision de datos.
  */
-QueueHandle_t queue_Transmision;
+static CAN_ColaTx_t colaTx;
+/**
+ * @brief Lugares libres en la cola de transmision.
+ */
+static SemaphoreHandle_t semLugaresTx;
+/**
+ * @brief Mensajes en la cola de transmision.
+ */
+static SemaphoreHandle_t semMensajesTx;
+RTOS_OBJETO_MEMORIA(StaticSemaphore_t, semLugaresTx);
+RTOS_OBJETO_MEMORIA(StaticSemaphore_t, semMensajesTx);
 
+#if RTOS_ESTATICO
 /**
- * @brief Temporizador de transmision.
+ * @brief Subscripciones con sus colas, libres si no tienen cola.
  */
-TimerHandle_t timer_Transimision;
+static CANSubscription_t subsPool[CAN_INDICE_MAX_SUBS];
+static StaticQueue_t subsColas[CAN_INDICE_MAX_SUBS];
+static uint8_t subsDatos[CAN_INDICE_MAX_SUBS][QUEUE_RECEIVE_LENGTH
+		* QUEUE_RECEIVE_SIZE];
+#endif
+
 /**
  * @brief Handle de la tarea de recepcion.
  */
 TaskHandle_t task_Receive_Handle;
+/**
+ * @brief Handle de la tarea de transmision.
+ */
+TaskHandle_t task_Transmision_Handle;
 
-#define TIMER_TRANSMISION_PERIOD_MS	pdMS_TO_TICKS(200)
+/**
+ * @brief Estadisticas de transmision.
+ */
+static CAN_TxStats_t txStats;
 
+#if CAN_ENTREGA_LOCAL
 /**
- * @brief Evento de inicialización de perifericos e interrupcion.
+ * @brief Ids con consumidores remotos.
  */
-EventGroupHandle_t xInitEventGroup;
+static canid_t remotas[CAN_MAX_REMOTAS];
+static uint32_t cantRemotas = 0;
+/**
+ * @brief Espejo de las entregas locales en el bus.
+ */
+static volatile bool espejo = false;
+#endif
 
 /**
- * @brief Callback de el temporizador por software.
+ * @brief Mensajes periodicos.
  */
-static void timerRtos_Transmision(TimerHandle_t xTimer);
+static CAN_Periodica_t periodicas[CAN_MAX_PERIODICAS];
 /**
- * @brief Tarea de recepcion de datos por el bus can.
+ * @brief Min-heap de indices de periodicas ordenado por proximo envio.
  */
-static void taskRtos_Receive(void *pvParameters);
+static uint8_t heapPeriodicas[CAN_MAX_PERIODICAS];
+static uint32_t cantPeriodicas = 0;
+
 /**
- * @brief Funcion de procesamiento de interrupcion.
+ * @brief Hay un periodico nuevo que vence antes que la espera en curso.
  */
-static void canmsg_interrupt(void);
+static volatile bool periodicasCambio = false;
+
 /**
- * @brief Notificación de tareas.
- * @param[in] nodeId Id del mensaje recivido.
+ * @brief La tarea de transmision espera en colaTx_sacar(), la unica espera
+ * que puede cortar CAN_publishPeriodic().
  */
-static void NotifySubscribedNodes(uint16_t nodeId);
+static volatile bool txEsperaCola = false;
+
 /**
- * @brief Inicializacion de perifericos.
+ * @brief Ids con respondedor o pedidas, tambien van a los filtros.
+ *
+ * Se modifica con mutexSuscripciones tomado y dentro de una seccion
+ * critica; la tarea de recepcion la lee en una seccion critica.
  */
-static void perifericos_init(void);
+static CAN_Rtr_t rtrIds[CAN_MAX_RTR];
+static uint32_t cantRtr = 0;
+/**
+ * @brief Pedidos en curso, el bit i de eventosPedidos es el de pedidos[i].
+ */
+static CAN_Pedido_t pedidos[CAN_MAX_PEDIDOS];
+static EventGroupHandle_t eventosPedidos;
+/**
+ * @brief Vencimientos de las subscripciones supervisadas.
+ */
+static Rueda_t ruedaSupervision;
+RTOS_OBJETO_MEMORIA(StaticEventGroup_t, eventosPedidos);
 
-/*
- * ===========================================
- * =			PUBLIC FUNCTIONS			 =
- * ===========================================
+/**
+ * @brief Alguna subscripcion tiene pendiente el aviso de recuperada.
  */
+static volatile bool hayRecuperadas = false;
+
+/**
+ * @brief Marca de tiempo del ultimo flanco de INT, para medir la latencia
+ * hasta la entrega a los suscriptores (PROF_CAN_RX_LATENCIA).
+ */
+static volatile uint32_t rxMarca;
+/**
+ * @brief Marca de la ultima interrupcion con el contador de diagnostico.
+ */
+static volatile uint32_t diagMarca;
+/**
+ * @brief Maximo de mensajes en la cola de un suscriptor.
+ */
+static uint32_t rxColaMax = 0;
+
+/**
+ * @brief Banderas de CANINTF que atiende la tarea de recepcion.
+ *
+ * Mientras alguna quede en 1 el mcp2515 mantiene INT en bajo y no hay un
+ * nuevo flanco, por eso se atienden hasta que quedan todas en 0.
+ */
+#define CAN_INT_ATENDIDAS	(CANINTF_RX0IF | CANINTF_RX1IF | CANINTF_TX0IF \
+		| CANINTF_TX1IF | CANINTF_TX2IF | CANINTF_ERRIF | CANINTF_MERRF)
+
+/**
+ * @brief Lecturas de CANINTF por notificacion.
+ *
+ * Con el spi fallando las banderas no se limpian; pasado este limite se
+ * deja la tarea libre y se vuelve a atender el modulo cada
+ * CAN_INT_REINTENTO.
+ */
+#define CAN_INT_MAX_PASADAS	8
+#define CAN_INT_REINTENTO	pdMS_TO_TICKS(5)
+
+/**
+ * @brief Bits de la notificacion de la tarea de recepcion.
+ *
+ * Solo el flanco de INT (RX_AVISO_INT) lleva a leer CANINTF por spi; el
+ * resto de los avisos solo hace que la tarea recalcule sus esperas.
+ */
+#define RX_AVISO_INT		(1U << 0)
+#define RX_AVISO_REVISAR	(1U << 1)
+
+/**
+ * @brief Evento de inicialización de perifericos e interrupcion.
+ */
+EventGroupHandle_t xInitEventGroup;
+RTOS_OBJETO_MEMORIA(StaticEventGroup_t, xInitEventGroup);
+
+/**
+ * @brief Tarea de transmision de datos por el bus can.
+ *
+ * Espera mensajes en la cola y los envia apenas hay un buffer libre en el
+ * mcp2515; si estan todos ocupados espera el aviso de fin de transmision.
+ */
+static void taskRtos_Transmision(void *pvParameters);
+/**
+ * @brief Tarea de recepcion de datos por el bus can.
+ */
+static void taskRtos_Receive(void *pvParameters);
+
+RTOS_TAREA_MEMORIA(taskRtos_Receive, configMINIMAL_STACK_SIZE + 50);
+RTOS_TAREA_MEMORIA(taskRtos_Transmision, configMINIMAL_STACK_SIZE + 50);
+
+/**
+ * @brief Funcion de procesamiento de interrupcion.
+ * @return false si quedaron banderas sin atender por una falla de lectura
+ * o por llegar a CAN_INT_MAX_PASADAS.
+ */
+static bool canmsg_interrupt(void);
+/**
+ * @brief Lee un mensaje del mcp2515 y lo entrega a los suscriptores.
+ * @return ERROR_OK si habia un mensaje en alguno de los buffers,
+ * ERROR_NOMSG si estaban vacios o el error de la lectura.
+ */
+static ERROR_t canmsg_receive(void);
+/**
+ * @brief Notificación de tareas.
+ *
+ * Cada suscriptor recibe una referencia al mismo mensaje del pool.
+ * @param[in] ref Mensaje recibido.
+ * @return Cantidad de suscripciones a las que se entrego.
+ */
+static uint32_t NotifySubscribedNodes(CAN_FrameRef_t ref);
+/**
+ * @brief Inicializacion de perifericos.
+ */
+static void perifericos_init(void);
+/**
+ * @brief Posicion inicial de la id en la tabla hash.
+ * @param[in] id Id del mensaje.
+ * @return Posicion.
+ */
+static uint32_t indice_hash(uint16_t id);
+/**
+ * @brief Busca los suscriptores de una id.
+ * @param[in] idx Indice donde buscar.
+ * @param[in] id Id del mensaje.
+ * @return Posicion de la id o NULL si no tiene suscriptores.
+ */
+static const CAN_IndiceSlot_t* indice_buscar(const CAN_Indice_t *idx,
+		uint16_t id);
+/**
+ * @brief Toma el indice activo para recorrerlo.
+ *
+ * Entre indice_tomar() e indice_soltar() no se bloquea ni se llama a una
+ * funcion que cambie las suscripciones.
+ * @return Indice activo.
+ */
+static const CAN_Indice_t* indice_tomar(void);
+/**
+ * @brief Suelta un indice tomado con indice_tomar().
+ * @param[in] idx Indice tomado.
+ */
+static void indice_soltar(const CAN_Indice_t *idx);
+/**
+ * @brief Reconstruye el indice a partir de la lista de suscripciones.
+ *
+ * Se arma en la copia inactiva, se publica y se espera a que la anterior
+ * quede sin lectores. Debe llamarse con mutexSuscripciones tomado.
+ * @return ERROR_CAN_MEMORY si la lista no entra en el indice.
+ */
+static Error_Can_t indice_reconstruir(void);
+/**
+ * @brief Calcula los filtros del mcp2515 que dejan pasar todas las
+ * suscripciones del indice.
+ *
+ * Las suscripciones se agrupan de a pares hasta que quedan tantos grupos
+ * como filtros, uniendo siempre el par que pierde menos bits de mascara.
+ * El resultado deja pasar lo suscripto y quizas algo mas, nunca menos.
+ * @param[in,out] idx Indice recien armado.
+ */
+static void filtros_calcular(CAN_Indice_t *idx);
+#if CAN_FILTROS_HW
+/**
+ * @brief Carga los filtros del indice activo en el mcp2515.
+ *
+ * Se llama desde la tarea de recepcion, que es la que usa el spi.
+ */
+static void filtros_aplicar(void);
+#endif
+/**
+ * @brief Modo de operacion del mcp2515.
+ * @return Estado del cambio de modo.
+ */
+static ERROR_t modo_operacion(void);
+/**
+ * @brief Busca la subscripcion de una tarea a una id.
+ * @param[in] nodeId Id del nodo.
+ * @param[in] taskHandle Tarea suscripta.
+ * @return Subscripcion o NULL si no existe.
+ */
+static CANSubscription_t* buscarSubscripcion(uint16_t nodeId,
+		TaskHandle_t taskHandle);
+/**
+ * @brief Entrega un mensaje a un suscriptor sin bloquear.
+ *
+ * Si la cola esta llena aplica la politica de la subscripcion.
+ * @param[in] sub Suscriptor.
+ * @param[in] ref Mensaje, con una referencia para el suscriptor.
+ */
+static void entregar(CANSubscription_t *sub, CAN_FrameRef_t ref);
+/**
+ * @brief Reintenta entregar el mensaje retenido de un suscriptor.
+ *
+ * Si vencio el plazo se descarta.
+ * @param[in] sub Suscriptor.
+ * @param[in] ahora Tick actual.
+ * @return true si el mensaje sigue retenido.
+ */
+static bool entregarPendiente(CANSubscription_t *sub, TickType_t ahora);
+/**
+ * @brief Reintenta los mensajes retenidos de todos los suscriptores.
+ * @return Espera hasta el proximo reintento (portMAX_DELAY si no hay).
+ */
+static TickType_t reintentarPendientes(void);
+/**
+ * @brief Clave de orden de un id, la misma precedencia que el arbitraje.
+ *
+ * Compara primero los 11 bits del id base; a igual base gana el estandar.
+ * Queda por encima de CAN_TX_CLAVE_ENVEJECIDO.
+ * @param[in] id Id del mensaje.
+ * @return Clave.
+ */
+static uint32_t tx_clave(canid_t id);
+/**
+ * @brief Carga un mensaje en la cola de transmision.
+ * @param[in] *item Mensaje con la clave ya cargada.
+ * @param[in] xTicksToWait Espera maxima por un lugar.
+ * @return pdPASS si se cargo, pdFAIL sin lugar o con can_dlc invalido.
+ */
+static BaseType_t colaTx_cargar(CAN_TxItem_t *item, TickType_t xTicksToWait);
+/**
+ * @brief Saca el mensaje de mayor prioridad de la cola de transmision.
+ *
+ * La espera se corta antes si se publica un periodico que vence primero.
+ * @param[out] *item Mensaje.
+ * @param[in] xTicksToWait Espera maxima por un mensaje.
+ * @return pdPASS si habia un mensaje.
+ */
+static BaseType_t colaTx_sacar(CAN_TxItem_t *item, TickType_t xTicksToWait);
+/**
+ * @brief Cambia el mensaje en curso por el primero de la cola si este le
+ * gana en prioridad. No cambia la cantidad de mensajes de la cola.
+ * @param[in,out] *item Mensaje en curso.
+ */
+static void colaTx_intercambiar(CAN_TxItem_t *item);
+/**
+ * @brief Adelanta los mensajes que esperan mas de CAN_TX_ENVEJECIMIENTO.
+ *
+ * Solo baja claves, por lo que basta reubicarlos hacia arriba. Se llama
+ * dentro de una seccion critica.
+ * @param[in] ahora Tick actual.
+ */
+static void colaTx_envejecer(TickType_t ahora);
+/**
+ * @brief Indica si el mensaje a sale antes que b.
+ */
+static bool colaTx_precede(const CAN_TxItem_t *a, const CAN_TxItem_t *b);
+/**
+ * @brief Reubica hacia arriba una posicion de la cola de transmision.
+ */
+static void colaTx_subir(uint32_t pos);
+/**
+ * @brief Reubica hacia abajo una posicion de la cola de transmision.
+ */
+static void colaTx_bajar(uint32_t pos);
+#if CAN_ENTREGA_LOCAL
+/**
+ * @brief Entrega un mensaje a los suscriptores locales.
+ *
+ * Usa el mismo reparto que la recepcion con el planificador suspendido,
+ * para no intercalarse con la tarea de recepcion.
+ * @param[in] *frame Mensaje enviado.
+ * @return true si no hace falta enviarlo al bus.
+ */
+static bool entregaLocal(const struct can_frame *frame);
+#endif
+/**
+ * @brief Encola los mensajes periodicos vencidos.
+ * @return Ticks hasta el proximo vencimiento (portMAX_DELAY si no hay).
+ */
+static TickType_t periodicas_despachar(void);
+/**
+ * @brief Elige el offset que mas separa a un periodo de los ya cargados.
+ * @param[in] periodo Periodo del mensaje nuevo.
+ * @param[in] ahora Tick actual.
+ * @return Offset [ticks].
+ */
+static TickType_t periodicas_offsetAuto(TickType_t periodo, TickType_t ahora);
+/**
+ * @brief Agrega una id a rtrIds o le cambia el respondedor.
+ *
+ * Una id nueva reconstruye el indice para que entre en los filtros.
+ * @param[in] id Id del mensaje.
+ * @param[in] responder Respondedor a cargar.
+ * @param[in] *contexto Contexto del respondedor.
+ * @param[in] cambiar false si solo se asegura que la id este, sin tocar
+ * el respondedor (CAN_request()).
+ * @return ERROR_CAN_MEMORY si no hay lugar.
+ */
+static Error_Can_t rtr_registrar(canid_t id, CAN_Responder_t responder,
+		void *contexto, bool cambiar);
+/**
+ * @brief Arma la respuesta de un pedido remoto con su respondedor.
+ * @param[in] id Id pedida, sin CAN_RTR_FLAG.
+ * @param[out] *respuesta Mensaje a enviar.
+ * @return false si no hay respondedor o no quiso contestar.
+ */
+static bool rtr_contestar(canid_t id, struct can_frame *respuesta);
+/**
+ * @brief Contesta un pedido remoto recibido del bus.
+ *
+ * La respuesta se encola sin esperar y sin entrega local.
+ * @param[in] *pedido Trama remota.
+ */
+static void rtr_responder(const struct can_frame *pedido);
+/**
+ * @brief Completa los pedidos en curso que esperan este mensaje.
+ * @param[in] *frame Mensaje de datos recibido o entregado localmente.
+ */
+static void pedidos_resolver(const struct can_frame *frame);
+/**
+ * @brief Rearma la supervision de una subscripcion que recibio un mensaje.
+ *
+ * Si la senal estaba perdida deja el aviso para la tarea de recepcion:
+ * con la entrega local esto corre en la tarea que envia y con el
+ * planificador suspendido.
+ */
+static void supervision_recibido(CANSubscription_t *sub);
+/**
+ * @brief Avisa las senales recuperadas desde la ultima revision.
+ */
+static void supervision_avisarRecuperadas(void);
+/**
+ * @brief Avisa las senales perdidas desde la ultima revision.
+ * @return Ticks hasta el proximo vencimiento posible.
+ */
+static TickType_t supervision_revisar(void);
+/**
+ * @brief Reubica hacia arriba una posicion del heap.
+ */
+static void heap_subir(uint32_t pos);
+/**
+ * @brief Reubica hacia abajo una posicion del heap.
+ */
+static void heap_bajar(uint32_t pos);
+/**
+ * @brief Reserva una subscripcion con su cola.
+ *
+ * Del heap, o del pool estatico con RTOS_ESTATICO.
+ * @param[in] largo Lugares de la cola.
+ * @return NULL si no hay memoria.
+ */
+static CANSubscription_t* sub_reservar(UBaseType_t largo);
+/**
+ * @brief Libera una subscripcion y su cola.
+ */
+static void sub_liberar(CANSubscription_t *sub);
+/**
+ * @brief Crea una subscripcion con la mascara y la politica indicadas.
+ */
+static Error_Can_t subscribir(uint16_t nodeId, uint16_t mascara,
+		TaskHandle_t taskHandle, CAN_Politica_t politica, TickType_t plazo);
+
+/*
+ * ===========================================
+ * =			PUBLIC FUNCTIONS			 =
+ * ===========================================
+ */
+
+extern void CAN_init(void)
+{
+	/* Pool de mensajes recibidos. */
+	can_pool_init();
+
+	/* Indice de suscripciones vacio. */
+	memset(indices, 0xFF, sizeof(indices));
+	indices[0].cantidad = 0;
+	indices[1].cantidad = 0;
+	mutexSuscripciones = RTOS_MUTEX_CREAR(mutexSuscripciones);
+	if (mutexSuscripciones == NULL)
+		PRINTF("\n\rFallo al crear el mutex.\n\r");
+
+	/* Inicializacion de la cola de transmision. */
+	colaTx.cantidad = 0;
+	semLugaresTx = RTOS_SEMAFORO_CONTADOR_CREAR(semLugaresTx,
+			QUEUE_TRANSMISION_LENGTH, QUEUE_TRANSMISION_LENGTH);
+	semMensajesTx = RTOS_SEMAFORO_CONTADOR_CREAR(semMensajesTx,
+			QUEUE_TRANSMISION_LENGTH, 0);
+	if (semLugaresTx == NULL || semMensajesTx == NULL)
+		PRINTF("\n\rFallo al crear la cola de datos.\n\r");
+
+	/* Inicializacion de tarea de recepcion. */
+	BaseType_t status = RTOS_TAREA_CREAR(taskRtos_Receive, "Task Read can",
+			NULL, configMAX_PRIORITIES, &task_Receive_Handle);
+	if (status != pdTRUE)
+		PRINTF("Fallo al crear la tarea.\n\r");
+
+	/* Inicializacion de tarea de transmision. */
+	status = RTOS_TAREA_CREAR(taskRtos_Transmision, "Task Write can", NULL,
+			configMAX_PRIORITIES - 2, &task_Transmision_Handle);
+	if (status != pdTRUE)
+		PRINTF("Fallo al crear la tarea.\n\r");
+
+	/* Creamos el evento de sincronizacion. */
+	xInitEventGroup = RTOS_EVENTOS_CREAR(xInitEventGroup);
+
+	/* Rueda de supervision vacia. */
+	rueda_init(&ruedaSupervision, CAN_SUPERVISION_BITS, xTaskGetTickCount());
+
+	/* Avisos de respuesta de CAN_request(). */
+	eventosPedidos = RTOS_EVENTOS_CREAR(eventosPedidos);
+	if (xInitEventGroup == NULL || eventosPedidos == NULL)
+		PRINTF("\n\rFallo al crear los eventos.\n\r");
+
+	return;
+}
+
+extern Error_Can_t CAN_Subscribe(uint16_t nodeId, TaskHandle_t taskHandle)
+{
+	return subscribir(nodeId, CAN_SFF_MASK, taskHandle, CAN_POLITICA_ESPERAR,
+			CAN_PLAZO_DEFECTO);
+}
+
+extern Error_Can_t CAN_SubscribePolicy(uint16_t nodeId,
+		TaskHandle_t taskHandle, CAN_Politica_t politica, TickType_t plazo)
+{
+	return subscribir(nodeId, CAN_SFF_MASK, taskHandle, politica, plazo);
+}
+
+extern Error_Can_t CAN_SubscribeMask(uint16_t id, uint16_t mascara,
+		TaskHandle_t taskHandle, CAN_Politica_t politica, TickType_t plazo)
+{
+	mascara &= CAN_SFF_MASK;
+
+	return subscribir(id & mascara, mascara, taskHandle, politica, plazo);
+}
+
+extern Error_Can_t CAN_SubscribeLatest(uint16_t nodeId,
+		TaskHandle_t taskHandle)
+{
+	return subscribir(nodeId, CAN_SFF_MASK, taskHandle,
+			CAN_POLITICA_SOBRESCRIBIR, 0);
+}
+
+extern Error_Can_t CAN_Unsubscribe(uint16_t nodeId, TaskHandle_t taskHandle)
+{
+	CANSubscription_t **current = &subscriptionList;
+
+	xSemaphoreTake(mutexSuscripciones, portMAX_DELAY);
+
+	while (*current != NULL)
+	{
+		if ((*current)->nodeId == nodeId
+				&& (*current)->taskHandle == taskHandle)
+		{
+			CANSubscription_t *toDelete = *current;
+			*current = (*current)->next;
+
+			taskENTER_CRITICAL();
+			toDelete->limite = 0;
+			rueda_quitar(&ruedaSupervision, &toDelete->supervision);
+			taskEXIT_CRITICAL();
+
+			// Al volver ni el indice nuevo ni un lector del anterior la usan
+			indice_reconstruir();
+			xSemaphoreGive(mutexSuscripciones);
+
+			// Devuelve al pool los mensajes que no se leyeron
+			CAN_FrameRef_t ref;
+			while (xQueueReceive(toDelete->queueHandle, &ref, 0) == pdPASS)
+				can_pool_release(ref);
+			if (toDelete->pendiente != NULL)
+				can_pool_release(toDelete->pendiente);
+
+			// Eliminar la cola específica del nodo
+			sub_liberar(toDelete);
+
+			return ERROR_CAN_OK;
+		}
+
+		current = &(*current)->next;
+	}
+
+	xSemaphoreGive(mutexSuscripciones);
+
+	return ERROR_CAN_NOT_FOUND;
+}
+
+extern Error_Can_t CAN_sendMsg(struct can_frame *dato, TickType_t xTicksToWait)
+{
+	CAN_TxItem_t item;
+
+	configASSERT(semLugaresTx != NULL);
+
+	if (dato->can_dlc > CAN_MAX_DLEN)
+		return ERROR_CAN_FAILTX;
+
+#if CAN_ENTREGA_LOCAL
+	if (entregaLocal(dato))
+		return ERROR_CAN_OK;
+#endif
+
+	memcpy(&item.frame, dato, sizeof(struct can_frame));
+	item.clave = tx_clave(dato->can_id);
+
+	BaseType_t status = colaTx_cargar(&item, xTicksToWait);
+	if (status != pdPASS)
+	{
+		PRINTF("\n\rFallo al cargar datos en la cola.\n\r");
+		return ERROR_CAN_QUEUETX;
+	}
+
+	return ERROR_CAN_OK;
+}
+
+extern Error_Can_t CAN_sendMsgPriority(struct can_frame *dato,
+		uint16_t prioridad, TickType_t xTicksToWait)
+{
+	CAN_TxItem_t item;
+
+	configASSERT(semLugaresTx != NULL);
+
+	if (dato->can_dlc > CAN_MAX_DLEN)
+		return ERROR_CAN_FAILTX;
+
+	if (prioridad > CAN_PRIORIDAD_MINIMA)
+		prioridad = CAN_PRIORIDAD_MINIMA;
+
+#if CAN_ENTREGA_LOCAL
+	if (entregaLocal(dato))
+		return ERROR_CAN_OK;
+#endif
+
+	memcpy(&item.frame, dato, sizeof(struct can_frame));
+	item.clave = tx_clave(prioridad);
+
+	BaseType_t status = colaTx_cargar(&item, xTicksToWait);
+	if (status != pdPASS)
+	{
+		PRINTF("\n\rFallo al cargar datos en la cola.\n\r");
+		return ERROR_CAN_QUEUETX;
+	}
+
+	return ERROR_CAN_OK;
+}
+
+#if CAN_ENTREGA_LOCAL
+extern Error_Can_t CAN_setRemote(canid_t id, bool remoto)
+{
+	Error_Can_t error = ERROR_CAN_OK;
+	uint32_t i;
+
+	taskENTER_CRITICAL();
+
+	for (i = 0; i < cantRemotas && remotas[i] != id; i++)
+		;
+
+	if (remoto && i == cantRemotas)
+	{
+		if (cantRemotas < CAN_MAX_REMOTAS)
+			remotas[cantRemotas++] = id;
+		else
+			error = ERROR_CAN_MEMORY;
+	}
+	else if (!remoto && i < cantRemotas)
+	{
+		remotas[i] = remotas[--cantRemotas];
+	}
+
+	taskEXIT_CRITICAL();
+
+	return error;
+}
+
+extern void CAN_setMirror(bool activo)
+{
+	espejo = activo;
+
+	return;
+}
+#else
+extern Error_Can_t CAN_setRemote(canid_t id, bool remoto)
+{
+	// Sin entrega local todo sale al bus
+	return ERROR_CAN_OK;
+}
+
+extern void CAN_setMirror(bool activo)
+{
+	return;
+}
+#endif
+
+extern Error_Can_t CAN_publishPeriodic(const struct can_frame *frame,
+		TickType_t periodo, TickType_t offset)
+{
+	bool primero;
+
+	if (frame == NULL || periodo == 0)
+		return ERROR_CAN_FAILTX;
+
+	taskENTER_CRITICAL();
+
+	if (cantPeriodicas == CAN_MAX_PERIODICAS)
+	{
+		taskEXIT_CRITICAL();
+		return ERROR_CAN_MEMORY;
+	}
+
+	TickType_t ahora = xTaskGetTickCount();
+
+	if (offset == CAN_PERIODICA_AUTO)
+		offset = periodicas_offsetAuto(periodo, ahora);
+
+	uint32_t n = cantPeriodicas++;
+
+	periodicas[n].frame = frame;
+	periodicas[n].periodo = periodo;
+	periodicas[n].proximo = ahora + offset;
+	heapPeriodicas[n] = (uint8_t) n;
+	heap_subir(n);
+
+	primero = (heapPeriodicas[0] == n);
+
+	taskEXIT_CRITICAL();
+
+	/*
+	 * Si es el proximo en vencer se despierta a la tarea de transmision
+	 * para que recalcule su espera (solo si ya termino de inicializar).
+	 * Solo se corta la espera de la cola: la del fin de transmision contaria
+	 * como un reintento. Con el planificador suspendido la tarea no cambia
+	 * de espera entre la consulta y el corte; si todavia no se bloqueo, ve
+	 * periodicasCambio y no espera.
+	 * */
+	if (primero && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING
+			&& (xEventGroupGetBits(xInitEventGroup) & INIT_COMPLETE_EVENT))
+	{
+		periodicasCambio = true;
+
+		vTaskSuspendAll();
+		if (txEsperaCola)
+			xTaskAbortDelay(task_Transmision_Handle);
+		xTaskResumeAll();
+	}
+
+	return ERROR_CAN_OK;
+}
+
+extern Error_Can_t CAN_request(canid_t id, TickType_t timeout,
+		struct can_frame *respuesta)
+{
+	struct can_frame pedido;
+	Error_Can_t error;
+	EventBits_t bit;
+	CAN_PedidoEstado_t estado;
+	uint32_t i;
+
+	configASSERT(eventosPedidos != NULL);
+
+	id &= ~(CAN_RTR_FLAG | CAN_ERR_FLAG);
+
+#if CAN_ENTREGA_LOCAL
+	// Respondedor en el mismo micro: se contesta sin pasar por el bus
+	if (rtr_contestar(id, respuesta))
+		return ERROR_CAN_OK;
+#endif
+
+	// La id tiene que pasar los filtros para recibir la respuesta
+	error = rtr_registrar(id, NULL, NULL, false);
+	if (error != ERROR_CAN_OK)
+		return error;
+
+	taskENTER_CRITICAL();
+	for (i = 0; i < CAN_MAX_PEDIDOS && pedidos[i].estado != PEDIDO_LIBRE;
+			i++)
+		;
+	if (i < CAN_MAX_PEDIDOS)
+	{
+		pedidos[i].id = id;
+		pedidos[i].respuesta = respuesta;
+		pedidos[i].estado = PEDIDO_ESPERANDO;
+	}
+	taskEXIT_CRITICAL();
+
+	if (i == CAN_MAX_PEDIDOS)
+		return ERROR_CAN_MEMORY;
+
+	bit = (EventBits_t) 1 << i;
+
+	memset(&pedido, 0, sizeof(pedido));
+	pedido.can_id = id | CAN_RTR_FLAG;
+
+	error = CAN_sendMsg(&pedido, timeout);
+	if (error == ERROR_CAN_OK
+			&& (xEventGroupWaitBits(eventosPedidos, bit, pdTRUE, pdTRUE,
+					timeout) & bit) == 0)
+		error = ERROR_CAN_TIMEOUT;
+
+	/*
+	 * La respuesta la indica el estado, no el bit: pudo llegar entre el
+	 * vencimiento y esta seccion critica.
+	 * */
+	taskENTER_CRITICAL();
+	estado = pedidos[i].estado;
+	if (estado == PEDIDO_ESPERANDO)
+		pedidos[i].estado = PEDIDO_LIBRE;
+	else if (estado == PEDIDO_AVISANDO)
+		pedidos[i].estado = PEDIDO_ABANDONADO;	// Lo libera pedidos_resolver()
+	taskEXIT_CRITICAL();
+
+	if (estado == PEDIDO_RESUELTO)
+	{
+		// El bit ya no se vuelve a poner: se borra y se libera el lugar
+		xEventGroupClearBits(eventosPedidos, bit);
+
+		taskENTER_CRITICAL();
+		pedidos[i].estado = PEDIDO_LIBRE;
+		taskEXIT_CRITICAL();
+	}
+
+	if (estado != PEDIDO_ESPERANDO && error == ERROR_CAN_TIMEOUT)
+		error = ERROR_CAN_OK;
+
+	return error;
+}
+
+extern Error_Can_t CAN_setResponder(canid_t id, CAN_Responder_t responder,
+		void *contexto)
+{
+	return rtr_registrar(id & ~(CAN_RTR_FLAG | CAN_ERR_FLAG), responder,
+			contexto, true);
+}
+
+extern bool CAN_responderFrame(struct can_frame *respuesta, void *contexto)
+{
+	const struct can_frame *frame = contexto;
+
+	// Mismo criterio que el planificador: el productor puede estar escribiendo
+	taskENTER_CRITICAL();
+	respuesta->can_dlc = frame->can_dlc;
+	memcpy(respuesta->data, frame->data, sizeof(respuesta->data));
+	taskEXIT_CRITICAL();
+
+	return true;
+}
+
+extern Error_Can_t CAN_readMsg(struct can_frame *dato, uint16_t nodeId,
+		TaskHandle_t taskHandle)
+{
+	CAN_FrameRef_t ref;
+
+	Error_Can_t error = CAN_readRef(&ref, nodeId, taskHandle);
+	if (error != ERROR_CAN_OK)
+		return error;
+
+	memcpy(dato, can_pool_frame(ref), sizeof(struct can_frame));
+	can_pool_release(ref);
+
+	return ERROR_CAN_OK;
+}
+
+extern Error_Can_t CAN_readRef(CAN_FrameRef_t *ref, uint16_t nodeId,
+		TaskHandle_t taskHandle)
+{
+	CANSubscription_t *current = buscarSubscripcion(nodeId, taskHandle);
+
+	if (current == NULL)
+		return ERROR_CAN_NOT_FOUND;
+
+	// Leer la referencia de la cola específica del nodo
+	BaseType_t status = xQueueReceive(current->queueHandle, ref,
+			pdMS_TO_TICKS(200));
+	if (status != pdPASS)
+	{
+//		PRINTF("\n\rFallo al recibir datos de la cola.\n\r");
+		return ERROR_CAN_QUEUERX;
+	}
+
+	return ERROR_CAN_OK;
+}
+
+extern Error_Can_t CAN_readLatest(struct can_frame *dato, uint16_t nodeId,
+		TaskHandle_t taskHandle, uint32_t *secuencia)
+{
+	CANSubscription_t *current = buscarSubscripcion(nodeId, taskHandle);
+	CAN_FrameRef_t ref;
+	BaseType_t status;
+	uint32_t sec;
+
+	if (current == NULL || current->politica != CAN_POLITICA_SOBRESCRIBIR)
+		return ERROR_CAN_NOT_FOUND;
+
+	/*
+	 * La recepcion puede pisar el buzon en cualquier momento: la
+	 * referencia se toma junto con su secuencia antes de copiar el mensaje.
+	 * */
+	taskENTER_CRITICAL();
+	status = xQueuePeek(current->queueHandle, &ref, 0);
+	if (status == pdPASS)
+		can_pool_retain(ref);
+	sec = current->secuencia;
+	taskEXIT_CRITICAL();
+
+	if (status != pdPASS)
+		return ERROR_CAN_QUEUERX;
+
+	memcpy(dato, can_pool_frame(ref), sizeof(struct can_frame));
+	can_pool_release(ref);
+
+	if (secuencia != NULL)
+		*secuencia = sec;
+
+	return ERROR_CAN_OK;
+}
+
+extern Error_Can_t CAN_getDropped(uint16_t nodeId, TaskHandle_t taskHandle,
+		uint32_t *descartados)
+{
+	CANSubscription_t *current = buscarSubscripcion(nodeId, taskHandle);
+
+	if (current == NULL)
+		return ERROR_CAN_NOT_FOUND;
+
+	*descartados = current->descartados;
+
+	return ERROR_CAN_OK;
+}
+
+extern Error_Can_t CAN_Supervise(uint16_t nodeId, TaskHandle_t taskHandle,
+		TickType_t periodo, TickType_t tolerancia, CAN_Supervisor_t aviso,
+		void *contexto)
+{
+	CANSubscription_t *sub;
+
+	xSemaphoreTake(mutexSuscripciones, portMAX_DELAY);
+
+	sub = buscarSubscripcion(nodeId, taskHandle);
+	if (sub == NULL)
+	{
+		xSemaphoreGive(mutexSuscripciones);
+		return ERROR_CAN_NOT_FOUND;
+	}
+
+	taskENTER_CRITICAL();
+	sub->aviso = aviso;
+	sub->avisoContexto = contexto;
+	sub->perdida = false;
+	sub->recuperada = false;
+	if (periodo == 0)
+	{
+		sub->limite = 0;
+		rueda_quitar(&ruedaSupervision, &sub->supervision);
+	}
+	else
+	{
+		sub->limite = periodo + tolerancia;
+		rueda_armar(&ruedaSupervision, &sub->supervision,
+				xTaskGetTickCount() + sub->limite);
+	}
+	taskEXIT_CRITICAL();
+
+	xSemaphoreGive(mutexSuscripciones);
+
+	// La tarea de recepcion recalcula cuanto puede esperar
+	if (task_Receive_Handle != NULL)
+		xTaskNotify(task_Receive_Handle, RX_AVISO_REVISAR, eSetBits);
+
+	return ERROR_CAN_OK;
+}
+
+extern Error_Can_t CAN_getSupervision(uint16_t nodeId,
+		TaskHandle_t taskHandle, bool *presente, uint32_t *perdidas)
+{
+	CANSubscription_t *sub = buscarSubscripcion(nodeId, taskHandle);
+
+	if (sub == NULL)
+		return ERROR_CAN_NOT_FOUND;
+
+	taskENTER_CRITICAL();
+	*presente = !sub->perdida;
+	if (perdidas != NULL)
+		*perdidas = sub->perdidas;
+	taskEXIT_CRITICAL();
+
+	return ERROR_CAN_OK;
+}
+
+extern void CAN_releaseRef(CAN_FrameRef_t ref)
+{
+	can_pool_release(ref);
+
+	return;
+}
+
+extern void CAN_getTxStats(CAN_TxStats_t *stats)
+{
+	taskENTER_CRITICAL();
+	memcpy(stats, &txStats, sizeof(CAN_TxStats_t));
+	taskEXIT_CRITICAL();
+
+	return;
+}
+
+extern uint32_t CAN_getRxQueueMax(void)
+{
+	return rxColaMax;
+}
+
+extern void CAN_getEvent(void)
+{
+	// Esperar a que se complete la inicialización (bloqueante)
+	xEventGroupWaitBits(xInitEventGroup, INIT_COMPLETE_EVENT, pdFALSE, pdTRUE,
+	portMAX_DELAY);
+
+	return;
+}
+
+#if CAN_BENCH_FANOUT
+#if !PROF_ENABLE
+#error CAN_BENCH_FANOUT requiere PROF_ENABLE
+#endif
+#if RTOS_ESTATICO
+#error CAN_BENCH_FANOUT crea colas en el heap, no usar con RTOS_ESTATICO
+#endif
+extern void CAN_benchFanout(void)
+{
+	static const uint8_t cantidades[] =
+	{ 1, 2, 4, 8 };
+	TaskHandle_t tarea = xTaskGetCurrentTaskHandle();
+	QueueHandle_t colas[CAN_BENCH_MAX_SUBS];
+	struct can_frame frame =
+	{ .can_id = CAN_BENCH_ID, .can_dlc = 8, };
+	struct can_frame copia;
+	CANSubscription_t *current;
+	CAN_FrameRef_t ref;
+	uint32_t inicio, totalCopia, totalRef;
+
+	PRINTF("\r\n--- Fan-out (ciclos por mensaje, media de %u) ---\r\n",
+			(unsigned) CAN_BENCH_REPETICIONES);
+	PRINTF("Subs      Copia  Referencia\r\n");
+
+	for (uint32_t c = 0; c < sizeof(cantidades); c++)
+	{
+		uint32_t n = cantidades[c];
+
+		for (uint32_t i = 0; i < n; i++)
+		{
+			colas[i] = xQueueCreate(1, sizeof(struct can_frame));
+			CAN_Subscribe(CAN_BENCH_ID, tarea);
+		}
+
+		totalCopia = 0;
+		totalRef = 0;
+
+		for (uint32_t r = 0; r < CAN_BENCH_REPETICIONES; r++)
+		{
+			/* Esquema anterior: una copia por suscriptor y otra al leer */
+			inicio = prof_now();
+			for (uint32_t i = 0; i < n; i++)
+			{
+				memcpy(&copia, &frame, sizeof(struct can_frame));
+				xQueueSendToBack(colas[i], &copia, 0);
+				xTaskNotify(tarea, 0, eIncrement);
+			}
+			for (uint32_t i = 0; i < n; i++)
+				xQueueReceive(colas[i], &copia, 0);
+			totalCopia += prof_now() - inicio;
+
+			/* Pool: el mensaje se escribe en su entrada (lo hace el spi) */
+			inicio = prof_now();
+			ref = can_pool_alloc();
+			totalRef += prof_now() - inicio;
+			if (ref == NULL)
+				break;
+			memcpy(&ref->frame, &frame, sizeof(struct can_frame));
+
+			inicio = prof_now();
+			NotifySubscribedNodes(ref);
+			can_pool_release(ref);
+			for (current = subscriptionList; current != NULL;
+					current = current->next)
+			{
+				if (current->nodeId == CAN_BENCH_ID
+						&& xQueueReceive(current->queueHandle, &ref, 0) == pdPASS)
+					can_pool_release(ref);
+			}
+			totalRef += prof_now() - inicio;
+
+			ulTaskNotifyTake(pdTRUE, 0);
+		}
+
+		for (uint32_t i = 0; i < n; i++)
+		{
+			CAN_Unsubscribe(CAN_BENCH_ID, tarea);
+			vQueueDelete(colas[i]);
+		}
+
+		PRINTF("%4u  %9u  %10u\r\n", (unsigned) n,
+				(unsigned) (totalCopia / CAN_BENCH_REPETICIONES),
+				(unsigned) (totalRef / CAN_BENCH_REPETICIONES));
+	}
+
+	return;
+}
+#endif /* CAN_BENCH_FANOUT */
+
+/*
+ * ===========================================
+ * =			PRIVATE FUNCTIONS			 =
+ * ===========================================
+ */
+
+static void taskRtos_Receive(void *pvParameters)
+{
+	uint32_t event_notify;
+	TickType_t espera = portMAX_DELAY;
+	bool intTrabada = false;
+
+	/* Configura de can */
+	CAN_PERIFERICOS_INIT();	// Inicializacion de los perifericos
+	__delay_ms(5);
+
+	CAN_INTERRUPT_INIT();	// Inicializacion de las interrupciones
+	__delay_ms(5);
+
+#if CAN_FILTROS_HW
+	// Filtros de las suscripciones hechas antes de la inicializacion
+	if (filtrosPendientes)
+		filtros_aplicar();
+#endif
+
+	// Establecer el evento de inicialización completa
+	xEventGroupSetBits(xInitEventGroup, INIT_COMPLETE_EVENT);
+
+	for (;;)
+	{
+		// Con mensajes retenidos se despierta para reintentarlos
+		if (xTaskNotifyWait(0, UINT32_MAX, &event_notify, espera) != pdTRUE)
+			event_notify = 0;
+
+		// Con la linea trabada en bajo no hay flanco: se reintenta por tiempo
+		if ((event_notify & RX_AVISO_INT) || intTrabada)
+		{
+			intTrabada = !canmsg_interrupt();	// Procesa la interrupcion
+
+			MTB_TRACE_DUMP();	// Vuelca la traza si hubo captura
+		}
+
+#if CAN_FILTROS_HW
+		if (filtrosPendientes)
+			filtros_aplicar();
+#endif
+
+		espera = reintentarPendientes();
+
+		TickType_t vencimiento = supervision_revisar();
+		if (vencimiento < espera)
+			espera = vencimiento;
+
+		if (intTrabada && CAN_INT_REINTENTO < espera)
+			espera = CAN_INT_REINTENTO;
+	}
+
+	vTaskDelete(NULL);
+
+	return;
+}
+
+static ERROR_t canmsg_receive(void)
+{
+	ERROR_t estado;
+	CAN_FrameRef_t ref = can_pool_alloc();
+
+	if (ref == NULL)
+	{
+		/* Sin lugar en el pool: se lee igual para liberar el buffer del mcp2515 */
+		struct can_frame descarte;
+
+		estado = mcp2515_readMessage(&descarte);
+		if (estado != ERROR_OK)
+			return estado;
+
+		DLOG(DLOG_ERROR_POOL, descarte.can_id);
+
+		return ERROR_OK;
+	}
+
+	/* Unica copia: del mcp2515 al pool */
+	estado = mcp2515_readMessage(&ref->frame);
+	if (estado != ERROR_OK)
+	{
+		can_pool_release(ref);
+
+		// Sin mensaje solo indica que ya se vaciaron los dos buffers
+		if (estado == ERROR_SPI_READ)
+			DLOG(DLOG_ERROR_SPI_LECTURA);
+		else if (estado != ERROR_NOMSG)
+			DLOG(DLOG_ERROR_LECTURA, estado);
+
+		return estado;
+	}
+
+	// Un pedido remoto lo contesta el respondedor, no es un dato
+	if (ref->frame.can_id & CAN_RTR_FLAG)
+	{
+		rtr_responder(&ref->frame);
+		can_pool_release(ref);
+
+		return ERROR_OK;
+	}
+
+	pedidos_resolver(&ref->frame);
+
+	// Notificar a los nodos suscritos
+	NotifySubscribedNodes(ref);
+	PROF_SINCE(PROF_CAN_RX_LATENCIA, rxMarca);
+	DIAG_LATENCIA(diagMarca);
+	TICKLESS_ATENDIDO();
+	DIAG_RX(can_pool_frame(ref)->can_id);
+
+	// Libera la referencia de la tarea de recepcion
+	can_pool_release(ref);
+
+	return ERROR_OK;
+}
+
+static bool canmsg_interrupt(void)
+{
+	bool liberada = false;
+
+	PROF_BEGIN(PROF_CAN_INTERRUPT);
+	MTB_TRACE_BEGIN();
+
+	/*
+	 * @note
+	 * Se configuraron por defecto interrupciones para rx0, rx1, tx, err y
+	 * merr. En la funcion de mcp2515_reset() se pueden configurar algunas
+	 * mas.
+	 *
+	 * Cada vuelta atiende todas las banderas leidas; se repite hasta que
+	 * CANINTF queda limpio para que INT vuelva a alto y el proximo evento
+	 * genere un nuevo flanco, o hasta CAN_INT_MAX_PASADAS vueltas.
+	 * */
+	for (uint8_t pasada = 0; pasada < CAN_INT_MAX_PASADAS; pasada++)
+	{
+		/* Leemos las interrupciones generadas */
+		ERROR_t error = mcp2515_getInterrupts();
+		if (error != ERROR_OK)
+		{
+			PRINTF("Fallo al leer la interrupcion\n\r");
+			break;
+		}
+
+		uint8_t flags = mcp2515_getIntFlags();
+		if ((flags & CAN_INT_ATENDIDAS) == 0)
+		{
+			liberada = true;
+			break;
+		}
+
+		/* Fin de transmision: se libero un buffer para la tarea de transmision */
+		if (flags & (CANINTF_TX0IF | CANINTF_TX1IF | CANINTF_TX2IF))
+		{
+			mcp2515_clearTXInterrupts();
+			xTaskNotifyGive(task_Transmision_Handle);
+		}
+
+		if (flags & CANINTF_ERRIF)
+		{
+			PRINTF("Error interrupt flag\n\r");
+
+			// Limpiamos la bandera
+			mcp2515_clearERRIF();
+		}
+
+		if (flags & CANINTF_MERRF)
+		{
+			PRINTF("Message error interrupt flag\n\r");
+
+			// Limpiamos la bandera
+			mcp2515_clearMERR();
+		}
+
+		if (flags & (CANINTF_RX0IF | CANINTF_RX1IF))
+		{
+			// Limpia la copia local, la lectura limpia las del mcp2515
+			mcp2515_getIntRX0IF();
+			mcp2515_getIntRX1IF();
+
+			// Vacia los dos buffers antes de volver a leer las banderas
+			ERROR_t lectura;
+			while ((lectura = canmsg_receive()) == ERROR_OK)
+				;
+
+			// La bandera sigue en 1: volver a leerla ahora no la limpia
+			if (lectura != ERROR_NOMSG)
+				break;
+		}
+	}
+
+	MTB_TRACE_END();
+	PROF_END(PROF_CAN_INTERRUPT);
+
+	return liberada;
+}
+
+static void taskRtos_Transmision(void *pvParameters)
+{
+	CAN_TxItem_t item;
+	ERROR_t estado;
+	TickType_t espera;
+
+	/* Espera a que el modulo este configurado */
+	CAN_getEvent();
+
+	espera = periodicas_despachar();
+
+	for (;;)
+	{
+		/* Sin mensajes en la cola despierta para el proximo periodico */
+		if (colaTx_sacar(&item, espera) != pdPASS)
+		{
+			espera = periodicas_despachar();
+			continue;
+		}
+
+		for (;;)
+		{
+			estado = mcp2515_sendMessage(&item.frame);
+			if (estado == ERROR_OK || item.reintentos >= CAN_TX_REINTENTOS)
+				break;
+
+			/*
+			 * Solo con los 3 buffers ocupados se espera el aviso de fin de
+			 * transmision. Si no llega a tiempo cuenta como reintento; otro
+			 * error cuenta en seguida, sin esperar.
+			 * */
+			if (estado != ERROR_ALLTXBUSY
+					|| ulTaskNotifyTake(pdTRUE, CAN_TX_ESPERA) == 0)
+			{
+				item.reintentos++;
+
+				taskENTER_CRITICAL();
+				txStats.reintentos++;
+				taskEXIT_CRITICAL();
+			}
+
+			/*
+			 * Mientras se esperaba pudo llegar algo mas prioritario: el
+			 * mensaje vuelve a la cola con sus reintentos y sale el otro.
+			 * */
+			colaTx_intercambiar(&item);
+		}
+
+		if (estado == ERROR_OK)
+		{
+			uint32_t latencia = ((xTaskGetTickCount() - item.encolado) * 1000U)
+					/ configTICK_RATE_HZ;
+
+			taskENTER_CRITICAL();
+			txStats.enviados++;
+			txStats.latenciaUltima = latencia;
+			if (latencia > txStats.latenciaMax)
+				txStats.latenciaMax = latencia;
+			txStats.latenciaTotal += latencia;
+			taskEXIT_CRITICAL();
+
+			DIAG_TX(item.frame.can_id);
+
+#if CAN_TX_LATENCIA_LOG
+			DLOG(DLOG_TX_LATENCIA, item.frame.can_id, latencia);
+#endif
+		}
+		else
+		{
+			taskENTER_CRITICAL();
+			txStats.descartados++;
+			taskEXIT_CRITICAL();
+
+			if (estado == ERROR_ALLTXBUSY)
+				DLOG(DLOG_ERROR_TX_LLENOS, item.frame.can_id);
+			else if (estado == ERROR_FAILTX)
+				DLOG(DLOG_ERROR_TX, item.frame.can_id);
+			else if (estado == ERROR_SPI_WRITE)
+				DLOG(DLOG_ERROR_SPI_ESCRITURA, item.frame.can_id);
+			else
+				DLOG(DLOG_ERROR_ENVIO, item.frame.can_id, estado);
+		}
+
+		espera = periodicas_despachar();
+	}
+
+	vTaskDelete(NULL);
+
+	return;
+}
+
+static uint32_t tx_clave(canid_t id)
+{
+	uint32_t clave;
+
+	if (id & CAN_EFF_FLAG)
+	{
+		/* Base en los 11 bits altos del id extendido, luego IDE y el resto */
+		id &= CAN_EFF_MASK;
+		clave = ((id >> 18) << 19) | (1U << 18) | (id & 0x3FFFF);
+	}
+	else
+		clave = (id & CAN_SFF_MASK) << 19;
+
+	return clave + 1;
+}
+
+static BaseType_t colaTx_cargar(CAN_TxItem_t *item, TickType_t xTicksToWait)
+{
+	// El mcp2515 la rechazaria en cada reintento
+	if (item->frame.can_dlc > CAN_MAX_DLEN)
+		return pdFAIL;
+
+	if (xSemaphoreTake(semLugaresTx, xTicksToWait) != pdPASS)
+		return pdFAIL;
+
+	item->encolado = xTaskGetTickCount();
+	item->reintentos = 0;
+
+	taskENTER_CRITICAL();
+	item->orden = colaTx.orden++;
+	memcpy(&colaTx.items[colaTx.cantidad], item, sizeof(CAN_TxItem_t));
+	colaTx_subir(colaTx.cantidad++);
+	if (colaTx.cantidad > txStats.colaMax)
+		txStats.colaMax = colaTx.cantidad;
+	taskEXIT_CRITICAL();
+
+	xSemaphoreGive(semMensajesTx);
+
+	return pdPASS;
+}
+
+static BaseType_t colaTx_sacar(CAN_TxItem_t *item, TickType_t xTicksToWait)
+{
+	BaseType_t tomado;
+
+	txEsperaCola = true;
+	if (periodicasCambio)
+		xTicksToWait = 0;
+	tomado = xSemaphoreTake(semMensajesTx, xTicksToWait);
+	txEsperaCola = false;
+
+	if (tomado != pdPASS)
+		return pdFAIL;
+
+	taskENTER_CRITICAL();
+	colaTx_envejecer(xTaskGetTickCount());
+	memcpy(item, &colaTx.items[0], sizeof(CAN_TxItem_t));
+	colaTx.cantidad--;
+	if (colaTx.cantidad > 0)
+	{
+		memcpy(&colaTx.items[0], &colaTx.items[colaTx.cantidad],
+				sizeof(CAN_TxItem_t));
+		colaTx_bajar(0);
+	}
+	taskEXIT_CRITICAL();
+
+	xSemaphoreGive(semLugaresTx);
+
+	return pdPASS;
+}
+
+static void colaTx_intercambiar(CAN_TxItem_t *item)
+{
+	CAN_TxItem_t aux;
+
+	taskENTER_CRITICAL();
+	colaTx_envejecer(xTaskGetTickCount());
+	if (colaTx.cantidad > 0 && colaTx_precede(&colaTx.items[0], item))
+	{
+		memcpy(&aux, &colaTx.items[0], sizeof(CAN_TxItem_t));
+		memcpy(&colaTx.items[0], item, sizeof(CAN_TxItem_t));
+		colaTx_bajar(0);
+		memcpy(item, &aux, sizeof(CAN_TxItem_t));
+	}
+	taskEXIT_CRITICAL();
+
+	return;
+}
+
+static void colaTx_envejecer(TickType_t ahora)
+{
+	for (uint32_t i = 0; i < colaTx.cantidad; i++)
+	{
+		CAN_TxItem_t *item = &colaTx.items[i];
+
+		if (item->clave != CAN_TX_CLAVE_ENVEJECIDO
+				&& (ahora - item->encolado) >= CAN_TX_ENVEJECIMIENTO)
+		{
+			item->clave = CAN_TX_CLAVE_ENVEJECIDO;
+			colaTx_subir(i);
+			txStats.envejecidos++;
+		}
+	}
+
+	return;
+}
+
+static bool colaTx_precede(const CAN_TxItem_t *a, const CAN_TxItem_t *b)
+{
+	if (a->clave != b->clave)
+		return a->clave < b->clave;
+
+	return (int32_t) (a->orden - b->orden) < 0;
+}
+
+static void colaTx_subir(uint32_t pos)
+{
+	CAN_TxItem_t aux;
+
+	while (pos > 0)
+	{
+		uint32_t padre = (pos - 1) / 2;
+
+		if (!colaTx_precede(&colaTx.items[pos], &colaTx.items[padre]))
+			break;
+
+		memcpy(&aux, &colaTx.items[pos], sizeof(CAN_TxItem_t));
+		memcpy(&colaTx.items[pos], &colaTx.items[padre], sizeof(CAN_TxItem_t));
+		memcpy(&colaTx.items[padre], &aux, sizeof(CAN_TxItem_t));
+		pos = padre;
+	}
+
+	return;
+}
+
+static void colaTx_bajar(uint32_t pos)
+{
+	CAN_TxItem_t aux;
+
+	for (;;)
+	{
+		uint32_t menor = pos;
+		uint32_t hijo = 2 * pos + 1;
+
+		for (uint32_t k = hijo; k < hijo + 2 && k < colaTx.cantidad; k++)
+		{
+			if (colaTx_precede(&colaTx.items[k], &colaTx.items[menor]))
+				menor = k;
+		}
+
+		if (menor == pos)
+			break;
+
+		memcpy(&aux, &colaTx.items[pos], sizeof(CAN_TxItem_t));
+		memcpy(&colaTx.items[pos], &colaTx.items[menor], sizeof(CAN_TxItem_t));
+		memcpy(&colaTx.items[menor], &aux, sizeof(CAN_TxItem_t));
+		pos = menor;
+	}
+
+	return;
+}
+
+#if CAN_ENTREGA_LOCAL
+static bool entregaLocal(const struct can_frame *frame)
+{
+	CAN_FrameRef_t ref;
+	uint32_t entregas;
+	bool remota = false;
+
+	// Los pedidos remotos siempre van al bus
+	if (frame->can_id & CAN_RTR_FLAG)
+		return false;
+
+	pedidos_resolver(frame);
+
+	if (indiceActivo->cantidad == 0)
+		return false;
+
+	ref = can_pool_alloc();
+	if (ref == NULL)
+	{
+		// Sin lugar en el pool sale por el bus como siempre
+		DLOG(DLOG_ERROR_POOL, frame->can_id);
+		return false;
+	}
+
+	memcpy(&ref->frame, frame, sizeof(struct can_frame));
+
+	/*
+	 * Sin cambiar de tarea en medio del reparto. Los avisos de la
+	 * supervision no se llaman aca: quedan para la tarea de recepcion, que
+	 * se despierta abajo.
+	 * */
+	vTaskSuspendAll();
+	entregas = NotifySubscribedNodes(ref);
+	xTaskResumeAll();
+
+	can_pool_release(ref);
+
+	if (entregas == 0)
+		return false;
+
+	// Un mensaje retenido (CAN_POLITICA_ESPERAR) lo reintenta la recepcion
+	xTaskNotify(task_Receive_Handle, RX_AVISO_REVISAR, eSetBits);
+
+	taskENTER_CRITICAL();
+	for (uint32_t i = 0; i < cantRemotas; i++)
+	{
+		if (remotas[i] == frame->can_id)
+			remota = true;
+	}
+	if (!remota && !espejo)
+		txStats.locales++;
+	taskEXIT_CRITICAL();
+
+	DIAG_RX(frame->can_id);
+	if (!remota && !espejo)
+		DIAG_TX(frame->can_id);
+
+	return !remota && !espejo;
+}
+#endif
+
+static TickType_t periodicas_despachar(void)
+{
+	TickType_t ahora = xTaskGetTickCount();
+	CAN_TxItem_t item;
+
+	// Lo publicado despues de aca vuelve a marcarlo
+	periodicasCambio = false;
+
+	for (;;)
+	{
+		taskENTER_CRITICAL();
+
+		if (cantPeriodicas == 0)
+		{
+			taskEXIT_CRITICAL();
+			return portMAX_DELAY;
+		}
+
+		CAN_Periodica_t *p = &periodicas[heapPeriodicas[0]];
+
+		if ((int32_t) (p->proximo - ahora) > 0)
+		{
+			TickType_t espera = p->proximo - ahora;
+
+			taskEXIT_CRITICAL();
+			return espera;
+		}
+
+		/* Copia en la seccion critica: el productor puede estar escribiendo */
+		memcpy(&item.frame, p->frame, sizeof(struct can_frame));
+
+		/* Si se atraso mas de un periodo no se acumulan envios */
+		p->proximo += p->periodo;
+		if ((int32_t) (p->proximo - ahora) <= 0)
+			p->proximo = ahora + p->periodo;
+		heap_bajar(0);
+
+		taskEXIT_CRITICAL();
+
+#if CAN_ENTREGA_LOCAL
+		if (entregaLocal(&item.frame))
+			continue;
+#endif
+
+		item.clave = tx_clave(item.frame.can_id);
+
+		if (colaTx_cargar(&item, 0) != pdPASS)
+		{
+			taskENTER_CRITICAL();
+			txStats.descartados++;
+			taskEXIT_CRITICAL();
+		}
+	}
+}
+
+static TickType_t periodicas_offsetAuto(TickType_t periodo, TickType_t ahora)
+{
+	TickType_t fases[CAN_MAX_PERIODICAS];
+	TickType_t mejorInicio = 0, mejorHueco = 0;
+	uint32_t n = 0;
+
+	/* Fase de cada mensaje ya cargado dentro del periodo nuevo, ordenadas */
+	for (uint32_t i = 0; i < cantPeriodicas; i++)
+	{
+		const CAN_Periodica_t *p = &periodicas[heapPeriodicas[i]];
+		TickType_t fase = (p->proximo - ahora) % periodo;
+		uint32_t j = n++;
+
+		while (j > 0 && fases[j - 1] > fase)
+		{
+			fases[j] = fases[j - 1];
+			j--;
+		}
+		fases[j] = fase;
+	}
+
+	if (n == 0)
+		return 0;
+
+	/* El centro del hueco mas grande entre fases consecutivas */
+	for (uint32_t i = 0; i < n; i++)
+	{
+		TickType_t siguiente = (i + 1 < n) ? fases[i + 1] : fases[0] + periodo;
+
+		if (siguiente - fases[i] > mejorHueco)
+		{
+			mejorHueco = siguiente - fases[i];
+			mejorInicio = fases[i];
+		}
+	}
+
+	return (mejorInicio + mejorHueco / 2) % periodo;
+}
+
+static void heap_subir(uint32_t pos)
+{
+	while (pos > 0)
+	{
+		uint32_t padre = (pos - 1) / 2;
+		uint8_t aux;
+
+		if ((int32_t) (periodicas[heapPeriodicas[pos]].proximo
+				- periodicas[heapPeriodicas[padre]].proximo) >= 0)
+			break;
+
+		aux = heapPeriodicas[pos];
+		heapPeriodicas[pos] = heapPeriodicas[padre];
+		heapPeriodicas[padre] = aux;
+		pos = padre;
+	}
+
+	return;
+}
+
+static void heap_bajar(uint32_t pos)
+{
+	for (;;)
+	{
+		uint32_t menor = pos;
+		uint32_t hijo = 2 * pos + 1;
+		uint8_t aux;
+
+		for (uint32_t k = hijo; k < hijo + 2 && k < cantPeriodicas; k++)
+		{
+			if ((int32_t) (periodicas[heapPeriodicas[k]].proximo
+					- periodicas[heapPeriodicas[menor]].proximo) < 0)
+				menor = k;
+		}
+
+		if (menor == pos)
+			break;
+
+		aux = heapPeriodicas[pos];
+		heapPeriodicas[pos] = heapPeriodicas[menor];
+		heapPeriodicas[menor] = aux;
+		pos = menor;
+	}
+
+	return;
+}
+
+static Error_Can_t rtr_registrar(canid_t id, CAN_Responder_t responder,
+		void *contexto, bool cambiar)
+{
+	Error_Can_t error = ERROR_CAN_OK;
+	uint32_t i;
+
+	xSemaphoreTake(mutexSuscripciones, portMAX_DELAY);
+
+	for (i = 0; i < cantRtr && rtrIds[i].id != id; i++)
+		;
+
+	if (i < cantRtr)
+	{
+		if (cambiar)
+		{
+			taskENTER_CRITICAL();
+			rtrIds[i].responder = responder;
+			rtrIds[i].contexto = contexto;
+			taskEXIT_CRITICAL();
+		}
+	}
+	else if (cantRtr == CAN_MAX_RTR)
+		error = ERROR_CAN_MEMORY;
+	else
+	{
+		taskENTER_CRITICAL();
+		rtrIds[i].id = id;
+		rtrIds[i].responder = responder;
+		rtrIds[i].contexto = contexto;
+		cantRtr++;
+		taskEXIT_CRITICAL();
+
+		// Filtros nuevos con la id; sin lugar en el indice se deshace el alta
+		error = indice_reconstruir();
+		if (error != ERROR_CAN_OK)
+		{
+			taskENTER_CRITICAL();
+			cantRtr--;
+			taskEXIT_CRITICAL();
+		}
+	}
+
+	xSemaphoreGive(mutexSuscripciones);
+
+	return error;
+}
+
+static bool rtr_contestar(canid_t id, struct can_frame *respuesta)
+{
+	CAN_Responder_t responder = NULL;
+	void *contexto = NULL;
+
+	taskENTER_CRITICAL();
+	for (uint32_t i = 0; i < cantRtr; i++)
+	{
+		if (rtrIds[i].id == id)
+		{
+			responder = rtrIds[i].responder;
+			contexto = rtrIds[i].contexto;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	if (responder == NULL)
+		return false;
+
+	memset(respuesta, 0, sizeof(struct can_frame));
+	respuesta->can_id = id;
+
+	return responder(respuesta, contexto);
+}
+
+static void rtr_responder(const struct can_frame *pedido)
+{
+	CAN_TxItem_t item;
+
+	if (!rtr_contestar(pedido->can_id & ~CAN_RTR_FLAG, &item.frame))
+		return;
+
+	// Quien pidio esta en el bus: no pasa por la entrega local
+	item.clave = tx_clave(item.frame.can_id);
+	if (colaTx_cargar(&item, 0) != pdPASS)
+		DLOG(DLOG_ERROR_RTR, item.frame.can_id);
+
+	return;
+}
+
+static void pedidos_resolver(const struct can_frame *frame)
+{
+	EventBits_t bits = 0, abandonados = 0;
+
+	taskENTER_CRITICAL();
+	for (uint32_t i = 0; i < CAN_MAX_PEDIDOS; i++)
+	{
+		if (pedidos[i].estado == PEDIDO_ESPERANDO
+				&& pedidos[i].id == frame->can_id)
+		{
+			memcpy(pedidos[i].respuesta, frame, sizeof(struct can_frame));
+			pedidos[i].estado = PEDIDO_AVISANDO;
+			bits |= (EventBits_t) 1 << i;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	if (bits == 0)
+		return;
+
+	// Fuera de la seccion critica: el que pide puede vencer mientras tanto
+	xEventGroupSetBits(eventosPedidos, bits);
+
+	taskENTER_CRITICAL();
+	for (uint32_t i = 0; i < CAN_MAX_PEDIDOS; i++)
+	{
+		if (!(bits & ((EventBits_t) 1 << i)))
+			continue;
+
+		if (pedidos[i].estado == PEDIDO_ABANDONADO)
+			abandonados |= (EventBits_t) 1 << i;
+		else
+			pedidos[i].estado = PEDIDO_RESUELTO;
+	}
+	taskEXIT_CRITICAL();
+
+	// Nadie espera esos bits: se borran antes de liberar los lugares
+	if (abandonados)
+	{
+		xEventGroupClearBits(eventosPedidos, abandonados);
+
+		taskENTER_CRITICAL();
+		for (uint32_t i = 0; i < CAN_MAX_PEDIDOS; i++)
+		{
+			if (abandonados & ((EventBits_t) 1 << i))
+				pedidos[i].estado = PEDIDO_LIBRE;
+		}
+		taskEXIT_CRITICAL();
+	}
+
+	return;
+}
+
+static void supervision_recibido(CANSubscription_t *sub)
+{
+	if (sub->limite == 0)
+		return;
+
+	taskENTER_CRITICAL();
+	if (sub->limite != 0)
+	{
+		rueda_armar(&ruedaSupervision, &sub->supervision,
+				xTaskGetTickCount() + sub->limite);
+		if (sub->perdida)
+		{
+			sub->recuperada = true;
+			hayRecuperadas = true;
+		}
+		sub->perdida = false;
+	}
+	taskEXIT_CRITICAL();
+
+	return;
+}
+
+static void supervision_avisarRecuperadas(void)
+{
+	bool encontrada;
+
+	if (!hayRecuperadas)
+		return;
+	hayRecuperadas = false;
+
+	/* Uno por vez: el aviso se llama sin retener el indice */
+	do
+	{
+		CAN_Supervisor_t aviso = NULL;
+		void *contexto = NULL;
+		uint16_t nodeId = 0;
+		const CAN_Indice_t *idx = indice_tomar();
+
+		encontrada = false;
+
+		taskENTER_CRITICAL();
+		for (uint32_t i = 0; i < idx->cantidad && !encontrada; i++)
+		{
+			CANSubscription_t *sub = idx->subs[i];
+
+			if (sub->recuperada)
+			{
+				sub->recuperada = false;
+				encontrada = true;
+				nodeId = sub->nodeId;
+				aviso = sub->aviso;
+				contexto = sub->avisoContexto;
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		indice_soltar(idx);
+
+		if (encontrada)
+		{
+			DLOG(DLOG_SENAL_RECUPERADA, nodeId);
+			if (aviso != NULL)
+				aviso(nodeId, true, contexto);
+		}
+	} while (encontrada);
+
+	return;
+}
+
+static TickType_t supervision_revisar(void)
+{
+	RuedaNodo_t *nodo;
+	uint32_t espera = RUEDA_SIN_VENCIMIENTOS;
+
+	supervision_avisarRecuperadas();
+
+	/* Uno por vez: el aviso se llama fuera de la seccion critica */
+	do
+	{
+		CAN_Supervisor_t aviso = NULL;
+		void *contexto = NULL;
+		uint16_t nodeId = 0;
+		TickType_t limite = 0;
+
+		taskENTER_CRITICAL();
+		TickType_t ahora = xTaskGetTickCount();
+
+		nodo = rueda_vencido(&ruedaSupervision, ahora);
+		if (nodo != NULL)
+		{
+			CANSubscription_t *sub = (CANSubscription_t*) ((uint8_t*) nodo
+					- offsetof(CANSubscription_t, supervision));
+
+			sub->perdida = true;
+			sub->perdidas++;
+			nodeId = sub->nodeId;
+			limite = sub->limite;
+			aviso = sub->aviso;
+			contexto = sub->avisoContexto;
+		}
+		else
+			espera = rueda_espera(&ruedaSupervision, ahora);
+		taskEXIT_CRITICAL();
+
+		if (nodo != NULL)
+		{
+			DLOG(DLOG_SENAL_PERDIDA, nodeId,
+					(uint32_t) (limite * portTICK_PERIOD_MS));
+			if (aviso != NULL)
+				aviso(nodeId, false, contexto);
+		}
+	} while (nodo != NULL);
+
+	return (espera == RUEDA_SIN_VENCIMIENTOS) ?
+			portMAX_DELAY : (TickType_t) espera;
+}
+
+static uint32_t NotifySubscribedNodes(CAN_FrameRef_t ref)
+{
+	uint32_t entregas = 0;
+
+	PROF_BEGIN(PROF_CAN_FANOUT);
+
+	const CAN_Indice_t *idx = indice_tomar();
+	canid_t canId = can_pool_frame(ref)->can_id;
+	const CAN_IndiceSlot_t *slot = indice_buscar(idx, canId);
+
+	if (slot != NULL)
+	{
+		for (uint32_t i = slot->inicio; i < slot->inicio + slot->cantidad;
+				i++)
+		{
+			// Una referencia por suscriptor, el mensaje no se copia
+			can_pool_retain(ref);
+			entregar(idx->subs[i], ref);
+			entregas++;
+		}
+	}
+
+	// Suscripciones con mascara: solo las de la cubeta de la id
+	if (!(canId & CAN_EFF_FLAG))
+	{
+		uint32_t cubeta = CAN_CUBETA(canId);
+
+		for (uint32_t i = idx->cubetas[cubeta]; i < idx->cubetas[cubeta + 1];
+				i++)
+		{
+			CANSubscription_t *sub = idx->mascaras[i];
+
+			if (((canId ^ sub->nodeId) & sub->mascara) == 0)
+			{
+				can_pool_retain(ref);
+				entregar(sub, ref);
+				entregas++;
+			}
+		}
+	}
+
+	indice_soltar(idx);
+
+	PROF_END(PROF_CAN_FANOUT);
+
+	return entregas;
+}
+
+static void perifericos_init(void)
+{
+	ERROR_t error;
+
+	mcp2515_init();
+
+	error = mcp2515_reset();
+	if (error != ERROR_OK)
+		PRINTF("Fallo al resetear el modulo\n\r");
+
+	error = mcp2515_setBitrate(CAN_125KBPS, MCP_8MHZ);
+	if (error != ERROR_OK)
+		PRINTF("Fallo al setear el bit rate\n\r");
+
+	error = modo_operacion();
+	if (error != ERROR_OK)
+		PRINTF("Fallo al setear el modo de operacion\n\r");
+
+	return;
+}
 
-extern void CAN_init(void)
+void PORTA_IRQHandler(void)
 {
-	/* Inicializacion de queue de transmision. */
-	queue_Transmision = xQueueCreate(QUEUE_TRANSMISION_LENGTH,
-			QUEUE_TRANSMISION_SIZE);
-	if (queue_Transmision == NULL)
-		PRINTF("\n\rFallo al crear la cola de datos.\n\r");
+#if USE_FREERTOS
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+#endif
 
-	/* Inicializacion de tarea de recepcion. */
-	BaseType_t status = xTaskCreate(taskRtos_Receive, "Task Read can",
-	configMINIMAL_STACK_SIZE + 50, NULL, configMAX_PRIORITIES,
-			&task_Receive_Handle);
-	if (status != pdTRUE)
-		PRINTF("Fallo al crear la tarea.\n\r");
+	// Obtiene el estado de las banderas de interrupción del puerto A
+	uint32_t interruptFlags = GPIO_GetPinsInterruptFlags(GPIOA);
 
-	/* Inicializacion de timer. */
-	timer_Transimision = xTimerCreate("Timer transmision",
-	TIMER_TRANSMISION_PERIOD_MS, pdTRUE, NULL, timerRtos_Transmision);
-	if (timer_Transimision == NULL)
-		PRINTF("\n\rFallo al crear el timer.\n\r");
+	if (interruptFlags & (1U << PIN_NUMBER))
+	{
+		PROF_MARK(rxMarca);
+		DIAG_MARCA(diagMarca);
 
-	/* Creamos el evento de sincronizacion. */
-	xInitEventGroup = xEventGroupCreate();
+#if USE_FREERTOS
+		xTaskNotifyFromISR(task_Receive_Handle, RX_AVISO_INT, eSetBits,
+				&xHigherPriorityTaskWoken);
+#else
+			Rx_flag_mcp2515 = true;
+#endif
+		GPIO_ClearPinsInterruptFlags(GPIOA, 1U << PIN_NUMBER);
+	}
+
+#if USE_FREERTOS
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+#endif
 
 	return;
 }
 
-extern Error_Can_t CAN_Subscribe(uint16_t nodeId, TaskHandle_t taskHandle)
+static void entregar(CANSubscription_t *sub, CAN_FrameRef_t ref)
 {
-	CANSubscription_t *newSubscription = pvPortMalloc(
-			sizeof(CANSubscription_t));
-	if (newSubscription == NULL)
+	CAN_FrameRef_t descartado = NULL;
+	BaseType_t status = pdFAIL;
+
+	// La senal esta presente aunque la politica descarte el mensaje
+	supervision_recibido(sub);
+
+	switch (sub->politica)
 	{
-		return ERROR_CAN_MEMORY;
+	case CAN_POLITICA_SOBRESCRIBIR:
+		// Pisa el buzon y libera el mensaje anterior
+		taskENTER_CRITICAL();
+		if (xQueueReceive(sub->queueHandle, &descartado, 0) != pdPASS)
+			descartado = NULL;
+		status = xQueueOverwrite(sub->queueHandle, &ref);
+		sub->secuencia++;
+		taskEXIT_CRITICAL();
+		break;
+
+	case CAN_POLITICA_DESCARTAR_VIEJO:
+		status = xQueueSendToBack(sub->queueHandle, &ref, 0);
+		if (status != pdPASS)
+		{
+			// Hace lugar sacando el mas viejo
+			if (xQueueReceive(sub->queueHandle, &descartado, 0) != pdPASS)
+				descartado = NULL;
+			status = xQueueSendToBack(sub->queueHandle, &ref, 0);
+		}
+		break;
+
+	case CAN_POLITICA_ESPERAR:
+		// Solo entra a la cola si no hay uno retenido antes
+		if (!entregarPendiente(sub, xTaskGetTickCount()))
+		{
+			status = xQueueSendToBack(sub->queueHandle, &ref, 0);
+			if (status != pdPASS)
+			{
+				sub->pendiente = ref;
+				sub->vencimiento = xTaskGetTickCount() + sub->plazo;
+				return;
+			}
+		}
+		break;
+
+	case CAN_POLITICA_DESCARTAR_NUEVO:
+	default:
+		status = xQueueSendToBack(sub->queueHandle, &ref, 0);
+		break;
 	}
 
-	newSubscription->nodeId = nodeId;
-	newSubscription->taskHandle = taskHandle;
+	if (status == pdPASS)
+	{
+		if (sub->politica != CAN_POLITICA_SOBRESCRIBIR)
+			sub->secuencia++;
 
-	// Crear una cola específica para este nodo
-	newSubscription->queueHandle = xQueueCreate(QUEUE_RECEIVE_LENGTH,
-			QUEUE_RECEIVE_SIZE);
-	if (newSubscription->queueHandle == NULL)
+		// Notificar al nodo
+		xTaskNotify(sub->taskHandle, 0, eIncrement);
+
+		UBaseType_t enCola = uxQueueMessagesWaiting(sub->queueHandle);
+		if (enCola > rxColaMax)
+			rxColaMax = enCola;
+	}
+	else
 	{
-		vPortFree(newSubscription);
-		return ERROR_CAN_MEMORY;
+		descartado = ref;
 	}
 
-	newSubscription->next = subscriptionList;
-	subscriptionList = newSubscription;
+	if (descartado != NULL)
+	{
+		sub->descartados++;
+		can_pool_release(descartado);
+	}
 
-	return ERROR_CAN_OK;
+	return;
 }
 
-extern Error_Can_t CAN_Unsubscribe(uint16_t nodeId, TaskHandle_t taskHandle)
+static bool entregarPendiente(CANSubscription_t *sub, TickType_t ahora)
 {
-	CANSubscription_t **current = &subscriptionList;
+	if (sub->pendiente == NULL)
+		return false;
 
-	while (*current != NULL)
+	if (xQueueSendToBack(sub->queueHandle, &sub->pendiente, 0) == pdPASS)
 	{
-		if ((*current)->nodeId == nodeId
-				&& (*current)->taskHandle == taskHandle)
-		{
-			CANSubscription_t *toDelete = *current;
-			*current = (*current)->next;
-
-			// Eliminar la cola específica del nodo
-			vQueueDelete(toDelete->queueHandle);
+		sub->pendiente = NULL;
+		sub->secuencia++;
+		xTaskNotify(sub->taskHandle, 0, eIncrement);
 
-			vPortFree(toDelete);
+		return false;
+	}
 
-			return ERROR_CAN_OK;
-		}
+	// Vencio el plazo: se descarta
+	if ((int32_t) (ahora - sub->vencimiento) >= 0)
+	{
+		can_pool_release(sub->pendiente);
+		sub->pendiente = NULL;
+		sub->descartados++;
 
-		current = &(*current)->next;
+		return false;
 	}
 
-	return ERROR_CAN_NOT_FOUND;
+	return true;
 }
 
-extern Error_Can_t CAN_sendMsg(struct can_frame *dato, TickType_t xTicksToWait)
+static TickType_t reintentarPendientes(void)
 {
-	configASSERT(queue_Transmision != NULL);
+	const CAN_Indice_t *idx = indice_tomar();
+	TickType_t ahora = xTaskGetTickCount();
+	bool hayPendientes = false;
 
-	BaseType_t status = xQueueSendToBack(queue_Transmision, dato,
-			xTicksToWait);
-	if (status != pdPASS)
+	for (uint32_t i = 0; i < idx->cantidad; i++)
 	{
-		PRINTF("\n\rFallo al cargar datos en la cola.\n\r");
-		return ERROR_CAN_QUEUETX;
+		if (entregarPendiente(idx->subs[i], ahora))
+			hayPendientes = true;
 	}
 
-	return ERROR_CAN_OK;
+	indice_soltar(idx);
+
+	return hayPendientes ? CAN_RX_REINTENTO : portMAX_DELAY;
 }
 
-extern Error_Can_t CAN_readMsg(struct can_frame *dato, uint16_t nodeId,
-		TaskHandle_t taskHandle)
+#if RTOS_ESTATICO
+static CANSubscription_t* sub_reservar(UBaseType_t largo)
 {
-	CANSubscription_t *current = subscriptionList;
+	CANSubscription_t *sub = NULL;
+	uint32_t i;
 
-	// Buscar la cola correspondiente al nodo
-	while (current != NULL)
+	taskENTER_CRITICAL();
+	for (i = 0; i < CAN_INDICE_MAX_SUBS; i++)
 	{
-		if (current->nodeId == nodeId && current->taskHandle == taskHandle)
+		if (subsPool[i].queueHandle == NULL)
 		{
-			// Leer el mensaje de la cola específica del nodo
-			BaseType_t status = xQueueReceive(current->queueHandle, dato,
-					pdMS_TO_TICKS(200));
-			if (status != pdPASS)
-			{
-//				PRINTF("\n\rFallo al recibir datos de la cola.\n\r");
-				return ERROR_CAN_QUEUERX;
-			}
-			return ERROR_CAN_OK;
+			sub = &subsPool[i];
+			// Marca ocupado hasta crear la cola
+			sub->queueHandle = (QueueHandle_t) &subsColas[i];
+			break;
 		}
-		current = current->next;
 	}
+	taskEXIT_CRITICAL();
 
-	return ERROR_CAN_NOT_FOUND;
+	if (sub == NULL)
+		return NULL;
+
+	sub->queueHandle = xQueueCreateStatic(largo, QUEUE_RECEIVE_SIZE,
+			subsDatos[i], &subsColas[i]);
+
+	return sub;
 }
 
-extern void CAN_getEvent(void)
+static void sub_liberar(CANSubscription_t *sub)
 {
-	// Esperar a que se complete la inicialización (bloqueante)
-	xEventGroupWaitBits(xInitEventGroup, INIT_COMPLETE_EVENT, pdFALSE, pdTRUE,
-	portMAX_DELAY);
+	vQueueDelete(sub->queueHandle);
+
+	taskENTER_CRITICAL();
+	sub->queueHandle = NULL;
+	taskEXIT_CRITICAL();
 
 	return;
 }
-/*
- * ===========================================
- * =			PRIVATE FUNCTIONS			 =
- * ===========================================
- */
+#else
+static CANSubscription_t* sub_reservar(UBaseType_t largo)
+{
+	CANSubscription_t *sub = pvPortMalloc(sizeof(CANSubscription_t));
+	if (sub == NULL)
+		return NULL;
 
-static void taskRtos_Receive(void *pvParameters)
+	sub->queueHandle = xQueueCreate(largo, QUEUE_RECEIVE_SIZE);
+	if (sub->queueHandle == NULL)
+	{
+		vPortFree(sub);
+		return NULL;
+	}
+
+	return sub;
+}
+
+static void sub_liberar(CANSubscription_t *sub)
 {
-	uint32_t event_notify;
+	vQueueDelete(sub->queueHandle);
+	vPortFree(sub);
 
-	/* Configura de can */
-	CAN_PERIFERICOS_INIT();	// Inicializacion de los perifericos
-	__delay_ms(5);
+	return;
+}
+#endif
 
-	CAN_INTERRUPT_INIT();	// Inicializacion de las interrupciones
-	__delay_ms(5);
+static Error_Can_t subscribir(uint16_t nodeId, uint16_t mascara,
+		TaskHandle_t taskHandle, CAN_Politica_t politica, TickType_t plazo)
+{
+	// Con una cola especifica para este nodo (de un lugar si es buzon)
+	CANSubscription_t *newSubscription = sub_reservar(
+			(politica == CAN_POLITICA_SOBRESCRIBIR) ? 1 : QUEUE_RECEIVE_LENGTH);
+	if (newSubscription == NULL)
+	{
+		return ERROR_CAN_MEMORY;
+	}
 
-	BaseType_t status = xTimerStart(timer_Transimision, portMAX_DELAY);
-	if (status != pdPASS)
-		PRINTF("Fallo al inciar el timer.\n\r");
+	newSubscription->nodeId = nodeId;
+	newSubscription->mascara = mascara;
+	newSubscription->taskHandle = taskHandle;
+	newSubscription->politica = politica;
+	newSubscription->plazo = plazo;
+	newSubscription->pendiente = NULL;
+	newSubscription->secuencia = 0;
+	newSubscription->descartados = 0;
+	newSubscription->supervision.anterior = NULL;
+	newSubscription->limite = 0;
+	newSubscription->perdida = false;
+	newSubscription->recuperada = false;
+	newSubscription->perdidas = 0;
+
+	xSemaphoreTake(mutexSuscripciones, portMAX_DELAY);
 
-	// Establecer el evento de inicialización completa
-	xEventGroupSetBits(xInitEventGroup, INIT_COMPLETE_EVENT);
+	newSubscription->next = subscriptionList;
+	subscriptionList = newSubscription;
 
-	for (;;)
+	// Sin lugar en el indice se deshace el alta
+	if (indice_reconstruir() != ERROR_CAN_OK)
 	{
-		xTaskNotifyWait(0, 0, &event_notify, portMAX_DELAY);
+		subscriptionList = newSubscription->next;
+		xSemaphoreGive(mutexSuscripciones);
+
+		sub_liberar(newSubscription);
+		return ERROR_CAN_MEMORY;
+	}
 
-		if (event_notify > 0)
+	xSemaphoreGive(mutexSuscripciones);
+
+	return ERROR_CAN_OK;
+}
+
+static CANSubscription_t* buscarSubscripcion(uint16_t nodeId,
+		TaskHandle_t taskHandle)
+{
+	const CAN_Indice_t *idx = indice_tomar();
+	const CAN_IndiceSlot_t *slot = indice_buscar(idx, nodeId);
+	uint32_t cubeta = CAN_CUBETA(nodeId);
+	CANSubscription_t *sub = NULL;
+
+	// Buscar la cola correspondiente al nodo entre los de la id
+	if (slot != NULL)
+	{
+		for (uint32_t i = slot->inicio; i < slot->inicio + slot->cantidad;
+				i++)
 		{
-			canmsg_interrupt();	// Procesa la interrupcion
-			event_notify--;
+			if (idx->subs[i]->taskHandle == taskHandle)
+			{
+				sub = idx->subs[i];
+				break;
+			}
 		}
 	}
 
-	vTaskDelete(NULL);
+	// Una suscripcion con mascara esta siempre en la cubeta de su id
+	for (uint32_t i = idx->cubetas[cubeta];
+			sub == NULL && i < idx->cubetas[cubeta + 1]; i++)
+	{
+		if (idx->mascaras[i]->nodeId == nodeId
+				&& idx->mascaras[i]->taskHandle == taskHandle)
+			sub = idx->mascaras[i];
+	}
 
-	return;
+	/*
+	 * La subscripcion sigue valida despues de soltar el indice: solo la
+	 * libera CAN_Unsubscribe() de la misma tarea.
+	 * */
+	indice_soltar(idx);
+
+	return sub;
 }
 
-static void canmsg_receive(void)
+static uint32_t indice_hash(uint16_t id)
 {
-	ERROR_t estado;
+	/* Mezcla los bits altos de la id de 11 bits con los bajos */
+	return (id ^ (id >> 5)) & (CAN_INDICE_SLOTS - 1);
+}
 
-	estado = mcp2515_readMessage(&canMsg_Receive);
-	if (estado != ERROR_OK)
+static const CAN_IndiceSlot_t* indice_buscar(const CAN_Indice_t *idx,
+		uint16_t id)
+{
+	uint32_t pos = indice_hash(id);
+
+	for (uint32_t n = 0; n < CAN_INDICE_SLOTS; n++)
 	{
-		if (estado == ERROR_SPI_READ)
-			PRINTF("\n\rFallo al leer el spi.\n\r");
-		else if (estado == ERROR_NOMSG)
-			PRINTF("\n\rFallo no hubo mensajes.\n\r");
-		else
-			PRINTF("\n\rFallo al leer el modulo can.\n\r");
+		const CAN_IndiceSlot_t *slot = &idx->slots[pos];
 
-		return;
+		if (slot->id == id)
+			return slot;
+		if (slot->id == CAN_INDICE_VACIO)
+			return NULL;
+
+		pos = (pos + 1) & (CAN_INDICE_SLOTS - 1);
 	}
 
-	// Notificar a los nodos suscritos
-	NotifySubscribedNodes(canMsg_Receive.can_id);
+	return NULL;
+}
+
+static const CAN_Indice_t* indice_tomar(void)
+{
+	const CAN_Indice_t *idx;
+
+	// Sin que se publique otro entre la lectura y la cuenta
+	taskENTER_CRITICAL();
+	idx = indiceActivo;
+	indiceLectores[idx - indices]++;
+	taskEXIT_CRITICAL();
+
+	return idx;
+}
+
+static void indice_soltar(const CAN_Indice_t *idx)
+{
+	taskENTER_CRITICAL();
+	indiceLectores[idx - indices]--;
+	taskEXIT_CRITICAL();
 
 	return;
 }
 
-static void canmsg_interrupt(void)
+static Error_Can_t indice_reconstruir(void)
 {
-	// Código que se ejecutará cuando ocurra la interrupción
+	const CAN_Indice_t *anterior = indiceActivo;
+	CAN_Indice_t *nuevo =
+			(indiceActivo == &indices[0]) ? &indices[1] : &indices[0];
+	CANSubscription_t *current, *otro;
+	uint32_t ids = 0, total = 0, entradas = 0;
+
+	for (uint32_t i = 0; i < CAN_INDICE_SLOTS; i++)
+		nuevo->slots[i].id = CAN_INDICE_VACIO;
 
 	/*
-	 * @note
-	 * Se configuraron por defecto interrupciones para rx0, rx1, err, merr. En la
-	 * funcion de mcp2515_reset() se pueden configurar algunas mas.
+	 * Cada id se agrega la primera vez que aparece en la lista, junto con
+	 * todos sus suscriptores, para que queden contiguos en subs.
 	 * */
+	for (current = subscriptionList; current != NULL; current = current->next)
+	{
+		if (current->mascara != CAN_SFF_MASK)
+			continue;
 
-	/* Leemos las interrupciones generadas */
-	__delay_ms(10);
+		uint32_t pos = indice_hash(current->nodeId);
 
-	ERROR_t error = mcp2515_getInterrupts();
+		while (nuevo->slots[pos].id != CAN_INDICE_VACIO
+				&& nuevo->slots[pos].id != current->nodeId)
+			pos = (pos + 1) & (CAN_INDICE_SLOTS - 1);
 
-	if (error != ERROR_OK)
-		PRINTF("Fallo al leer la interrupcion\n\r");
+		if (nuevo->slots[pos].id == current->nodeId)
+			continue;
 
-	/* Detectamos las que nos sirvan */
-	if (mcp2515_getIntERRIF())
-	{
-		// Acciones ...
-		PRINTF("Error interrupt flag\n\r");
+		// Siempre queda al menos una posicion vacia para cortar la busqueda
+		if (ids == CAN_INDICE_SLOTS - 1)
+			return ERROR_CAN_MEMORY;
+		ids++;
 
-		// Limpiamos la bandera
-		mcp2515_clearERRIF();
-	}
-	else if (mcp2515_getIntMERRF())
-	{
-		// Acciones ...
-		PRINTF("Message error interrupt flag\n\r");
+		nuevo->slots[pos].id = current->nodeId;
+		nuevo->slots[pos].inicio = (uint8_t) total;
+		nuevo->slots[pos].cantidad = 0;
 
-		// Limpiamos la bandera
-		mcp2515_clearMERR();
+		for (otro = current; otro != NULL; otro = otro->next)
+		{
+			if (otro->nodeId != current->nodeId
+					|| otro->mascara != CAN_SFF_MASK)
+				continue;
+			if (total == CAN_INDICE_MAX_SUBS)
+				return ERROR_CAN_MEMORY;
+
+			nuevo->subs[total++] = otro;
+			nuevo->slots[pos].cantidad++;
+		}
 	}
-	else if (mcp2515_getIntRX0IF() || mcp2515_getIntRX1IF())
+
+	/* Las suscripciones con mascara van despues de las exactas */
+	for (current = subscriptionList; current != NULL; current = current->next)
 	{
-		// Acciones ...
-		canmsg_receive();	// Procesa la informacion
+		if (current->mascara == CAN_SFF_MASK)
+			continue;
+		if (total == CAN_INDICE_MAX_SUBS)
+			return ERROR_CAN_MEMORY;
 
-		// Limpia banderas de interrupcion
+		nuevo->subs[total++] = current;
 	}
-	else
+
+	nuevo->cantidad = total;
+
+	/*
+	 * Cada suscripcion con mascara se agrega a las cubetas cuyos bits
+	 * altos coinciden con los de su id en los bits que fija la mascara.
+	 * */
+	for (uint32_t cubeta = 0; cubeta < CAN_CUBETAS; cubeta++)
 	{
-		PRINTF("\n\rFallo al detectar la interrupcion.\n\r");
+		nuevo->cubetas[cubeta] = (uint8_t) entradas;
+
+		for (current = subscriptionList; current != NULL;
+				current = current->next)
+		{
+			if (current->mascara == CAN_SFF_MASK
+					|| (((cubeta << 7) ^ current->nodeId) & current->mascara
+							& CAN_CUBETA_BITS) != 0)
+				continue;
+			if (entradas == CAN_INDICE_MAX_MASCARAS)
+				return ERROR_CAN_MEMORY;
+
+			nuevo->mascaras[entradas++] = current;
+		}
 	}
+	nuevo->cubetas[CAN_CUBETAS] = (uint8_t) entradas;
 
-	return;
+	filtros_calcular(nuevo);
+
+	/*
+	 * Publica el indice nuevo. Un lector que tomo el anterior lo termina
+	 * de recorrer antes de que se vuelva: recien ahi se puede reescribir
+	 * esa copia o liberar lo que ya no figura en el indice nuevo.
+	 * */
+	indiceActivo = nuevo;
+
+	while (indiceLectores[anterior - indices] != 0)
+		vTaskDelay(1);
+
+#if CAN_FILTROS_HW
+	// La tarea de recepcion carga los filtros nuevos
+	filtrosPendientes = true;
+	if (task_Receive_Handle != NULL)
+		xTaskNotify(task_Receive_Handle, RX_AVISO_REVISAR, eSetBits);
+#endif
+
+	return ERROR_CAN_OK;
 }
 
-static void timerRtos_Transmision(TimerHandle_t xTimer)
+static void filtros_calcular(CAN_Indice_t *idx)
 {
-	configASSERT(queue_Transmision != NULL);
-
-	if (uxQueueMessagesWaiting(queue_Transmision) > 0)
+	/* Estatico: se llama con el mutex tomado y desde tareas con poca pila */
+	static struct
 	{
-		BaseType_t status = xQueueReceive(queue_Transmision,
-				&canMsg_Transmision, pdMS_TO_TICKS(200));
-		if (status != pdPASS)
-			PRINTF("\n\rFallo al recivir dato de la cola.\n\r");
+		uint16_t id;
+		uint16_t mascara;
+	} grupos[CAN_INDICE_SLOTS + CAN_INDICE_MAX_SUBS + CAN_MAX_RTR];
+	CAN_FiltrosHw_t *f = &idx->filtros;
+	uint32_t n = 0;
+
+	/* Un grupo por id exacta y uno por suscripcion con mascara */
+	for (uint32_t i = 0; i < CAN_INDICE_SLOTS; i++)
+	{
+		if (idx->slots[i].id == CAN_INDICE_VACIO)
+			continue;
+		grupos[n].id = idx->slots[i].id & CAN_SFF_MASK;
+		grupos[n].mascara = CAN_SFF_MASK;
+		n++;
+	}
+	for (uint32_t i = 0; i < idx->cantidad; i++)
+	{
+		if (idx->subs[i]->mascara == CAN_SFF_MASK)
+			continue;
+		grupos[n].id = idx->subs[i]->nodeId;
+		grupos[n].mascara = idx->subs[i]->mascara;
+		n++;
+	}
+	/* Ids con respondedor o pedidas: pedidos remotos y respuestas */
+	for (uint32_t i = 0; i < cantRtr; i++)
+	{
+		if (rtrIds[i].id & CAN_EFF_FLAG)
+			continue;
+		grupos[n].id = rtrIds[i].id & CAN_SFF_MASK;
+		grupos[n].mascara = CAN_SFF_MASK;
+		n++;
+	}
 
-		ERROR_t estado;
+	/* Sin suscripciones no se filtra */
+	if (n == 0)
+	{
+		memset(f, 0, sizeof(CAN_FiltrosHw_t));
+		return;
+	}
 
-		estado = mcp2515_sendMessage(&canMsg_Transmision);
+	/* Une el par que conserva mas bits de mascara hasta que entren */
+	while (n > CAN_FILTROS_CANT)
+	{
+		uint32_t mejorI = 0, mejorJ = 1, mejorBits = 0;
 
-		if (estado != ERROR_OK)
+		for (uint32_t i = 0; i < n; i++)
 		{
-			if (estado == ERROR_ALLTXBUSY)
-				PRINTF("\n\rError: buffers de transmision llenos.\n\r");
-			else if (estado == ERROR_FAILTX)
-				PRINTF("\n\rError: fallo al transmitir.\n\r");
-			else if (estado == ERROR_SPI_WRITE)
-				PRINTF("\n\rError: fallo en escritura de spi.\n\r");
-			else
-				PRINTF("\nError al enviar\n\r");
-
-			/* Vuelve a cargar el mensaje en la cola si es posible. */
-			BaseType_t status = xQueueSendToFront(queue_Transmision,
-					&canMsg_Transmision, pdMS_TO_TICKS(200));
-			if (status != pdPASS)
+			for (uint32_t j = i + 1; j < n; j++)
 			{
-				PRINTF("\n\rFallo al cargar datos en la cola.\n\r");
-				return;
+				uint16_t m = grupos[i].mascara & grupos[j].mascara
+						& ~(grupos[i].id ^ grupos[j].id);
+				uint32_t bits = 0;
+
+				for (; m; m &= m - 1)
+					bits++;
+				if (bits >= mejorBits)
+				{
+					mejorBits = bits;
+					mejorI = i;
+					mejorJ = j;
+				}
 			}
 		}
-	}
-	else
-	{
-		// Acciones si no hay mensajes en el buffer
-	}
-
-	return;
-}
 
-static void NotifySubscribedNodes(uint16_t nodeId)
-{
-	CANSubscription_t *current = subscriptionList;
-	struct can_frame messageCopy;
+		grupos[mejorI].mascara &= grupos[mejorJ].mascara
+				& ~(grupos[mejorI].id ^ grupos[mejorJ].id);
+		grupos[mejorI].id &= grupos[mejorI].mascara;
+		grupos[mejorJ] = grupos[--n];
+	}
 
-	while (current != NULL)
+	/*
+	 * Los dos primeros grupos van a RXB0 y el resto a RXB1 (si no hay
+	 * resto, RXB1 repite los de RXB0). La mascara de cada buffer es la
+	 * interseccion de las de sus grupos; los filtros sobrantes repiten el
+	 * ultimo grupo del buffer.
+	 * */
+	for (uint32_t b = 0; b < 2; b++)
 	{
-		if (current->nodeId == nodeId)
+		uint32_t desde = (b == 0 || n <= CAN_FILTROS_RXB0) ? 0 :
+		CAN_FILTROS_RXB0;
+		uint32_t hasta = (b == 0 && n > CAN_FILTROS_RXB0) ?
+		CAN_FILTROS_RXB0 : n;
+		uint32_t primero = (b == 0) ? 0 : CAN_FILTROS_RXB0;
+		uint32_t cantidad = (b == 0) ?
+		CAN_FILTROS_RXB0 : (CAN_FILTROS_CANT - CAN_FILTROS_RXB0);
+
+		f->mascara[b] = CAN_SFF_MASK;
+		for (uint32_t g = desde; g < hasta; g++)
+			f->mascara[b] &= grupos[g].mascara;
+
+		for (uint32_t k = 0; k < cantidad; k++)
 		{
-			// Hacer una copia del mensaje para cada nodo
-			memcpy(&messageCopy, &canMsg_Receive, sizeof(struct can_frame));
-
-			// Enviar el mensaje a la cola específica del nodo
-			xQueueSendToBack(current->queueHandle, &messageCopy,
-					pdMS_TO_TICKS(200));
+			uint32_t g = desde + k;
 
-			// Notificar al nodo
-			xTaskNotify(current->taskHandle, 0, eIncrement);
+			if (g >= hasta)
+				g = hasta - 1;
+			f->filtro[primero + k] = grupos[g].id & f->mascara[b];
 		}
-		current = current->next;
 	}
+
+	return;
 }
 
-static void perifericos_init(void)
+#if CAN_FILTROS_HW
+static void filtros_aplicar(void)
 {
-	ERROR_t error;
+	// Copia: cargarlos por spi lleva tiempo y el indice no se retiene
+	const CAN_Indice_t *idx = indice_tomar();
+	const CAN_FiltrosHw_t filtros = idx->filtros;
+	const CAN_FiltrosHw_t *f = &filtros;
+	ERROR_t error = ERROR_OK;
 
-	mcp2515_init();
+	indice_soltar(idx);
 
-	error = mcp2515_reset();
-	if (error != ERROR_OK)
-		PRINTF("Fallo al resetear el modulo\n\r");
+	filtrosPendientes = false;
 
-	error = mcp2515_setBitrate(CAN_125KBPS, MCP_8MHZ);
-	if (error != ERROR_OK)
-		PRINTF("Fallo al setear el bit rate\n\r");
+	/* Solo se pueden cargar en modo configuracion */
+	if (mcp2515_setFilterMask(MASK0, false, f->mascara[0]) != ERROR_OK
+			|| mcp2515_setFilterMask(MASK1, false, f->mascara[1]) != ERROR_OK)
+		error = ERROR_FAIL;
+
+	for (uint32_t i = 0; i < CAN_FILTROS_CANT && error == ERROR_OK; i++)
+		error = mcp2515_setFilter((RXF) i, false, f->filtro[i]);
 
-//	error = mcp2515_setNormalMode();
-//	if (error != ERROR_OK)
-//		PRINTF("Fallo al setear el modo normal\n\r");
-	error = mcp2515_setLoopbackMode();
 	if (error != ERROR_OK)
-		PRINTF("Fallo al setear el loopback mode\n\r");
+		PRINTF("Fallo al cargar los filtros\n\r");
+
+	if (modo_operacion() != ERROR_OK)
+		PRINTF("Fallo al volver al modo de operacion\n\r");
 
 	return;
 }
+#endif /* CAN_FILTROS_HW */
 
-void PORTA_IRQHandler(void)
+static ERROR_t modo_operacion(void)
 {
-#if USE_FREERTOS
-	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-#endif
-
-	// Obtiene el estado de las banderas de interrupción del puerto A
-	uint32_t interruptFlags = GPIO_GetPinsInterruptFlags(GPIOA);
-
-	if (interruptFlags & (1U << PIN_NUMBER))
-	{
-#if USE_FREERTOS
-		xTaskNotifyFromISR(task_Receive_Handle, 0, eIncrement,
-				&xHigherPriorityTaskWoken);
+#if CAN_MODO_LOOPBACK
+	return mcp2515_setLoopbackMode();
 #else
-			Rx_flag_mcp2515 = true;
+	return mcp2515_setNormalMode();
 #endif
-		GPIO_ClearPinsInterruptFlags(GPIOA, 1U << PIN_NUMBER);
-	}
-
-#if USE_FREERTOS
-	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
-#endif
-
-	return;
 }
@@ -12,6 +12,42 @@
 #include "task.h"
 
 #include "can.h"
+#include "can_pool.h"
+
+/**
+ * @brief Habilitacion de la medicion de costo del fan-out (CAN_benchFanout).
+ *
+ * Requiere PROF_ENABLE.
+ */
+#ifndef CAN_BENCH_FANOUT
+#define CAN_BENCH_FANOUT	0
+#endif
+
+#define CAN_BENCH_ID			0x7F0
+#define CAN_BENCH_MAX_SUBS		8
+#define CAN_BENCH_REPETICIONES	100
+
+/**
+ * @brief Entrega directa a los suscriptores del mismo micro.
+ *
+ * Con '1' un mensaje enviado que tiene suscriptores locales se les entrega
+ * sin pasar por el mcp2515, y solo sale al bus si la id fue declarada con
+ * CAN_setRemote() o si el espejo esta activo (CAN_setMirror()).
+ */
+#ifndef CAN_ENTREGA_LOCAL
+#define CAN_ENTREGA_LOCAL	1
+#endif
+
+/**
+ * @brief Modo de operacion del mcp2515.
+ *
+ * Con '1' queda en loopback: lo enviado vuelve por la recepcion y no
+ * llega a otras placas, por lo que no tiene sentido declarar ids remotas.
+ * Con '0' queda en modo normal, conectado al bus.
+ */
+#ifndef CAN_MODO_LOOPBACK
+#define CAN_MODO_LOOPBACK	1
+#endif
 
 #define INIT_COMPLETE_EVENT (1 << 0)  // Bit del evento que representa la inicialización completa
 
@@ -24,6 +60,7 @@ typedef enum
 	ERROR_CAN_QUEUERX,
 	ERROR_CAN_MEMORY,
 	ERROR_CAN_NOT_FOUND,
+	ERROR_CAN_TIMEOUT,
 } Error_Can_t;
 
 typedef struct
@@ -38,6 +75,134 @@ typedef struct
 	TaskHandle_t taskHandle;
 } NodoSubscriptions_t;
 
+/**
+ * @brief Que hacer cuando la cola de un suscriptor esta llena.
+ *
+ * La tarea de recepcion nunca espera a un suscriptor: cada politica
+ * resuelve el desborde sin bloquear y cuenta los mensajes descartados.
+ */
+typedef enum
+{
+	/**
+	 * @brief Se descarta el mensaje que llega.
+	 */
+	CAN_POLITICA_DESCARTAR_NUEVO = 0,
+	/**
+	 * @brief Se descarta el mensaje mas viejo de la cola.
+	 */
+	CAN_POLITICA_DESCARTAR_VIEJO,
+	/**
+	 * @brief Buzon de un mensaje: cada recepcion pisa a la anterior.
+	 *
+	 * Para datos periodicos donde solo interesa el ultimo valor.
+	 */
+	CAN_POLITICA_SOBRESCRIBIR,
+	/**
+	 * @brief El mensaje se retiene hasta que haya lugar o venza el plazo.
+	 *
+	 * Mientras hay uno retenido los nuevos se descartan, para no alterar
+	 * el orden.
+	 */
+	CAN_POLITICA_ESPERAR,
+} CAN_Politica_t;
+
+/**
+ * @brief Offset de CAN_publishPeriodic() elegido por el planificador.
+ */
+#define CAN_PERIODICA_AUTO	portMAX_DELAY
+
+/**
+ * @brief Prioridad de transmision equivalente a un id estandar.
+ *
+ * La cola de transmision se ordena como el arbitraje del bus: menor valor,
+ * mayor prioridad. CAN_sendMsg() usa el id del mensaje.
+ */
+#define CAN_PRIORIDAD_MAXIMA	0x000
+#define CAN_PRIORIDAD_MINIMA	CAN_SFF_MASK
+
+/**
+ * @brief Contesta un pedido remoto (RTR) con datos en cache.
+ *
+ * Se llama desde la tarea de recepcion, o desde CAN_request() si el pedido
+ * es del mismo micro, por lo que no debe bloquear.
+ * @param[in,out] *respuesta Llega con la id pedida y sin datos; se
+ * completan can_dlc y data.
+ * @param[in] *contexto El registrado con CAN_setResponder().
+ * @return false para no contestar.
+ */
+typedef bool (*CAN_Responder_t)(struct can_frame *respuesta, void *contexto);
+
+/**
+ * @brief Aviso de la supervision de una subscripcion (CAN_Supervise()).
+ *
+ * Se llama siempre desde la tarea de recepcion, tambien para los mensajes
+ * entregados localmente, por lo que no debe bloquear.
+ * @param[in] nodeId Id supervisada.
+ * @param[in] presente false al vencer el plazo sin mensajes, true con el
+ * primer mensaje despues de eso.
+ * @param[in] *contexto El registrado con CAN_Supervise().
+ */
+typedef void (*CAN_Supervisor_t)(uint16_t nodeId, bool presente,
+		void *contexto);
+
+/**
+ * @brief Resolucion de la rueda de supervision: ranuras de 2^n ticks.
+ *
+ * No cambia la precision de los avisos, solo cuanto cubre una vuelta de
+ * la rueda (RUEDA_RANURAS ranuras); los plazos mas largos dan mas vueltas.
+ */
+#ifndef CAN_SUPERVISION_BITS
+#define CAN_SUPERVISION_BITS	4
+#endif
+
+/**
+ * @brief Plazo de CAN_Subscribe(), el mismo que esperaba la recepcion.
+ */
+#define CAN_PLAZO_DEFECTO	pdMS_TO_TICKS(200)
+
+/**
+ * @brief Estadisticas de la tarea de transmision.
+ */
+typedef struct
+{
+	/**
+	 * @brief Mensajes enviados al mcp2515.
+	 */
+	uint32_t enviados;
+	/**
+	 * @brief Mensajes descartados tras agotar los reintentos.
+	 */
+	uint32_t descartados;
+	/**
+	 * @brief Reintentos de envio al mcp2515.
+	 */
+	uint32_t reintentos;
+	/**
+	 * @brief Mensajes adelantados por esperar demasiado en la cola.
+	 */
+	uint32_t envejecidos;
+	/**
+	 * @brief Mensajes entregados solo a suscriptores locales.
+	 */
+	uint32_t locales;
+	/**
+	 * @brief Maximo de mensajes en la cola de transmision.
+	 */
+	uint32_t colaMax;
+	/**
+	 * @brief Tiempo en la cola del ultimo mensaje enviado [ms].
+	 */
+	uint32_t latenciaUltima;
+	/**
+	 * @brief Tiempo maximo en la cola [ms].
+	 */
+	uint32_t latenciaMax;
+	/**
+	 * @brief Suma de los tiempos en la cola, para calcular la media [ms].
+	 */
+	uint32_t latenciaTotal;
+} CAN_TxStats_t;
+
 /**
  * @brief Inicializa la api.
  */
@@ -46,9 +211,94 @@ extern void CAN_init(void);
  * @brief Envia informacion al buffer de transmision.
  * @param[in] *dato Puntero al dato de tipo can_frame.
  * @prara[in] xTicksToWait Tiempo de espera maximo.
- * @return Indica si el dato pudo ser cargado en la cola de datos.
+ * @return Indica si el dato pudo ser cargado en la cola de datos;
+ * ERROR_CAN_FAILTX si can_dlc supera CAN_MAX_DLEN.
  */
 extern Error_Can_t CAN_sendMsg(struct can_frame *dato, TickType_t xTicksToWait);
+/**
+ * @brief Envia informacion al buffer de transmision con prioridad explicita.
+ *
+ * Los mensajes salen por prioridad y no por orden de llegada; a igual
+ * prioridad sale el mas viejo.
+ * @param[in] *dato Puntero al dato de tipo can_frame.
+ * @param[in] prioridad De CAN_PRIORIDAD_MAXIMA a CAN_PRIORIDAD_MINIMA, con
+ * la misma escala que un id estandar.
+ * @param[in] xTicksToWait Tiempo de espera maximo si la cola esta llena.
+ * @return Indica si el dato pudo ser cargado en la cola de datos;
+ * ERROR_CAN_FAILTX si can_dlc supera CAN_MAX_DLEN.
+ */
+extern Error_Can_t CAN_sendMsgPriority(struct can_frame *dato,
+		uint16_t prioridad, TickType_t xTicksToWait);
+/**
+ * @brief Declara si una id tiene consumidores en otros nodos del bus.
+ *
+ * Sin suscriptores locales el mensaje sale siempre al bus; con ellos, solo
+ * si la id esta declarada como remota.
+ * @param[in] id Id del mensaje.
+ * @param[in] remoto true si hay consumidores remotos.
+ * @return ERROR_CAN_MEMORY si no hay lugar para otra id.
+ */
+extern Error_Can_t CAN_setRemote(canid_t id, bool remoto);
+/**
+ * @brief Envia al bus tambien los mensajes entregados localmente.
+ *
+ * Sirve para ver en el bus todo lo que intercambian los nodos locales. En
+ * modo loopback los suscriptores lo reciben dos veces: la entrega local y
+ * la vuelta del mcp2515.
+ * @param[in] activo true para activar el espejo.
+ */
+extern void CAN_setMirror(bool activo);
+/**
+ * @brief Publica un mensaje periodicamente desde la tarea de transmision.
+ *
+ * El mensaje no se copia al registrarlo: en cada vencimiento se envia el
+ * contenido actual de *frame, por lo que el productor solo actualiza sus
+ * datos (en una seccion critica si lo hace en mas de una escritura).
+ * @param[in] *frame Mensaje a enviar, debe existir mientras se publique.
+ * @param[in] periodo Periodo de envio [ticks].
+ * @param[in] offset Primer envio [ticks desde ahora]. Con
+ * CAN_PERIODICA_AUTO se elige el que mas separa a este mensaje de los ya
+ * publicados, para repartir la carga del bus.
+ * @return ERROR_CAN_MEMORY si no hay lugar en el planificador.
+ */
+extern Error_Can_t CAN_publishPeriodic(const struct can_frame *frame,
+		TickType_t periodo, TickType_t offset);
+/**
+ * @brief Pide un mensaje con una trama remota (RTR) y espera la respuesta.
+ *
+ * Cualquier mensaje de datos con la id que llegue mientras se espera
+ * cuenta como respuesta. Si el respondedor esta en el mismo micro se lo
+ * llama directamente, sin pasar por el bus. La id queda en los filtros
+ * del mcp2515 para recibir las respuestas.
+ * @param[in] id Id del mensaje pedido.
+ * @param[in] timeout Espera maxima para encolar el pedido y para la
+ * respuesta.
+ * @param[out] *respuesta Mensaje recibido.
+ * @return ERROR_CAN_TIMEOUT si no hubo respuesta, ERROR_CAN_MEMORY si ya
+ * hay CAN_MAX_PEDIDOS pedidos en curso.
+ */
+extern Error_Can_t CAN_request(canid_t id, TickType_t timeout,
+		struct can_frame *respuesta);
+/**
+ * @brief Registra quien contesta los pedidos remotos de una id.
+ *
+ * El respondedor corre en la tarea de recepcion y contesta con datos que
+ * ya tiene, sin despertar a la tarea del productor. La respuesta sale
+ * siempre al bus, aunque la id tenga suscriptores locales.
+ * @param[in] id Id del mensaje.
+ * @param[in] responder Respondedor, o NULL para quitarlo.
+ * @param[in] *contexto Se le pasa al respondedor.
+ * @return ERROR_CAN_MEMORY si no hay lugar para otra id.
+ */
+extern Error_Can_t CAN_setResponder(canid_t id, CAN_Responder_t responder,
+		void *contexto);
+/**
+ * @brief Respondedor que contesta con el contenido actual de un mensaje.
+ *
+ * El contexto es un const struct can_frame *, con el mismo uso que en
+ * CAN_publishPeriodic(): el productor solo actualiza sus datos.
+ */
+extern bool CAN_responderFrame(struct can_frame *respuesta, void *contexto);
 /**
  * @brief Recive la informacion desde la cola de datos del propio nodo.
  * @param[out] *dato Puntero al dato donde cargar la informacion.
@@ -57,21 +307,146 @@ extern Error_Can_t CAN_sendMsg(struct can_frame *dato, TickType_t xTicksToWait);
  */
 extern Error_Can_t CAN_readMsg(struct can_frame *dato, uint16_t nodeId,
 		TaskHandle_t taskHandle);
+/**
+ * @brief Recibe una referencia al mensaje, sin copiarlo.
+ *
+ * El mensaje se lee con can_pool_frame(ref) y se debe liberar con
+ * CAN_releaseRef() al terminar de usarlo.
+ * @param[out] *ref Referencia al mensaje.
+ * @param[in] nodeId Id del nodo que se quiere leer.
+ * @param[in] taskHandle Indentifica el nodo del que viene.
+ */
+extern Error_Can_t CAN_readRef(CAN_FrameRef_t *ref, uint16_t nodeId,
+		TaskHandle_t taskHandle);
+/**
+ * @brief Libera un mensaje obtenido con CAN_readRef().
+ * @param[in] ref Referencia al mensaje.
+ */
+extern void CAN_releaseRef(CAN_FrameRef_t ref);
 /**
  * @brief Crea una subscripcion al nodo con el id especificado.
+ *
+ * Usa CAN_POLITICA_ESPERAR con CAN_PLAZO_DEFECTO.
  * @param[in] nodeId Id del nodo al que se subscribe.
  * @param[in] taskHandle Handle de la tarea que se subscribe.
  */
 extern Error_Can_t CAN_Subscribe(uint16_t nodeId, TaskHandle_t taskHandle);
+/**
+ * @brief Crea una subscripcion con la politica de desborde indicada.
+ * @param[in] nodeId Id del nodo al que se subscribe.
+ * @param[in] taskHandle Handle de la tarea que se subscribe.
+ * @param[in] politica Que hacer con la cola llena.
+ * @param[in] plazo Tiempo maximo de retencion con CAN_POLITICA_ESPERAR.
+ */
+extern Error_Can_t CAN_SubscribePolicy(uint16_t nodeId,
+		TaskHandle_t taskHandle, CAN_Politica_t politica, TickType_t plazo);
+/**
+ * @brief Crea una subscripcion a todas las id que coinciden con una mascara.
+ *
+ * Recibe los mensajes estandar con (can_id & mascara) == (id & mascara);
+ * por ejemplo id 0x100 y mascara 0x700 cubre 0x100 a 0x1FF. Con mascara 0
+ * recibe todo. Para leer y desuscribirse se usa id & mascara como nodeId.
+ * Las suscripciones tambien configuran los filtros del mcp2515, por lo
+ * que las id que nadie pidio no llegan al micro.
+ * @param[in] id Id base.
+ * @param[in] mascara Bits de la id que se comparan.
+ * @param[in] taskHandle Handle de la tarea que se subscribe.
+ * @param[in] politica Que hacer con la cola llena.
+ * @param[in] plazo Tiempo maximo de retencion con CAN_POLITICA_ESPERAR.
+ */
+extern Error_Can_t CAN_SubscribeMask(uint16_t id, uint16_t mascara,
+		TaskHandle_t taskHandle, CAN_Politica_t politica, TickType_t plazo);
+/**
+ * @brief Crea una subscripcion que guarda solo el ultimo mensaje.
+ *
+ * Equivale a CAN_POLITICA_SOBRESCRIBIR; el valor se lee con
+ * CAN_readLatest().
+ * @param[in] nodeId Id del nodo al que se subscribe.
+ * @param[in] taskHandle Handle de la tarea que se subscribe.
+ */
+extern Error_Can_t CAN_SubscribeLatest(uint16_t nodeId,
+		TaskHandle_t taskHandle);
+/**
+ * @brief Lee el ultimo mensaje de una subscripcion CAN_POLITICA_SOBRESCRIBIR.
+ *
+ * No bloquea ni consume el mensaje: dos lecturas seguidas devuelven el
+ * mismo valor con la misma secuencia.
+ * @param[out] *dato Puntero al dato donde cargar la informacion.
+ * @param[in] nodeId Id del nodo que se quiere leer.
+ * @param[in] taskHandle Indentifica el nodo del que viene.
+ * @param[out] *secuencia Cantidad de mensajes recibidos hasta este (puede
+ * ser NULL). Un salto mayor a 1 entre lecturas indica valores perdidos.
+ * @return ERROR_CAN_QUEUERX si todavia no llego ningun mensaje.
+ */
+extern Error_Can_t CAN_readLatest(struct can_frame *dato, uint16_t nodeId,
+		TaskHandle_t taskHandle, uint32_t *secuencia);
+/**
+ * @brief Mensajes que no se entregaron a una subscripcion.
+ *
+ * Incluye los pisados en el buzon de CAN_POLITICA_SOBRESCRIBIR.
+ * @param[in] nodeId Id del nodo.
+ * @param[in] taskHandle Handle de la tarea suscripta.
+ * @param[out] *descartados Cantidad de mensajes descartados.
+ */
+extern Error_Can_t CAN_getDropped(uint16_t nodeId, TaskHandle_t taskHandle,
+		uint32_t *descartados);
+/**
+ * @brief Supervisa que los mensajes de una subscripcion lleguen a tiempo.
+ *
+ * Si pasan periodo + tolerancia sin mensajes la senal se da por perdida y
+ * se avisa una vez; con el proximo mensaje se avisa que se recupero. Todas
+ * las subscripciones supervisadas comparten una rueda de tiempos que
+ * atiende la tarea de recepcion, con un costo por mensaje que no depende
+ * de cuantas se supervisen. El primer plazo corre desde esta llamada.
+ * @param[in] nodeId Id de la subscripcion.
+ * @param[in] taskHandle Handle de la tarea suscripta.
+ * @param[in] periodo Periodo esperado [ticks], 0 deja de supervisar.
+ * @param[in] tolerancia Atraso admitido sobre el periodo [ticks].
+ * @param[in] aviso Funcion a llamar en cada cambio, o NULL.
+ * @param[in] *contexto Se le pasa al aviso.
+ * @return ERROR_CAN_NOT_FOUND si no existe la subscripcion.
+ */
+extern Error_Can_t CAN_Supervise(uint16_t nodeId, TaskHandle_t taskHandle,
+		TickType_t periodo, TickType_t tolerancia, CAN_Supervisor_t aviso,
+		void *contexto);
+/**
+ * @brief Estado de la supervision de una subscripcion.
+ * @param[in] nodeId Id de la subscripcion.
+ * @param[in] taskHandle Handle de la tarea suscripta.
+ * @param[out] *presente false si la senal esta perdida.
+ * @param[out] *perdidas Veces que se perdio (puede ser NULL).
+ */
+extern Error_Can_t CAN_getSupervision(uint16_t nodeId,
+		TaskHandle_t taskHandle, bool *presente, uint32_t *perdidas);
 /**
  * @brief Borrar una subscripcion al nodo con el id especificado.
  * @param[in] nodeId Id del nodo al que se desubscribe.
  * @param[in] taskHandle Handle de la tarea que se desubscribe.
  */
 extern Error_Can_t CAN_Unsubscribe(uint16_t nodeId, TaskHandle_t taskHandle);
+/**
+ * @brief Copia las estadisticas de transmision.
+ * @param[out] *stats Lugar donde se cargan los datos.
+ */
+extern void CAN_getTxStats(CAN_TxStats_t *stats);
+/**
+ * @brief Maximo de mensajes que llego a tener la cola de un suscriptor.
+ * @return Cantidad de mensajes.
+ */
+extern uint32_t CAN_getRxQueueMax(void);
 /**
  * @brief Espera hasta que suceda el evento de sincronización.
  */
 extern void CAN_getEvent(void);
+#if CAN_BENCH_FANOUT
+/**
+ * @brief Mide el costo de repartir un mensaje a 1, 2, 4 y 8 suscriptores.
+ *
+ * Compara la copia por suscriptor con el reparto de referencias del pool
+ * e imprime la tabla por consola. Debe llamarse desde una tarea luego de
+ * CAN_getEvent().
+ */
+extern void CAN_benchFanout(void);
+#endif
 
 #endif /* CANAPI_H_ */
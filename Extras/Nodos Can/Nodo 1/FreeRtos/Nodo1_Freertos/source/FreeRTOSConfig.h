@@ -27,6 +27,9 @@
 #define FREERTOS_CONFIG_H
 
 #include "fsl_debug_console.h"
+#include "prof.h"
+#include "dlog.h"
+#include "diag.h"
 
 /*-----------------------------------------------------------
  * Application specific definitions.
@@ -41,7 +44,20 @@
  *----------------------------------------------------------*/
 
 #define configUSE_PREEMPTION                    1
+/*
+ * RTOS_TICKLESS en 1: la tarea ociosa detiene el systick y duerme en VLPS
+ * hasta el proximo vencimiento o la interrupcion del mcp2515 (tickless.c).
+ * El valor 2 deja sin efecto la version con el systick de freertos/portable.
+ */
+#ifndef RTOS_TICKLESS
+#define RTOS_TICKLESS                           0
+#endif
+
+#if RTOS_TICKLESS
+#define configUSE_TICKLESS_IDLE                 2
+#else
 #define configUSE_TICKLESS_IDLE                 0
+#endif
 #define configCPU_CLOCK_HZ                      (SystemCoreClock)
 #define configTICK_RATE_HZ                      ((TickType_t)1000)
 #define configMAX_PRIORITIES                    5
@@ -63,23 +79,44 @@
 #define configUSE_APPLICATION_TASK_TAG          0
 
 /* Memory allocation related definitions. */
+/*
+ * RTOS_ESTATICO en 1: tareas, semaforos, timers y subscripciones con memoria
+ * estatica (ver rtos_estatico.h). El heap queda solo para lo que se cree
+ * fuera de la api; heap_4.c sigue en el proyecto, por eso no se desactiva
+ * la asignacion dinamica.
+ */
+#ifndef RTOS_ESTATICO
+#define RTOS_ESTATICO                           0
+#endif
+
+#if RTOS_ESTATICO
+#define configSUPPORT_STATIC_ALLOCATION         1
+#define configSUPPORT_DYNAMIC_ALLOCATION        1
+#define configTOTAL_HEAP_SIZE                   ((size_t)(512))
+#else
 #define configSUPPORT_STATIC_ALLOCATION         0
 #define configSUPPORT_DYNAMIC_ALLOCATION        1
 #define configTOTAL_HEAP_SIZE                   ((size_t)(10240))
+#endif
 #define configAPPLICATION_ALLOCATED_HEAP        0
 
 /* Hook function related definitions. */
-#define configUSE_IDLE_HOOK                     0
-#define configUSE_TICK_HOOK                     0
+#define configUSE_IDLE_HOOK                     DLOG_ENABLE /* dlog.c vacia el registro */
+#define configUSE_TICK_HOOK                     PROF_ENABLE /* prof.c cuenta los ticks */
 #define configCHECK_FOR_STACK_OVERFLOW          2
 #define configUSE_MALLOC_FAILED_HOOK            1
 #define configUSE_DAEMON_TASK_STARTUP_HOOK      0
 
 /* Run time and task stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS           0
+#define configGENERATE_RUN_TIME_STATS           DIAG_ENABLE /* diag.c, contador con el TPM2 */
 #define configUSE_TRACE_FACILITY                1
 #define configUSE_STATS_FORMATTING_FUNCTIONS    0
 
+#if DIAG_ENABLE
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() diag_timerInit()
+#define portGET_RUN_TIME_COUNTER_VALUE()         diag_contador()
+#endif
+
 /* Co-routine related definitions. */
 #define configUSE_CO_ROUTINES                   0
 #define configMAX_CO_ROUTINE_PRIORITIES         2
@@ -106,7 +143,7 @@
 #define INCLUDE_xTaskGetIdleTaskHandle          0
 #define INCLUDE_eTaskGetState                   0
 #define INCLUDE_xTimerPendFunctionCall          1
-#define INCLUDE_xTaskAbortDelay                 0
+#define INCLUDE_xTaskAbortDelay                 1
 #define INCLUDE_xTaskGetHandle                  0
 #define INCLUDE_xTaskResumeFromISR              1
 
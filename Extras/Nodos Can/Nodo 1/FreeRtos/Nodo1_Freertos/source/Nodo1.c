@@ -13,6 +13,9 @@
  * Nombre nodo: Nodo 1
  * Tipo: Productor.
  * Informacion: Envia datos de luz cada 1 segundo.
+ * El envio lo hace el planificador de CanApi (CAN_publishPeriodic()), la
+ * interrupcion del adc solo actualiza los datos del mensaje. Los pedidos
+ * remotos (CAN_request()) se contestan con el mismo mensaje.
  * Subcripciones: Ninguna.
  * Subcriptos: Nodo 2 y nodo 3.
  */
@@ -24,6 +27,7 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "timers.h"
+#include "rtos_estatico.h"
 
 #include "CanApi.h"
 #include "can.h"
@@ -35,24 +39,17 @@
 #define CAN_NODO1_ID	10
 #define CAN_NODO1_DLC	2
 
-#define TASK_NODO1_STACK 	configMINIMAL_STACK_SIZE+120
-
-#define __delay_ms(x)	vTaskDelay(pdMS_TO_TICKS(x))
-
 /**
  * @brief Handle del temporizador.
  */
 TimerHandle_t timer_AdcConversiones;
+RTOS_OBJETO_MEMORIA(StaticTimer_t, timer_AdcConversiones);
 
 /**
  * @brief Mensaje de tipo can.
  */
 struct can_frame canMsg_Nodo1;
 
-/**
- * @brief Tarea del Nodo 1.
- */
-static void taskRtos_Nodo1(void *pvParameters);
 /**
  * @brief Timer por software.
  * @param[in] xTimer No utilizado.
@@ -63,22 +60,6 @@ extern void Nodo1_init(void)
 {
 	PRINTF("\nNombre: Nodo 1\n\r");
 
-	BaseType_t status = xTaskCreate(taskRtos_Nodo1, "Task Nodo 1",
-	TASK_NODO1_STACK, NULL, 2, NULL);
-	if (status == pdFALSE)
-		PRINTF("Fallo al crear la tarea.\n\r");
-
-	timer_AdcConversiones = xTimerCreate("Muestro de adc",
-			pdMS_TO_TICKS(TIEMPO_DE_MUESTREO_LDR), pdTRUE, NULL,
-			timerRtos_LdrConversion);
-	if (timer_AdcConversiones == NULL)
-		PRINTF("Fallo al crear el timer.\n\r");
-
-	return;
-}
-
-static void taskRtos_Nodo1(void *pvParameters)
-{
 	Error_LDR_t error = LDR_init();
 	if (error != ERROR_LDR_OK)
 		PRINTF("Fallo al inicializar el adc.\n\r");
@@ -86,59 +67,34 @@ static void taskRtos_Nodo1(void *pvParameters)
 	canMsg_Nodo1.can_id = CAN_NODO1_ID;
 	canMsg_Nodo1.can_dlc = CAN_NODO1_DLC;
 
-	BaseType_t status = xTimerStart(timer_AdcConversiones, portMAX_DELAY);
-	if (status != pdPASS)
+	timer_AdcConversiones = RTOS_TIMER_CREAR(timer_AdcConversiones,
+			"Muestro de adc",
+			pdMS_TO_TICKS(TIEMPO_DE_MUESTREO_LDR), pdTRUE, NULL,
+			timerRtos_LdrConversion);
+	if (timer_AdcConversiones == NULL)
+		PRINTF("Fallo al crear el timer.\n\r");
+	else if (xTimerStart(timer_AdcConversiones, 0) != pdPASS)
 		PRINTF("Fallo al inciar el timer.\n\r");
 
-	/* Espera que se de el evento de inicializacion. */
-	CAN_getEvent();
-
-	for (;;)
-	{
-		if (LDR_getConvComplete())
-		{
-//			PRINTF("\n\rValor del Adc: %d\n\r", LDR_UltimaConversion());
-
-			LDR_clearConvComplete();
-
-			canMsg_Nodo1.data[1] = (LDR_UltimaConversion() & 0xff00) >> 8;
-			canMsg_Nodo1.data[0] = (LDR_UltimaConversion() & 0x00ff);
-
-			Error_Can_t statusTx = CAN_sendMsg(&canMsg_Nodo1,
-					pdMS_TO_TICKS(200));
-			if (statusTx != ERROR_CAN_OK)
-			{
-				if (statusTx == ERROR_CAN_QUEUETX)
-					PRINTF("\n\rError al enviar datos a la cola.\n\r");
-				else
-					PRINTF("\n\rError desconocido.\n\r");
-			}
-
-//			if (estado == ERROR_OK)
-//			{
-////				PRINTF("\n\r----------------------");
-////				PRINTF("\n\rNodo 1.\n\r");
-////				PRINTF("Mensaje enviado\n\r");
-////				PRINTF("ID\tDLC\tDATA\n\r");
-////				PRINTF("%d\t%d\t", canMsg_Nodo1.can_id, canMsg_Nodo1.can_dlc);
-////
-////				for (uint8_t i = 0; i < 8; i++)
-////				{
-////					PRINTF("%d ", canMsg_Nodo1.data[i]);
-////				}
-////
-////				PRINTF("\n\r");
-//			}
-//			else
-//			{
-//				PRINTF("\nError al enviar desde nodo 1.\n\r");
-//			}
-		}
-
-		__delay_ms(100);
-	}
-
-	vTaskDelete(NULL);
+	Error_Can_t statusTx = CAN_publishPeriodic(&canMsg_Nodo1,
+			pdMS_TO_TICKS(TIEMPO_DE_MUESTREO_LDR), CAN_PERIODICA_AUTO);
+	if (statusTx != ERROR_CAN_OK)
+		PRINTF("Fallo al publicar el mensaje.\n\r");
+
+	statusTx = CAN_setResponder(CAN_NODO1_ID, CAN_responderFrame,
+			&canMsg_Nodo1);
+	if (statusTx != ERROR_CAN_OK)
+		PRINTF("Fallo al registrar el respondedor.\n\r");
+
+#if !CAN_MODO_LOOPBACK
+	/*
+	 * Los nodos 2 y 3 de las otras placas lo leen del bus. En loopback no
+	 * llegaria a ellas y la vuelta duplicaria la entrega local.
+	 * */
+	statusTx = CAN_setRemote(CAN_NODO1_ID, true);
+	if (statusTx != ERROR_CAN_OK)
+		PRINTF("Fallo al declarar la id remota.\n\r");
+#endif
 
 	return;
 }
@@ -162,5 +118,9 @@ void ADC16_IRQ_HANDLER_FUNC(void)
 	LDR_setConvComplete(); /* Setea la bandera en 1 */
 	LDR_read(); /* Lee el registro */
 
+	/* El planificador copia el mensaje con las interrupciones deshabilitadas */
+	canMsg_Nodo1.data[1] = (LDR_UltimaConversion() & 0xff00) >> 8;
+	canMsg_Nodo1.data[0] = (LDR_UltimaConversion() & 0x00ff);
+
 	return;
 }
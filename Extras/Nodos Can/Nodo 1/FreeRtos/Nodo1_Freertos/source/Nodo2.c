@@ -17,6 +17,7 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "timers.h"
+#include "rtos_estatico.h"
 
 #include "CanApi.h"
 #include "can.h"
@@ -29,7 +30,6 @@
 #include "peripherals.h"
 #include "pin_mux.h"
 
-#define CAN_NODO_2_ID	20
 #define CAN_NODO_2_DLC	1
 #define TIEMPO_ENVIAR_DATOS_BUSCAN 500
 
@@ -70,6 +70,7 @@ static struct can_frame canMsg_Nodo2_read;
  * @brief Handle del temporizador 1.
  */
 TimerHandle_t Timer1;
+RTOS_OBJETO_MEMORIA(StaticTimer_t, Timer1);
 /**
  * @brief Handle de la tarea del nodo 2.
  */
@@ -79,30 +80,45 @@ TaskHandle_t TaskNodo2_Handle;
  * @brief Tarea del nodo 2.
  */
 static void taskRtos_Nodo2(void *pvParameters);
-/**
- * @brief Tarea de escritura en el bus can del nodo 2.
- */
-static void taskRtos_Nodo2_Write(void *pvParameters);
 /**
  * @brief Funcion de callback del timer.
  */
 static void timerRtos_DatosPerifericos(void *pvParameters);
 
+RTOS_TAREA_MEMORIA(taskRtos_Nodo2, configMINIMAL_STACK_SIZE);
+
 extern void Nodo2_init(void)
 {
 	PRINTF("\nNombre: Nodo 2\n\r");
 
-	BaseType_t status = xTaskCreate(taskRtos_Nodo2, "Task Nodo 2",
-	configMINIMAL_STACK_SIZE, NULL, 2, &TaskNodo2_Handle);
+	BaseType_t status = RTOS_TAREA_CREAR(taskRtos_Nodo2, "Task Nodo 2", NULL,
+			2, &TaskNodo2_Handle);
 	if (status == pdFALSE)
 		PRINTF("Fallo al crear la tarea.\n\r");
 
-	status = xTaskCreate(taskRtos_Nodo2_Write, "Task Nodo 2 Write",
-	configMINIMAL_STACK_SIZE, NULL, 1, NULL);
-	if (status == pdFALSE)
-		PRINTF("Fallo al crear la tarea.\n\r");
+	/* El envio lo hace el planificador de CanApi, sin tarea propia */
+	canMsg_Nodo2_write.can_id = CAN_NODO_2_ID;	// Id del nodo 2.
+	canMsg_Nodo2_write.can_dlc = CAN_NODO_2_DLC;
 
-	Timer1 = xTimerCreate("Muestro de adc",
+	Error_Can_t statusTx = CAN_publishPeriodic(&canMsg_Nodo2_write,
+			pdMS_TO_TICKS(PERIODO_NODO_2), CAN_PERIODICA_AUTO);
+	if (statusTx != ERROR_CAN_OK)
+		PRINTF("Fallo al publicar el mensaje.\n\r");
+
+	/* Los pedidos remotos se contestan con el ultimo estado */
+	statusTx = CAN_setResponder(CAN_NODO_2_ID, CAN_responderFrame,
+			&canMsg_Nodo2_write);
+	if (statusTx != ERROR_CAN_OK)
+		PRINTF("Fallo al registrar el respondedor.\n\r");
+
+#if !CAN_MODO_LOOPBACK
+	/* El nodo 3 de la otra placa lo lee del bus (no en loopback) */
+	statusTx = CAN_setRemote(CAN_NODO_2_ID, true);
+	if (statusTx != ERROR_CAN_OK)
+		PRINTF("Fallo al declarar la id remota.\n\r");
+#endif
+
+	Timer1 = RTOS_TIMER_CREAR(Timer1, "Muestro de adc",
 			pdMS_TO_TICKS(TIEMPO_ENVIAR_DATOS_BUSCAN), true, NULL,
 			timerRtos_DatosPerifericos);
 	if (Timer1 == NULL)
@@ -116,18 +132,18 @@ static void taskRtos_Nodo2(void *pvParameters)
 	NodoSubscriptions_t Subscripciones =
 	{ .IdSub = 10, .taskHandle = TaskNodo2_Handle, };
 	uint32_t event_notify;
+	uint32_t secuencia, secuenciaAnterior = 0;
 
 	/* Configuracion de los led y botones */
 	BOARD_InitLEDs();
 	BOARD_InitButtons();
 
-	canMsg_Nodo2_write.can_id = CAN_NODO_2_ID;	// Id del nodo 2.
-
 	BaseType_t status = xTimerStart(Timer1, portMAX_DELAY);
 	if (status != pdPASS)
 		PRINTF("\n\rFallo al inciar el timer.\n\r");
 
-	Error_Can_t statusSub = CAN_Subscribe(Subscripciones.IdSub,
+	/* Del sensor de luz solo interesa el ultimo valor */
+	Error_Can_t statusSub = CAN_SubscribeLatest(Subscripciones.IdSub,
 			Subscripciones.taskHandle);
 	if (statusSub != ERROR_CAN_OK)
 	{
@@ -145,20 +161,21 @@ static void taskRtos_Nodo2(void *pvParameters)
 
 	for (;;)
 	{
-		event_notify = ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+		event_notify = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
 		if (event_notify > 0)
 		{
-			/* Debe tomar los datos de la cola de datos */
-			Error_Can_t statusRx = CAN_readMsg(&canMsg_Nodo2_read,
-					Subscripciones.IdSub, Subscripciones.taskHandle);
-			if (statusRx != ERROR_CAN_OK)
-				PRINTF("\n\r");
+			/* Toma el ultimo valor del buzon */
+			Error_Can_t statusRx = CAN_readLatest(&canMsg_Nodo2_read,
+					Subscripciones.IdSub, Subscripciones.taskHandle,
+					&secuencia);
 
 			uint16_t adc_read;
 
-			if (canMsg_Nodo2_read.can_id == Subscripciones.IdSub)
+			if (statusRx == ERROR_CAN_OK && secuencia != secuenciaAnterior)
 			{
+				secuenciaAnterior = secuencia;
+
 				adc_read = canMsg_Nodo2_read.data[1];
 				adc_read = (adc_read << 8) | canMsg_Nodo2_read.data[0];
 
@@ -182,34 +199,6 @@ static void taskRtos_Nodo2(void *pvParameters)
 	return;
 }
 
-static void taskRtos_Nodo2_Write(void *pvParameters)
-{
-	/* Espera el evento de sincronizacion. */
-	CAN_getEvent();
-
-	for (;;)
-	{
-		Error_Can_t statusTx = CAN_sendMsg(&canMsg_Nodo2_write,
-				pdMS_TO_TICKS(200));
-		if (statusTx != ERROR_CAN_OK)
-		{
-			if (statusTx == ERROR_CAN_QUEUETX)
-				PRINTF("\n\rError al enviar datos a la cola.\n\r");
-			else
-				PRINTF("\n\rError desconocido.\n\r");
-		}
-
-		__delay_ms(1000);
-
-		GPIO_TogglePinsOutput(BOARD_LED_GREEN_GPIO,
-		BOARD_LED_GREEN_GPIO_PIN_MASK);
-	}
-
-	vTaskDelete(NULL);
-
-	return;
-}
-
 static void timerRtos_DatosPerifericos(void *pvParameters)
 {
 	EstPerifericos_t perifericos =
@@ -220,8 +209,11 @@ static void timerRtos_DatosPerifericos(void *pvParameters)
 	perifericos.PULSADOR1 = ~GPIO_ReadPinInput(BOARD_SW1_GPIO, BOARD_SW1_PIN);
 	perifericos.PULSADOR2 = ~GPIO_ReadPinInput(BOARD_SW3_GPIO, BOARD_SW3_PIN);
 
+	/* Escritura de un byte, el planificador la ve completa */
 	canMsg_Nodo2_write.data[0] = perifericos.data;
-	canMsg_Nodo2_write.can_dlc = CAN_NODO_2_DLC;
+
+	GPIO_TogglePinsOutput(BOARD_LED_GREEN_GPIO,
+	BOARD_LED_GREEN_GPIO_PIN_MASK);
 
 	return;
 }
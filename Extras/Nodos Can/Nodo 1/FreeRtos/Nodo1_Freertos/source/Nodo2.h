@@ -10,6 +10,9 @@
 
 #include "can.h"
 
+#define CAN_NODO_2_ID	20
+#define PERIODO_NODO_2	1000	// Periodo de envio del nodo 2 en milisegundos
+
 /**
  * @brief Inicializa el nodo 2.
  */
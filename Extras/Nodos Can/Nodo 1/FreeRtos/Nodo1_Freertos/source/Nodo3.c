@@ -17,18 +17,34 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "timers.h"
+#include "rtos_estatico.h"
 
 #include "CanApi.h"
 #include "can.h"
 
 #include "Nodo1.h"
 #include "Nodo2.h"
+#include "LDR.h"
 
 #include "fsl_debug_console.h"
 
 #define CAN_NODO3_ID	30
 
 #define TIEMPO_SALIDA_SERIE	1000
+/**
+ * @brief Atraso admitido sobre el periodo de cada nodo antes de pedir los
+ * datos con tramas remotas [ms].
+ */
+#define TOLERANCIA_NODOS	500
+/**
+ * @brief Nodos sin datos, marcados por la supervision de CanApi.
+ */
+#define SIN_DATOS_NODO1		(1U << 0)
+#define SIN_DATOS_NODO2		(1U << 1)
+/**
+ * @brief Espera maxima de cada pedido remoto [ms].
+ */
+#define TIEMPO_PEDIDO		50
 
 typedef union
 {
@@ -46,9 +62,11 @@ static struct can_frame canMsg_Nodo3_read;
 static volatile uint16_t adc_read;
 static EstPerifericos_t perifericos;
 static bool estSW1, estSW2, estLedRojo;
+static volatile uint32_t sinDatos;
 
 TaskHandle_t TaskNodo3_Handle;
 TimerHandle_t TimerSerial_Handle;
+RTOS_OBJETO_MEMORIA(StaticTimer_t, TimerSerial_Handle);
 
 /**
  * @brief Tarea del nodo 3.
@@ -62,6 +80,26 @@ static void taskRtos_Nodo3(void *pvParameters);
  * alta.
  */
 static void timerRtos_DatosSerial(void *pvParameters);
+/**
+ * @brief Actualiza el valor del sensor de luz (nodo 1).
+ */
+static void nodo3_luz(const struct can_frame *frame);
+/**
+ * @brief Actualiza el estado de los perifericos (nodo 2).
+ */
+static void nodo3_perifericos(const struct can_frame *frame);
+/**
+ * @brief Pide los valores sin esperar al envio periodico.
+ * @param[in] nodos SIN_DATOS_NODO1 y/o SIN_DATOS_NODO2.
+ */
+static void nodo3_pedir(uint32_t nodos);
+/**
+ * @brief Aviso de la supervision: marca el nodo y despierta a la tarea.
+ * @param[in] *contexto Bit del nodo en sinDatos.
+ */
+static void nodo3_supervision(uint16_t nodeId, bool presente, void *contexto);
+
+RTOS_TAREA_MEMORIA(taskRtos_Nodo3, configMINIMAL_STACK_SIZE + 100);
 
 extern BaseType_t receiveFromQueue(struct can_frame *dato);
 
@@ -69,13 +107,13 @@ extern void Nodo3_init(void)
 {
 	PRINTF("\nNombre: Nodo 3.\n\r");
 
-	BaseType_t status = xTaskCreate(taskRtos_Nodo3, "Task Nodo 3",
-	configMINIMAL_STACK_SIZE+100, NULL, 2, &TaskNodo3_Handle);
+	BaseType_t status = RTOS_TAREA_CREAR(taskRtos_Nodo3, "Task Nodo 3", NULL,
+			2, &TaskNodo3_Handle);
 	if (status == pdFALSE)
 		PRINTF("Fallo al crear la tarea.\n\r");
 
-	TimerSerial_Handle = xTimerCreate("Muestro de adc",
-			pdMS_TO_TICKS(TIEMPO_SALIDA_SERIE), true, NULL,
+	TimerSerial_Handle = RTOS_TIMER_CREAR(TimerSerial_Handle,
+			"Muestro de adc", pdMS_TO_TICKS(TIEMPO_SALIDA_SERIE), true, NULL,
 			timerRtos_DatosSerial);
 	if (TimerSerial_Handle == NULL)
 		PRINTF("Fallo al crear el timer.\n\r");
@@ -94,8 +132,11 @@ static void taskRtos_Nodo3(void *pvParameters)
 	{ .IdSub = 10, .taskHandle = TaskNodo3_Handle, },
 	{ .IdSub = 20, .taskHandle = TaskNodo3_Handle, }, };
 	uint32_t event_notify;
+	uint32_t secuencia, secuenciaAnterior[2] =
+	{ 0, 0 };
 
-	Error_Can_t statusSub = CAN_Subscribe(Subscripciones[NODO1].IdSub,
+	/* Son datos periodicos: solo interesa el ultimo valor de cada nodo */
+	Error_Can_t statusSub = CAN_SubscribeLatest(Subscripciones[NODO1].IdSub,
 			Subscripciones[NODO1].taskHandle);
 	if (statusSub != ERROR_CAN_OK)
 	{
@@ -105,7 +146,7 @@ static void taskRtos_Nodo3(void *pvParameters)
 			PRINTF("\n\rError desconocido.\n\r");
 	}
 
-	statusSub = CAN_Subscribe(Subscripciones[NODO2].IdSub,
+	statusSub = CAN_SubscribeLatest(Subscripciones[NODO2].IdSub,
 			Subscripciones[NODO2].taskHandle);
 	if (statusSub != ERROR_CAN_OK)
 	{
@@ -115,6 +156,17 @@ static void taskRtos_Nodo3(void *pvParameters)
 			PRINTF("\n\rError desconocido.\n\r");
 	}
 
+	/* Cada nodo con su propio plazo, en lugar de uno comun a los dos */
+	CAN_Supervise(Subscripciones[NODO1].IdSub,
+			Subscripciones[NODO1].taskHandle,
+			pdMS_TO_TICKS(TIEMPO_DE_MUESTREO_LDR),
+			pdMS_TO_TICKS(TOLERANCIA_NODOS), nodo3_supervision,
+			(void*) SIN_DATOS_NODO1);
+	CAN_Supervise(Subscripciones[NODO2].IdSub,
+			Subscripciones[NODO2].taskHandle, pdMS_TO_TICKS(PERIODO_NODO_2),
+			pdMS_TO_TICKS(TOLERANCIA_NODOS), nodo3_supervision,
+			(void*) SIN_DATOS_NODO2);
+
 	/* Espera el evento de sincronizacion. */
 	CAN_getEvent();
 
@@ -122,16 +174,28 @@ static void taskRtos_Nodo3(void *pvParameters)
 	if (status != pdPASS)
 		PRINTF("Fallo al inciar el timer.\n\r");
 
+	/* Valores iniciales sin esperar al primer envio periodico */
+	nodo3_pedir(SIN_DATOS_NODO1 | SIN_DATOS_NODO2);
+
 	for (;;)
 	{
 		event_notify = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
+		/* Nodos sin mensajes en su plazo: se piden en lugar de esperar */
+		taskENTER_CRITICAL();
+		uint32_t nodos = sinDatos;
+		sinDatos = 0;
+		taskEXIT_CRITICAL();
+
+		if (nodos != 0)
+			nodo3_pedir(nodos);
+
 		if (event_notify > 0)
 		{
-			/* Debe tomar los datos de la cola de datos */
-			Error_Can_t statusRx = CAN_readMsg(&canMsg_Nodo3_read,
+			/* Toma el ultimo valor de cada buzon, sin esperar */
+			Error_Can_t statusRx = CAN_readLatest(&canMsg_Nodo3_read,
 					Subscripciones[NODO1].IdSub,
-					Subscripciones[NODO1].taskHandle);
+					Subscripciones[NODO1].taskHandle, &secuencia);
 //			if (statusRx != ERROR_CAN_OK)
 //			{
 //				if (statusRx == ERROR_CAN_QUEUERX)
@@ -140,15 +204,16 @@ static void taskRtos_Nodo3(void *pvParameters)
 //					PRINTF("\n\rError no se encontro la cola de datos.\n\r");
 //			}
 
-			if (canMsg_Nodo3_read.can_id == Subscripciones[NODO1].IdSub)
+			if (statusRx == ERROR_CAN_OK
+					&& secuencia != secuenciaAnterior[NODO1])
 			{
-				adc_read = canMsg_Nodo3_read.data[1];
-				adc_read = (adc_read << 8) | canMsg_Nodo3_read.data[0];
+				secuenciaAnterior[NODO1] = secuencia;
+				nodo3_luz(&canMsg_Nodo3_read);
 			}
 
-			statusRx = CAN_readMsg(&canMsg_Nodo3_read,
+			statusRx = CAN_readLatest(&canMsg_Nodo3_read,
 					Subscripciones[NODO2].IdSub,
-					Subscripciones[NODO2].taskHandle);
+					Subscripciones[NODO2].taskHandle, &secuencia);
 //			if (statusRx != ERROR_CAN_OK)
 //			{
 //				if (statusRx == ERROR_CAN_QUEUERX)
@@ -157,13 +222,11 @@ static void taskRtos_Nodo3(void *pvParameters)
 //					PRINTF("\n\rError desconocido.\n\r");
 //			}
 
-			if (canMsg_Nodo3_read.can_id == Subscripciones[NODO2].IdSub)
+			if (statusRx == ERROR_CAN_OK
+					&& secuencia != secuenciaAnterior[NODO2])
 			{
-				perifericos.data = canMsg_Nodo3_read.data[0];
-
-				estLedRojo = perifericos.LED_ROJO;
-				estSW1 = perifericos.PULSADOR1;
-				estSW2 = perifericos.PULSADOR2;
+				secuenciaAnterior[NODO2] = secuencia;
+				nodo3_perifericos(&canMsg_Nodo3_read);
 			}
 		}
 	}
@@ -185,6 +248,64 @@ static void timerRtos_DatosSerial(void *pvParameters)
 	return;
 }
 
+static void nodo3_luz(const struct can_frame *frame)
+{
+	adc_read = frame->data[1];
+	adc_read = (adc_read << 8) | frame->data[0];
+
+	return;
+}
+
+static void nodo3_perifericos(const struct can_frame *frame)
+{
+	perifericos.data = frame->data[0];
+
+	estLedRojo = perifericos.LED_ROJO;
+	estSW1 = perifericos.PULSADOR1;
+	estSW2 = perifericos.PULSADOR2;
+
+	return;
+}
+
+static void nodo3_pedir(uint32_t nodos)
+{
+	struct can_frame respuesta;
+
+	if ((nodos & SIN_DATOS_NODO1)
+			&& CAN_request(Nodo1_id(), pdMS_TO_TICKS(TIEMPO_PEDIDO),
+					&respuesta) == ERROR_CAN_OK)
+		nodo3_luz(&respuesta);
+	else if (nodos & SIN_DATOS_NODO1)
+		PRINTF("\n\rNodo 3: sin respuesta del nodo 1.\n\r");
+
+	if ((nodos & SIN_DATOS_NODO2)
+			&& CAN_request(Nodo2_id(), pdMS_TO_TICKS(TIEMPO_PEDIDO),
+					&respuesta) == ERROR_CAN_OK)
+		nodo3_perifericos(&respuesta);
+	else if (nodos & SIN_DATOS_NODO2)
+		PRINTF("\n\rNodo 3: sin respuesta del nodo 2.\n\r");
+
+	return;
+}
+
+static void nodo3_supervision(uint16_t nodeId, bool presente, void *contexto)
+{
+	/* El nodo ya viene identificado por el bit del contexto */
+	(void) nodeId;
+
+	/* Corre en la tarea de recepcion: solo marca y avisa */
+	if (presente)
+		return;
+
+	taskENTER_CRITICAL();
+	sinDatos |= (uint32_t) contexto;
+	taskEXIT_CRITICAL();
+
+	xTaskNotifyGive(TaskNodo3_Handle);
+
+	return;
+}
+
 extern canid_t Nodo3_id(void)
 {
 	canid_t id = CAN_NODO3_ID;
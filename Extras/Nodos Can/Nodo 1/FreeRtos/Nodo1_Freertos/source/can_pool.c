@@ -0,0 +1,104 @@
+/**
+ * @file can_pool.c
+ * @brief Pool estatico de mensajes recibidos con cuenta de referencias.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ */
+
+#include "can_pool.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <string.h>
+
+#define CAN_POOL_FIN	0xFFU
+
+/* Variables */
+static CAN_PoolFrame_t pool[CAN_POOL_SIZE];
+/**
+ * @brief Primera entrada libre.
+ */
+static uint8_t libre = CAN_POOL_FIN;
+static CAN_PoolStats_t stats;
+
+/* Funciones */
+extern void can_pool_init(void)
+{
+	taskENTER_CRITICAL();
+
+	memset(pool, 0, sizeof(pool));
+	memset(&stats, 0, sizeof(stats));
+
+	for (uint32_t i = 0; i < CAN_POOL_SIZE; i++)
+		pool[i].siguiente = (i + 1 < CAN_POOL_SIZE) ? (uint8_t) (i + 1) :
+		CAN_POOL_FIN;
+	libre = 0;
+
+	taskEXIT_CRITICAL();
+
+	return;
+}
+
+extern CAN_FrameRef_t can_pool_alloc(void)
+{
+	CAN_FrameRef_t ref = NULL;
+
+	taskENTER_CRITICAL();
+
+	if (libre != CAN_POOL_FIN)
+	{
+		ref = &pool[libre];
+		libre = ref->siguiente;
+		ref->refs = 1;
+
+		if (++stats.enUso > stats.maxEnUso)
+			stats.maxEnUso = stats.enUso;
+	}
+	else
+	{
+		stats.fallas++;
+	}
+
+	taskEXIT_CRITICAL();
+
+	return ref;
+}
+
+extern void can_pool_retain(CAN_FrameRef_t ref)
+{
+	configASSERT(ref != NULL && ref->refs > 0);
+
+	taskENTER_CRITICAL();
+	ref->refs++;
+	taskEXIT_CRITICAL();
+
+	return;
+}
+
+extern void can_pool_release(CAN_FrameRef_t ref)
+{
+	configASSERT(ref != NULL && ref->refs > 0);
+
+	taskENTER_CRITICAL();
+
+	if (--ref->refs == 0)
+	{
+		ref->siguiente = libre;
+		libre = (uint8_t) (ref - pool);
+		stats.enUso--;
+	}
+
+	taskEXIT_CRITICAL();
+
+	return;
+}
+
+extern void can_pool_getStats(CAN_PoolStats_t *resultado)
+{
+	taskENTER_CRITICAL();
+	memcpy(resultado, &stats, sizeof(CAN_PoolStats_t));
+	taskEXIT_CRITICAL();
+
+	return;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file can_pool.h
+ * @brief Pool estatico de mensajes recibidos con cuenta de referencias.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ *
+ * @details Cada mensaje recibido se lee una sola vez desde el mcp2515 a
+ * una entrada del pool. A las colas de los suscriptores se envia solo la
+ * referencia (un puntero de 4 bytes) y cada suscriptor la libera al
+ * terminar de usarla; la entrada vuelve al pool con la ultima liberacion.
+ *
+ * La reserva y la liberacion son O(1) (lista de libres) y se hacen en una
+ * seccion critica corta, por lo que pueden usarse desde cualquier tarea.
+ */
+
+#ifndef CAN_POOL_H_
+#define CAN_POOL_H_
+
+#include <stdint.h>
+
+#include "can.h"
+
+/**
+ * @brief Cantidad de mensajes del pool.
+ *
+ * Debe alcanzar para los mensajes que esperan en todas las colas de los
+ * suscriptores mas el que se esta recibiendo.
+ */
+#ifndef CAN_POOL_SIZE
+#define CAN_POOL_SIZE 16
+#endif
+
+#if CAN_POOL_SIZE > 255
+#error CAN_POOL_SIZE debe ser menor a 256
+#endif
+
+/**
+ * @brief Entrada del pool.
+ */
+typedef struct
+{
+	/**
+	 * @brief Mensaje recibido.
+	 */
+	struct can_frame frame;
+	/**
+	 * @brief Referencias vivas; la entrada esta libre cuando vale 0.
+	 */
+	uint8_t refs;
+	/**
+	 * @brief Siguiente entrada de la lista de libres.
+	 */
+	uint8_t siguiente;
+} CAN_PoolFrame_t;
+
+/**
+ * @brief Referencia a un mensaje del pool.
+ */
+typedef CAN_PoolFrame_t *CAN_FrameRef_t;
+
+/**
+ * @brief Estadisticas del pool.
+ */
+typedef struct
+{
+	/** @brief Entradas ocupadas. */
+	uint32_t enUso;
+	/** @brief Maximo de entradas ocupadas. */
+	uint32_t maxEnUso;
+	/** @brief Reservas fallidas por pool lleno. */
+	uint32_t fallas;
+} CAN_PoolStats_t;
+
+/**
+ * @brief Inicializa la lista de libres.
+ */
+extern void can_pool_init(void);
+/**
+ * @brief Reserva una entrada con una referencia.
+ * @return Referencia al mensaje o NULL si el pool esta lleno.
+ */
+extern CAN_FrameRef_t can_pool_alloc(void);
+/**
+ * @brief Agrega una referencia a un mensaje.
+ * @param[in] ref Mensaje.
+ */
+extern void can_pool_retain(CAN_FrameRef_t ref);
+/**
+ * @brief Libera una referencia; con la ultima el mensaje vuelve al pool.
+ * @param[in] ref Mensaje.
+ */
+extern void can_pool_release(CAN_FrameRef_t ref);
+/**
+ * @brief Copia las estadisticas del pool.
+ * @param[out] stats Lugar donde se cargan los datos.
+ */
+extern void can_pool_getStats(CAN_PoolStats_t *stats);
+
+/**
+ * @brief Acceso al mensaje de una referencia.
+ */
+#define can_pool_frame(ref)	((const struct can_frame*) &(ref)->frame)
+
+#endif /* CAN_POOL_H_ */
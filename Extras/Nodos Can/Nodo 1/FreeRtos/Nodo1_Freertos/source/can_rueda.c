@@ -0,0 +1,150 @@
+/**
+ * @file can_rueda.c
+ * @brief Rueda de tiempos para supervisar vencimientos.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ */
+
+#include "can_rueda.h"
+
+#include <stddef.h>
+
+/* Funciones privadas */
+/**
+ * @brief Ranura de un instante.
+ */
+static uint32_t rueda_ranura(const Rueda_t *rueda, uint32_t instante);
+
+/* Funciones */
+extern void rueda_init(Rueda_t *rueda, uint8_t bits, uint32_t ahora)
+{
+	for (uint32_t i = 0; i < RUEDA_RANURAS; i++)
+		rueda->ranuras[i] = NULL;
+
+	rueda->ocupadas = 0;
+	rueda->bits = bits;
+	rueda->cursor = ahora & ~((1UL << bits) - 1U);
+
+	return;
+}
+
+extern void rueda_armar(Rueda_t *rueda, RuedaNodo_t *nodo,
+		uint32_t vencimiento)
+{
+	uint32_t ranura;
+
+	rueda_quitar(rueda, nodo);
+
+	// Ya vencido: va a la ranura que se revisa primero
+	if ((int32_t) (vencimiento - rueda->cursor) < 0)
+		ranura = rueda_ranura(rueda, rueda->cursor);
+	else
+		ranura = rueda_ranura(rueda, vencimiento);
+
+	nodo->vencimiento = vencimiento;
+	nodo->ranura = (uint8_t) ranura;
+
+	nodo->siguiente = rueda->ranuras[ranura];
+	if (nodo->siguiente != NULL)
+		nodo->siguiente->anterior = &nodo->siguiente;
+	nodo->anterior = &rueda->ranuras[ranura];
+	rueda->ranuras[ranura] = nodo;
+
+	rueda->ocupadas |= 1UL << ranura;
+
+	return;
+}
+
+extern void rueda_quitar(Rueda_t *rueda, RuedaNodo_t *nodo)
+{
+	if (!rueda_armado(nodo))
+		return;
+
+	*nodo->anterior = nodo->siguiente;
+	if (nodo->siguiente != NULL)
+		nodo->siguiente->anterior = nodo->anterior;
+	nodo->anterior = NULL;
+
+	if (rueda->ranuras[nodo->ranura] == NULL)
+		rueda->ocupadas &= ~(1UL << nodo->ranura);
+
+	return;
+}
+
+extern RuedaNodo_t* rueda_vencido(Rueda_t *rueda, uint32_t ahora)
+{
+	const uint32_t ranura = 1UL << rueda->bits;
+
+	/* Despues de mas de una vuelta alcanza con revisar cada ranura una vez */
+	if (ahora - rueda->cursor >= RUEDA_RANURAS * ranura
+			&& (int32_t) (ahora - rueda->cursor) > 0)
+		rueda->cursor = (ahora & ~(ranura - 1U))
+				- (RUEDA_RANURAS - 1U) * ranura;
+
+	for (;;)
+	{
+		uint32_t n = rueda_ranura(rueda, rueda->cursor);
+
+		if (rueda->ocupadas & (1UL << n))
+		{
+			for (RuedaNodo_t *nodo = rueda->ranuras[n]; nodo != NULL;
+					nodo = nodo->siguiente)
+			{
+				if ((int32_t) (ahora - nodo->vencimiento) >= 0)
+				{
+					rueda_quitar(rueda, nodo);
+					return nodo;
+				}
+			}
+		}
+
+		// La ranura de ahora se vuelve a revisar en la proxima llamada
+		if ((int32_t) (ahora - rueda->cursor) < (int32_t) ranura)
+			return NULL;
+
+		rueda->cursor += ranura;
+	}
+}
+
+extern uint32_t rueda_espera(const Rueda_t *rueda, uint32_t ahora)
+{
+	const uint32_t ranura = 1UL << rueda->bits;
+	uint32_t actual = rueda_ranura(rueda, rueda->cursor);
+	uint32_t espera = RUEDA_SIN_VENCIMIENTOS;
+
+	if (rueda->ocupadas == 0)
+		return RUEDA_SIN_VENCIMIENTOS;
+
+	/* En la ranura actual, el vencimiento exacto de los de esta vuelta */
+	for (const RuedaNodo_t *nodo = rueda->ranuras[actual]; nodo != NULL;
+			nodo = nodo->siguiente)
+	{
+		int32_t falta = (int32_t) (nodo->vencimiento - ahora);
+
+		if (falta <= 0)
+			return 0;
+		if ((uint32_t) falta < espera
+				&& nodo->vencimiento - rueda->cursor < ranura)
+			espera = (uint32_t) falta;
+	}
+
+	/* Si no, el comienzo de la proxima ranura ocupada */
+	for (uint32_t k = 1; k <= RUEDA_RANURAS; k++)
+	{
+		if (rueda->ocupadas & (1UL << ((actual + k) & (RUEDA_RANURAS - 1U))))
+		{
+			uint32_t comienzo = rueda->cursor + k * ranura - ahora;
+
+			if (comienzo < espera)
+				espera = comienzo;
+			break;
+		}
+	}
+
+	return espera;
+}
+
+static uint32_t rueda_ranura(const Rueda_t *rueda, uint32_t instante)
+{
+	return (instante >> rueda->bits) & (RUEDA_RANURAS - 1U);
+}
@@ -0,0 +1,138 @@
+/**
+ * @file can_rueda.h
+ * @brief Rueda de tiempos para supervisar vencimientos.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ *
+ * @details Cada elemento supervisado tiene un nodo con su vencimiento, que
+ * se ubica en la ranura (vencimiento >> bits) % RUEDA_RANURAS. Armar
+ * o quitar un nodo es O(1) (lista doble por ranura), por lo que rearmarlo
+ * con cada mensaje recibido no depende de cuantos se supervisen.
+ *
+ * Al avanzar se recorren solo las ranuras por las que paso el tiempo; los
+ * nodos que vencen en una vuelta posterior quedan en su ranura. Un mapa
+ * de bits de ranuras ocupadas da el proximo vencimiento sin recorrerlas,
+ * para que quien la atiende pueda dormir hasta entonces.
+ *
+ * El modulo no toma ningun lock ni depende del sdk: quien lo usa protege
+ * las llamadas (en CanApi con una seccion critica corta), y puede
+ * compilarse en la pc.
+ */
+
+#ifndef CAN_RUEDA_H_
+#define CAN_RUEDA_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Cantidad de ranuras (potencia de 2, hasta 32 por el mapa).
+ */
+#ifndef RUEDA_RANURAS
+#define RUEDA_RANURAS		32U
+#endif
+
+#if (RUEDA_RANURAS & (RUEDA_RANURAS - 1)) || RUEDA_RANURAS > 32
+#error RUEDA_RANURAS debe ser una potencia de 2 menor o igual a 32
+#endif
+
+/**
+ * @brief Espera de rueda_espera() sin nodos armados.
+ */
+#define RUEDA_SIN_VENCIMIENTOS	0xFFFFFFFFU
+
+/**
+ * @brief Elemento de la rueda, dentro de la estructura supervisada.
+ */
+typedef struct RuedaNodo
+{
+	/**
+	 * @brief Siguiente de la ranura.
+	 */
+	struct RuedaNodo *siguiente;
+	/**
+	 * @brief Puntero que apunta a este nodo, o NULL si no esta armado.
+	 */
+	struct RuedaNodo **anterior;
+	/**
+	 * @brief Instante en que vence [ticks].
+	 */
+	uint32_t vencimiento;
+	/**
+	 * @brief Ranura en la que esta.
+	 */
+	uint8_t ranura;
+} RuedaNodo_t;
+
+/**
+ * @brief Rueda de tiempos.
+ */
+typedef struct
+{
+	/**
+	 * @brief Primer nodo de cada ranura.
+	 */
+	RuedaNodo_t *ranuras[RUEDA_RANURAS];
+	/**
+	 * @brief Bit n en 1 si la ranura n tiene nodos.
+	 */
+	uint32_t ocupadas;
+	/**
+	 * @brief Cada ranura cubre (1 << bits) ticks.
+	 */
+	uint8_t bits;
+	/**
+	 * @brief Comienzo de la ranura que falta revisar [ticks].
+	 */
+	uint32_t cursor;
+} Rueda_t;
+
+/**
+ * @brief Inicializa una rueda vacia.
+ * @param[out] *rueda Rueda.
+ * @param[in] bits Cada ranura cubre (1 << bits) ticks y una vuelta
+ * RUEDA_RANURAS veces eso. Con potencias de 2 la ranura de un instante no
+ * salta cuando la cuenta de ticks da la vuelta.
+ * @param[in] ahora Tick actual.
+ */
+extern void rueda_init(Rueda_t *rueda, uint8_t bits, uint32_t ahora);
+/**
+ * @brief Arma o rearma un nodo para que venza en el instante indicado.
+ * @param[in] *rueda Rueda.
+ * @param[in] *nodo Nodo, armado o no.
+ * @param[in] vencimiento Instante de vencimiento [ticks].
+ */
+extern void rueda_armar(Rueda_t *rueda, RuedaNodo_t *nodo,
+		uint32_t vencimiento);
+/**
+ * @brief Quita un nodo de la rueda; no hace nada si no estaba armado.
+ */
+extern void rueda_quitar(Rueda_t *rueda, RuedaNodo_t *nodo);
+/**
+ * @brief Indica si un nodo esta armado.
+ */
+#define rueda_armado(nodo)	((nodo)->anterior != NULL)
+/**
+ * @brief Saca de la rueda un nodo vencido.
+ *
+ * Se llama hasta que devuelva NULL; cada llamada sigue el recorrido donde
+ * quedo la anterior, por lo que el costo total es el de las ranuras por
+ * las que paso el tiempo mas el de los nodos que hay en ellas.
+ * @param[in] *rueda Rueda.
+ * @param[in] ahora Tick actual.
+ * @return El nodo vencido, ya quitado, o NULL si no hay mas.
+ */
+extern RuedaNodo_t* rueda_vencido(Rueda_t *rueda, uint32_t ahora);
+/**
+ * @brief Ticks hasta el proximo vencimiento posible.
+ *
+ * Para la ranura actual es el vencimiento exacto; para las siguientes es
+ * el comienzo de la primera ocupada, que puede tener nodos de una vuelta
+ * posterior (se despierta antes y se vuelve a calcular).
+ * @param[in] *rueda Rueda, con los vencidos ya sacados.
+ * @param[in] ahora Tick actual.
+ * @return Ticks de espera, o RUEDA_SIN_VENCIMIENTOS.
+ */
+extern uint32_t rueda_espera(const Rueda_t *rueda, uint32_t ahora);
+
+#endif /* CAN_RUEDA_H_ */
@@ -0,0 +1,213 @@
+/**
+ * @file can_stats.c
+ * @brief Contadores de uso del spi y del driver del mcp2515.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ */
+
+#include "can_stats.h"
+
+#if CAN_STATS_ENABLE
+
+#include "mcp2515.h"
+#include <string.h>
+
+#if defined(__arm__)
+
+#include "MKL46Z4.h"
+#include "fsl_debug_console.h"
+
+#if USE_FREERTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
+
+#else
+
+#include <stdio.h>
+#include <time.h>
+
+#define PRINTF printf
+
+#endif
+
+/* Variables */
+static STATS_t stats;
+
+/**
+ * @brief Instruccion de la ventana de chip select abierta.
+ */
+static STATS_INST_t instActual = STATS_INST_OTRA;
+/**
+ * @brief Indica si ya se identifico la instruccion de la ventana.
+ */
+static bool instDetectada = false;
+/**
+ * @brief Indica si hay una ventana abierta.
+ */
+static bool ventanaAbierta = false;
+/**
+ * @brief Marca de tiempo de la apertura de la ventana.
+ */
+static uint32_t inicioVentana;
+
+static const char *const nombresInst[STATS_INST_CANT] =
+{ "WRITE", "READ", "BITMOD", "READ_STATUS", "RESET", "OTRA", };
+
+/* Funciones privadas */
+/**
+ * @brief Traduce el byte de instruccion al indice de la tabla.
+ * @param[in] inst byte enviado al mcp2515
+ * @return Indice de la tabla de instrucciones.
+ */
+static STATS_INST_t can_stats_instIndex(uint8_t inst);
+
+/* Funciones */
+__attribute__((weak)) extern uint32_t can_stats_timestamp(void)
+{
+#if defined(__arm__)
+	/*
+	 * El systick cuenta hacia abajo desde LOAD. Con freertos se extiende
+	 * con la cuenta de ticks para medir ventanas de varios milisegundos;
+	 * sin rtos solo se mide dentro de un periodo del systick.
+	 * */
+	uint32_t reload = SysTick->LOAD + 1U;
+	uint32_t cuenta = reload - 1U - SysTick->VAL;
+
+#if USE_FREERTOS
+	cuenta += (uint32_t) xTaskGetTickCount() * reload;
+#endif
+
+	return cuenta;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint32_t) ((uint64_t) ts.tv_sec * 1000000000U + ts.tv_nsec);
+#endif
+}
+
+extern void can_stats_spiTransfer(const uint8_t *tx, uint16_t n, bool ok)
+{
+	stats.transferencias++;
+
+	if (tx != NULL)
+		stats.bytesTx += n;
+	else
+		stats.bytesRx += n;
+
+	if (!ok)
+		stats.errores++;
+
+	if (ventanaAbierta)
+	{
+		/* El primer byte de cada ventana es la instruccion */
+		if (!instDetectada && tx != NULL && n > 0)
+		{
+			instActual = can_stats_instIndex(tx[0]);
+			instDetectada = true;
+		}
+
+		stats.inst[instActual].bytes += n;
+		if (!ok)
+			stats.inst[instActual].errores++;
+	}
+
+	return;
+}
+
+extern void can_stats_csBegin(void)
+{
+	stats.ventanasCs++;
+
+	instActual = STATS_INST_OTRA;
+	instDetectada = false;
+	ventanaAbierta = true;
+	inicioVentana = can_stats_timestamp();
+
+	return;
+}
+
+extern void can_stats_csEnd(void)
+{
+	uint32_t duracion;
+	STATS_Inst_t *inst;
+
+	if (!ventanaAbierta)
+		return;
+
+	duracion = can_stats_timestamp() - inicioVentana;
+	ventanaAbierta = false;
+
+	inst = &stats.inst[instActual];
+	inst->ventanas++;
+	inst->tiempoTotal += duracion;
+	if (duracion > inst->tiempoMax)
+		inst->tiempoMax = duracion;
+
+	return;
+}
+
+extern void can_stats_get(STATS_t *_stats)
+{
+	memcpy(_stats, &stats, sizeof(STATS_t));
+
+	return;
+}
+
+extern void can_stats_reset(void)
+{
+	memset(&stats, 0, sizeof(STATS_t));
+	ventanaAbierta = false;
+
+	return;
+}
+
+extern void can_stats_dump(void)
+{
+	STATS_t copia;
+
+	can_stats_get(&copia);
+
+	PRINTF("\r\n--- Estadisticas spi/mcp2515 ---\r\n");
+	PRINTF("Transferencias: %u  Bytes tx: %u  Bytes rx: %u\r\n",
+			(unsigned) copia.transferencias, (unsigned) copia.bytesTx,
+			(unsigned) copia.bytesRx);
+	PRINTF("Ventanas CS: %u  Errores: %u\r\n", (unsigned) copia.ventanasCs,
+			(unsigned) copia.errores);
+	PRINTF("Instruccion   Ventanas  Bytes  Errores  Tiempo total  Tiempo max\r\n");
+
+	for (int i = 0; i < STATS_INST_CANT; i++)
+	{
+		PRINTF("%-12s  %8u  %5u  %7u  %12u  %10u\r\n", nombresInst[i],
+				(unsigned) copia.inst[i].ventanas,
+				(unsigned) copia.inst[i].bytes,
+				(unsigned) copia.inst[i].errores,
+				(unsigned) copia.inst[i].tiempoTotal,
+				(unsigned) copia.inst[i].tiempoMax);
+	}
+
+	return;
+}
+
+static STATS_INST_t can_stats_instIndex(uint8_t inst)
+{
+	switch (inst)
+	{
+	case INSTRUCTION_WRITE:
+		return STATS_INST_WRITE;
+	case INSTRUCTION_READ:
+		return STATS_INST_READ;
+	case INSTRUCTION_BITMOD:
+		return STATS_INST_BITMOD;
+	case INSTRUCTION_READ_STATUS:
+		return STATS_INST_READ_STATUS;
+	case INSTRUCTION_RESET:
+		return STATS_INST_RESET;
+	default:
+		return STATS_INST_OTRA;
+	}
+}
+
+#endif /* CAN_STATS_ENABLE */
@@ -0,0 +1,144 @@
+/**
+ * @file can_stats.h
+ * @brief Contadores de uso del spi y del driver del mcp2515.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ *
+ * @details Permite medir cuantas transferencias y bytes pasan por el
+ * spi, cuantas ventanas de chip select se abren, cuantos errores se
+ * producen y cuanto tiempo se mantiene ocupado el bus por cada
+ * instruccion del mcp2515. Todo se habilita en tiempo de compilacion
+ * con CAN_STATS_ENABLE; si vale 0 los macros de instrumentacion no
+ * generan codigo y el modulo no ocupa memoria.
+ *
+ * El modulo no depende del sdk, por lo que tambien puede compilarse
+ * en la pc (host) junto con un spi simulado.
+ */
+
+#ifndef CAN_STATS_H_
+#define CAN_STATS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Habilitacion de las estadisticas.
+ *
+ * Si se define en '1' se cuentan las transferencias del spi y los
+ * tiempos por instruccion. Con '0' todo queda fuera del binario.
+ */
+#ifndef CAN_STATS_ENABLE
+#define CAN_STATS_ENABLE 0
+#endif
+
+/**
+ * @brief Instrucciones del mcp2515 que se contabilizan por separado.
+ */
+typedef enum
+{
+	STATS_INST_WRITE = 0,
+	STATS_INST_READ,
+	STATS_INST_BITMOD,
+	STATS_INST_READ_STATUS,
+	STATS_INST_RESET,
+	/** @brief Cualquier otra instruccion (load tx, rts, rx status, etc). */
+	STATS_INST_OTRA,
+	STATS_INST_CANT,
+} STATS_INST_t;
+
+/**
+ * @brief Contadores por instruccion.
+ */
+typedef struct
+{
+	/** @brief Ventanas de chip select con esta instruccion. */
+	uint32_t ventanas;
+	/** @brief Bytes transferidos dentro de esas ventanas. */
+	uint32_t bytes;
+	/** @brief Errores del spi dentro de esas ventanas. */
+	uint32_t errores;
+	/** @brief Tiempo total con el chip select en bajo. */
+	uint32_t tiempoTotal;
+	/** @brief Ventana mas larga. */
+	uint32_t tiempoMax;
+} STATS_Inst_t;
+
+/**
+ * @brief Contadores globales del spi.
+ */
+typedef struct
+{
+	/** @brief Llamadas a spi_write/spi_receive. */
+	uint32_t transferencias;
+	/** @brief Bytes enviados. */
+	uint32_t bytesTx;
+	/** @brief Bytes recibidos. */
+	uint32_t bytesRx;
+	/** @brief Transferencias que terminaron con error. */
+	uint32_t errores;
+	/** @brief Ventanas de chip select abiertas. */
+	uint32_t ventanasCs;
+	/** @brief Detalle por instruccion. */
+	STATS_Inst_t inst[STATS_INST_CANT];
+} STATS_t;
+
+#if CAN_STATS_ENABLE
+
+/**
+ * @brief Registra una transferencia del spi.
+ *
+ * Si es la primera transferencia de la ventana de chip select se toma
+ * el primer byte como instruccion del mcp2515.
+ *
+ * @param[in] tx datos enviados, NULL si es una recepcion
+ * @param[in] n cantidad de bytes
+ * @param[in] ok true si la transferencia termino sin errores
+ */
+extern void can_stats_spiTransfer(const uint8_t *tx, uint16_t n, bool ok);
+/**
+ * @brief Marca la apertura de una ventana de chip select.
+ */
+extern void can_stats_csBegin(void);
+/**
+ * @brief Marca el cierre de la ventana y acumula el tiempo ocupado.
+ */
+extern void can_stats_csEnd(void);
+/**
+ * @brief Marca de tiempo usada para medir las ventanas.
+ *
+ * En la placa se mide en ciclos de reloj a partir del systick; en la
+ * pc se mide en nanosegundos. Puede redefinirse desde la aplicacion.
+ *
+ * @return Marca de tiempo actual.
+ */
+extern uint32_t can_stats_timestamp(void);
+/**
+ * @brief Copia los contadores actuales.
+ * @param[out] stats lugar donde se cargan los contadores
+ */
+extern void can_stats_get(STATS_t *stats);
+/**
+ * @brief Pone a cero todos los contadores.
+ */
+extern void can_stats_reset(void);
+/**
+ * @brief Imprime los contadores por consola.
+ */
+extern void can_stats_dump(void);
+
+#define CAN_STATS_SPI(tx, n, ok)	can_stats_spiTransfer((tx), (n), (ok))
+#define CAN_STATS_CS_BEGIN()		can_stats_csBegin()
+#define CAN_STATS_CS_END()			can_stats_csEnd()
+
+#else
+
+#define CAN_STATS_SPI(tx, n, ok)	((void)0)
+#define CAN_STATS_CS_BEGIN()		((void)0)
+#define CAN_STATS_CS_END()			((void)0)
+
+#define can_stats_reset()			((void)0)
+#define can_stats_dump()			((void)0)
+
+#endif /* CAN_STATS_ENABLE */
+
+#endif /* CAN_STATS_H_ */
@@ -0,0 +1,477 @@
+/**
+ * @file diag.c
+ * @brief Diagnostico en ejecucion: uso de cpu, pilas, colas y latencias.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ */
+
+#include "diag.h"
+
+#if DIAG_ENABLE
+
+#include "MKL46Z4.h"
+#include "fsl_tpm.h"
+#include "fsl_clock.h"
+#include "fsl_debug_console.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <string.h>
+
+#include "CanApi.h"
+#include "can_pool.h"
+#include "rtos_estatico.h"
+#include "tickless.h"
+#include "mtb_trace.h"
+
+#define DIAG_TPM			TPM2
+#define DIAG_TPM_IRQ		TPM2_IRQn
+#define DIAG_TPM_PRESCALER	kTPM_Prescale_Divide_64
+#define DIAG_TPM_DIVISOR	64U
+
+/**
+ * @brief Periodo de consulta de la consola [ms].
+ */
+#define DIAG_CONSOLA_MS		100
+/**
+ * @brief Tareas que entran en el listado.
+ */
+#define DIAG_MAX_TAREAS		10
+
+/* Variables */
+/**
+ * @brief Desbordes del TPM, la parte alta del contador.
+ */
+static volatile uint32_t desbordes = 0;
+/**
+ * @brief Frecuencia del contador [Hz].
+ */
+static uint32_t frecuencia = 1;
+/**
+ * @brief Contadores por id.
+ */
+static DIAG_Id_t ids[DIAG_MAX_IDS];
+static uint32_t cantIds = 0;
+/**
+ * @brief Ids que no entraron en la tabla.
+ */
+static uint32_t idsSinLugar = 0;
+/**
+ * @brief Histograma de latencia de recepcion y su maximo [cuentas].
+ */
+static uint32_t histograma[DIAG_HISTOGRAMA];
+static uint32_t latenciaMax = 0;
+/**
+ * @brief Estado de las tareas, fuera de la pila de la tarea de diagnostico.
+ */
+static TaskStatus_t tareas[DIAG_MAX_TAREAS];
+
+/* Funciones privadas */
+/**
+ * @brief Tarea de diagnostico: consola y mensaje periodico.
+ */
+static void taskRtos_Diag(void *pvParameters);
+/**
+ * @brief Lee un caracter de la consola sin bloquear.
+ * @return Caracter o 0 si no hay.
+ */
+static char diag_consola(void);
+/**
+ * @brief Arma una pagina del mensaje de diagnostico.
+ * @param[out] *frame Mensaje.
+ * @param[in] pagina Pagina a armar.
+ */
+static void diag_frame(struct can_frame *frame, DIAG_PAGINA_t pagina);
+/**
+ * @brief Busca (o agrega) los contadores de una id.
+ * @return NULL si la tabla esta llena.
+ */
+static DIAG_Id_t* diag_buscarId(uint32_t id);
+/**
+ * @brief Percentil del histograma.
+ * @param[in] porcentaje Percentil buscado.
+ * @return Cota superior de la cubeta [us].
+ */
+static uint32_t diag_percentil(uint32_t porcentaje);
+/**
+ * @brief Convierte cuentas del contador a microsegundos.
+ */
+static uint32_t diag_us(uint32_t cuentas);
+/**
+ * @brief Guarda un valor de 16 bits saturado en little endian.
+ */
+static void diag_guardar16(uint8_t *destino, uint32_t valor);
+
+RTOS_TAREA_MEMORIA(taskRtos_Diag, configMINIMAL_STACK_SIZE + 100);
+
+/* Funciones */
+extern void diag_init(void)
+{
+	BaseType_t status = RTOS_TAREA_CREAR(taskRtos_Diag, "Task Diag", NULL,
+			tskIDLE_PRIORITY + 1, NULL);
+	if (status != pdPASS)
+		PRINTF("Fallo al crear la tarea.\n\r");
+
+	return;
+}
+
+extern void diag_timerInit(void)
+{
+	tpm_config_t config;
+
+	/* Fuente del TPM: MCGFLLCLK (o MCGPLLCLK/2) */
+	CLOCK_SetTpmClock(1U);
+	frecuencia = CLOCK_GetFreq(kCLOCK_PllFllSelClk) / DIAG_TPM_DIVISOR;
+
+	TPM_GetDefaultConfig(&config);
+	config.prescale = DIAG_TPM_PRESCALER;
+	TPM_Init(DIAG_TPM, &config);
+
+	TPM_SetTimerPeriod(DIAG_TPM, 0xFFFFU);
+	TPM_EnableInterrupts(DIAG_TPM, kTPM_TimeOverflowInterruptEnable);
+	EnableIRQ(DIAG_TPM_IRQ);
+
+	TPM_StartTimer(DIAG_TPM, kTPM_SystemClock);
+
+	return;
+}
+
+extern uint32_t diag_contador(void)
+{
+	uint32_t altos, cuenta, desborde;
+
+	/* Repite si el desborde se atendio en medio de la lectura */
+	do
+	{
+		altos = desbordes;
+		cuenta = TPM_GetCurrentTimerCount(DIAG_TPM);
+		desborde = TPM_GetStatusFlags(DIAG_TPM) & kTPM_TimeOverflowFlag;
+	} while (altos != desbordes);
+
+	/*
+	 * Desbordo pero la interrupcion todavia no se atendio (interrupciones
+	 * deshabilitadas): se suma el desborde que falta.
+	 * */
+	if (desborde && cuenta < 0x8000U)
+		altos++;
+
+	return (altos << 16) | cuenta;
+}
+
+extern void diag_rx(uint32_t id)
+{
+	uint32_t primask = __get_PRIMASK();
+	DIAG_Id_t *d;
+
+	__disable_irq();
+	d = diag_buscarId(id);
+	if (d != NULL)
+		d->rx++;
+	__set_PRIMASK(primask);
+
+	return;
+}
+
+extern void diag_tx(uint32_t id)
+{
+	uint32_t primask = __get_PRIMASK();
+	DIAG_Id_t *d;
+
+	__disable_irq();
+	d = diag_buscarId(id);
+	if (d != NULL)
+		d->tx++;
+	__set_PRIMASK(primask);
+
+	return;
+}
+
+extern void diag_latencia(uint32_t marca)
+{
+	uint32_t cuentas = diag_contador() - marca;
+	uint32_t cubeta = (cuentas == 0) ? 0 : 32U - __builtin_clz(cuentas);
+	uint32_t primask = __get_PRIMASK();
+
+	if (cubeta >= DIAG_HISTOGRAMA)
+		cubeta = DIAG_HISTOGRAMA - 1;
+
+	__disable_irq();
+	histograma[cubeta]++;
+	if (cuentas > latenciaMax)
+		latenciaMax = cuentas;
+	__set_PRIMASK(primask);
+
+	return;
+}
+
+extern void diag_reset(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	cantIds = 0;
+	idsSinLugar = 0;
+	memset(histograma, 0, sizeof(histograma));
+	latenciaMax = 0;
+	__set_PRIMASK(primask);
+
+	tickless_reset();
+
+	return;
+}
+
+extern void diag_dump(void)
+{
+	CAN_TxStats_t tx;
+	CAN_PoolStats_t pool;
+	uint32_t total, cantidad;
+
+	cantidad = uxTaskGetSystemState(tareas, DIAG_MAX_TAREAS, &total);
+	total /= 100;	// Para el porcentaje
+
+	PRINTF("\r\n--- Diagnostico (contador %u Hz) ---\r\n",
+			(unsigned) frecuencia);
+	PRINTF("Tarea                 Prio  Pila libre   CPU\r\n");
+	for (uint32_t i = 0; i < cantidad; i++)
+	{
+		PRINTF("%-20s  %4u  %10u  %3u%%\r\n", tareas[i].pcTaskName,
+				(unsigned) tareas[i].uxCurrentPriority,
+				(unsigned) tareas[i].usStackHighWaterMark,
+				(unsigned) (total ? tareas[i].ulRunTimeCounter / total : 0));
+	}
+
+	PRINTF("Heap libre: %u  minimo: %u\r\n", (unsigned) xPortGetFreeHeapSize(),
+			(unsigned) xPortGetMinimumEverFreeHeapSize());
+
+	CAN_getTxStats(&tx);
+	can_pool_getStats(&pool);
+	PRINTF("Cola tx maximo: %u  colas rx maximo: %u  pool maximo: %u\r\n",
+			(unsigned) tx.colaMax, (unsigned) CAN_getRxQueueMax(),
+			(unsigned) pool.maxEnUso);
+	PRINTF("Enviados: %u  descartados: %u  locales: %u\r\n",
+			(unsigned) tx.enviados, (unsigned) tx.descartados,
+			(unsigned) tx.locales);
+
+	PRINTF("Id          Rx        Tx\r\n");
+	for (uint32_t i = 0; i < cantIds; i++)
+		PRINTF("0x%03x  %8u  %8u\r\n", (unsigned) ids[i].id,
+				(unsigned) ids[i].rx, (unsigned) ids[i].tx);
+	if (idsSinLugar)
+		PRINTF("(%u mensajes de ids sin lugar en la tabla)\r\n",
+				(unsigned) idsSinLugar);
+
+	PRINTF("Latencia INT a suscriptor (us)\r\n");
+	for (uint32_t i = 0; i < DIAG_HISTOGRAMA; i++)
+	{
+		if (histograma[i])
+			PRINTF("  < %7u  %8u\r\n", (unsigned) diag_us(1U << i),
+					(unsigned) histograma[i]);
+	}
+	PRINTF("  maximo %u\r\n", (unsigned) diag_us(latenciaMax));
+
+#if RTOS_TICKLESS
+	TICKLESS_Stats_t tl;
+
+	tickless_getStats(&tl);
+	PRINTF("Tickless: %u dormidas (%u en WAIT), %u abortadas, %u ticks\r\n",
+			(unsigned) tl.dormidas, (unsigned) tl.enEspera,
+			(unsigned) tl.abortadas, (unsigned) tl.ticksDormidos);
+	PRINTF("  despertares timer %u  can %u  otros %u\r\n",
+			(unsigned) tl.porTimer, (unsigned) tl.porCan,
+			(unsigned) tl.porOtras);
+	if (tl.latencias)
+		PRINTF("  despertar a suscriptor (us) min %u  media %u  max %u\r\n",
+				(unsigned) diag_us(tl.latenciaMin),
+				(unsigned) diag_us(tl.latenciaTotal / tl.latencias),
+				(unsigned) diag_us(tl.latenciaMax));
+#endif
+
+	return;
+}
+
+static void taskRtos_Diag(void *pvParameters)
+{
+	struct can_frame frame;
+	DIAG_PAGINA_t pagina = DIAG_PAGINA_SISTEMA;
+	TickType_t ultimoEnvio = xTaskGetTickCount();
+
+	CAN_getEvent();
+
+	for (;;)
+	{
+		vTaskDelay(pdMS_TO_TICKS(DIAG_CONSOLA_MS));
+
+		switch (diag_consola())
+		{
+		case 'd':
+			diag_dump();
+			break;
+		case 'r':
+			diag_reset();
+			PRINTF("\r\nDiagnostico borrado.\r\n");
+			break;
+		case 't':
+			mtb_trace_arm();
+			break;
+		default:
+			break;
+		}
+
+		if (xTaskGetTickCount() - ultimoEnvio >= pdMS_TO_TICKS(DIAG_PERIODO_MS))
+		{
+			ultimoEnvio += pdMS_TO_TICKS(DIAG_PERIODO_MS);
+
+			diag_frame(&frame, pagina);
+			CAN_sendMsg(&frame, 0);
+
+			pagina = (pagina + 1) % DIAG_CANT_PAGINAS;
+		}
+	}
+
+	vTaskDelete(NULL);
+
+	return;
+}
+
+static char diag_consola(void)
+{
+	/* La consola es la uart0 (lpsci); se consulta sin bloquear */
+	if (!(UART0->S1 & UART0_S1_RDRF_MASK))
+		return 0;
+
+	return (char) UART0->D;
+}
+
+static void diag_frame(struct can_frame *frame, DIAG_PAGINA_t pagina)
+{
+	static uint32_t idleAnterior = 0, totalAnterior = 0;
+	CAN_TxStats_t tx;
+	CAN_PoolStats_t pool;
+	uint32_t total, cantidad, idle = 0, rx = 0, enviados = 0;
+	uint32_t pilaMin = UINT32_MAX;
+
+	memset(frame, 0, sizeof(struct can_frame));
+	frame->can_id = DIAG_ID;
+	frame->can_dlc = 8;
+	frame->data[0] = (uint8_t) pagina;
+
+	CAN_getTxStats(&tx);
+
+	switch (pagina)
+	{
+	case DIAG_PAGINA_SISTEMA:
+		cantidad = uxTaskGetSystemState(tareas, DIAG_MAX_TAREAS, &total);
+		for (uint32_t i = 0; i < cantidad; i++)
+		{
+			if (tareas[i].uxBasePriority == tskIDLE_PRIORITY
+					&& strcmp(tareas[i].pcTaskName, "IDLE") == 0)
+				idle = tareas[i].ulRunTimeCounter;
+			if (tareas[i].usStackHighWaterMark < pilaMin)
+				pilaMin = tareas[i].usStackHighWaterMark;
+		}
+
+		/* Carga desde la pagina anterior: lo que no fue tarea ociosa */
+		if (total != totalAnterior)
+			frame->data[1] = 100U
+					- (uint8_t) (((uint64_t) (idle - idleAnterior) * 100U)
+							/ (total - totalAnterior));
+		idleAnterior = idle;
+		totalAnterior = total;
+
+		can_pool_getStats(&pool);
+		diag_guardar16(&frame->data[2], xPortGetMinimumEverFreeHeapSize());
+		diag_guardar16(&frame->data[4], pilaMin);
+		frame->data[6] = (uint8_t) tx.colaMax;
+		frame->data[7] = (uint8_t) pool.maxEnUso;
+		break;
+
+	case DIAG_PAGINA_CAN:
+		for (uint32_t i = 0; i < cantIds; i++)
+		{
+			rx += ids[i].rx;
+			enviados += ids[i].tx;
+		}
+		diag_guardar16(&frame->data[1], rx);
+		diag_guardar16(&frame->data[3], enviados);
+		diag_guardar16(&frame->data[5], tx.descartados);
+		frame->data[7] = (uint8_t) CAN_getRxQueueMax();
+		break;
+
+	case DIAG_PAGINA_LATENCIA:
+	default:
+		diag_guardar16(&frame->data[1], diag_percentil(50));
+		diag_guardar16(&frame->data[3], diag_percentil(99));
+		diag_guardar16(&frame->data[5], diag_us(latenciaMax));
+		break;
+	}
+
+	return;
+}
+
+static DIAG_Id_t* diag_buscarId(uint32_t id)
+{
+	for (uint32_t i = 0; i < cantIds; i++)
+	{
+		if (ids[i].id == id)
+			return &ids[i];
+	}
+
+	if (cantIds == DIAG_MAX_IDS)
+	{
+		idsSinLugar++;
+		return NULL;
+	}
+
+	ids[cantIds].id = id;
+	ids[cantIds].rx = 0;
+	ids[cantIds].tx = 0;
+
+	return &ids[cantIds++];
+}
+
+static uint32_t diag_percentil(uint32_t porcentaje)
+{
+	uint32_t total = 0, acumulado = 0;
+
+	for (uint32_t i = 0; i < DIAG_HISTOGRAMA; i++)
+		total += histograma[i];
+
+	if (total == 0)
+		return 0;
+
+	for (uint32_t i = 0; i < DIAG_HISTOGRAMA; i++)
+	{
+		acumulado += histograma[i];
+		if ((uint64_t) acumulado * 100U >= (uint64_t) total * porcentaje)
+			return diag_us(1U << i);
+	}
+
+	return diag_us(latenciaMax);
+}
+
+static uint32_t diag_us(uint32_t cuentas)
+{
+	return (uint32_t) (((uint64_t) cuentas * 1000000U) / frecuencia);
+}
+
+static void diag_guardar16(uint8_t *destino, uint32_t valor)
+{
+	if (valor > 0xFFFFU)
+		valor = 0xFFFFU;
+
+	destino[0] = valor & 0xFF;
+	destino[1] = (valor >> 8) & 0xFF;
+
+	return;
+}
+
+void TPM2_IRQHandler(void)
+{
+	TPM_ClearStatusFlags(DIAG_TPM, kTPM_TimeOverflowFlag);
+	desbordes++;
+
+	return;
+}
+
+#endif /* DIAG_ENABLE */
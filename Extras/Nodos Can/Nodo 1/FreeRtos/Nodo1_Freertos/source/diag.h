@@ -0,0 +1,153 @@
+/**
+ * @file diag.h
+ * @brief Diagnostico en ejecucion: uso de cpu, pilas, colas y latencias.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ *
+ * @details Un contador de 32 bits armado con el TPM2 (16 bits mas los
+ * desbordes) sirve de base de tiempo para las estadisticas de ejecucion de
+ * FreeRTOS (configGENERATE_RUN_TIME_STATS) y para medir la latencia desde
+ * la interrupcion del mcp2515 hasta la entrega a los suscriptores.
+ *
+ * Ademas se cuentan los mensajes recibidos y enviados por id. Una tarea de
+ * baja prioridad atiende la consola ('d' imprime el diagnostico, 'r' borra
+ * los contadores, 't' arma una captura del MTB) y envia cada
+ * DIAG_PERIODO_MS el mensaje DIAG_ID, que rota entre tres paginas
+ * (byte 0):
+ *
+ * - DIAG_PAGINA_SISTEMA: [1] carga de cpu [%], [2..3] heap libre minimo
+ *   [bytes], [4..5] pila libre minima entre las tareas [palabras], [6]
+ *   maximo de la cola de transmision, [7] maximo de mensajes del pool.
+ * - DIAG_PAGINA_CAN: [1..2] recibidos, [3..4] enviados, [5..6] descartados
+ *   en transmision, [7] maximo de las colas de los suscriptores.
+ * - DIAG_PAGINA_LATENCIA: [1..2] mediana, [3..4] percentil 99 y [5..6]
+ *   maximo de la latencia de recepcion [us].
+ *
+ * Los valores de 16 bits van en little endian y saturan en 0xFFFF.
+ *
+ * @note Por defecto queda habilitado en debug y deshabilitado en release.
+ */
+
+#ifndef DIAG_H_
+#define DIAG_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Habilitacion del diagnostico.
+ */
+#ifndef DIAG_ENABLE
+#if defined(NDEBUG)
+#define DIAG_ENABLE 0
+#else
+#define DIAG_ENABLE 1
+#endif
+#endif
+
+/**
+ * @brief Id del mensaje de diagnostico.
+ */
+#ifndef DIAG_ID
+#define DIAG_ID				0x7E0
+#endif
+
+/**
+ * @brief Periodo del mensaje de diagnostico [ms].
+ */
+#ifndef DIAG_PERIODO_MS
+#define DIAG_PERIODO_MS		1000
+#endif
+
+/**
+ * @brief Cantidad de ids con contadores propios.
+ */
+#ifndef DIAG_MAX_IDS
+#define DIAG_MAX_IDS		16
+#endif
+
+/**
+ * @brief Cubetas del histograma de latencia.
+ *
+ * La cubeta n cuenta latencias menores a 2^n cuentas del contador.
+ */
+#define DIAG_HISTOGRAMA		16
+
+typedef enum
+{
+	DIAG_PAGINA_SISTEMA = 0,
+	DIAG_PAGINA_CAN,
+	DIAG_PAGINA_LATENCIA,
+	DIAG_CANT_PAGINAS,
+} DIAG_PAGINA_t;
+
+/**
+ * @brief Contadores de una id.
+ */
+typedef struct
+{
+	uint32_t id;
+	uint32_t rx;
+	uint32_t tx;
+} DIAG_Id_t;
+
+#if DIAG_ENABLE
+
+/**
+ * @brief Crea la tarea de diagnostico.
+ */
+extern void diag_init(void);
+/**
+ * @brief Configura el TPM2 como contador libre.
+ *
+ * La llama FreeRTOS al arrancar el planificador
+ * (portCONFIGURE_TIMER_FOR_RUN_TIME_STATS).
+ */
+extern void diag_timerInit(void);
+/**
+ * @brief Valor del contador de 32 bits.
+ * @return Cuentas desde el arranque (con desborde).
+ */
+extern uint32_t diag_contador(void);
+/**
+ * @brief Cuenta un mensaje recibido.
+ * @param[in] id Id del mensaje.
+ */
+extern void diag_rx(uint32_t id);
+/**
+ * @brief Cuenta un mensaje enviado.
+ * @param[in] id Id del mensaje.
+ */
+extern void diag_tx(uint32_t id);
+/**
+ * @brief Agrega una latencia al histograma.
+ * @param[in] marca Valor de diag_contador() al comienzo.
+ */
+extern void diag_latencia(uint32_t marca);
+/**
+ * @brief Imprime el diagnostico por consola.
+ */
+extern void diag_dump(void);
+/**
+ * @brief Borra los contadores por id y el histograma.
+ */
+extern void diag_reset(void);
+
+#define DIAG_MARCA(marca)		((marca) = diag_contador())
+#define DIAG_RX(id)				diag_rx(id)
+#define DIAG_TX(id)				diag_tx(id)
+#define DIAG_LATENCIA(marca)	diag_latencia(marca)
+
+#else
+
+#define diag_init()				((void)0)
+#define diag_dump()				((void)0)
+#define diag_reset()			((void)0)
+
+#define DIAG_MARCA(marca)		((void)0)
+#define DIAG_RX(id)				((void)0)
+#define DIAG_TX(id)				((void)0)
+#define DIAG_LATENCIA(marca)	((void)0)
+
+#endif /* DIAG_ENABLE */
+
+#endif /* DIAG_H_ */
@@ -0,0 +1,34 @@
+/**
+ * @file dlog_formatos.h
+ * @brief Tabla de formatos del registro diferido.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ *
+ * @details Cada entrada tiene el nombre del formato y el texto, con la
+ * sintaxis de printf. El numero de formato es la posicion en la tabla
+ * (empezando en 1), por lo que las entradas nuevas se agregan al final.
+ * Herramientas/dlog_expand.py lee este mismo archivo para expandir los
+ * registros.
+ *
+ * @note Los argumentos viajan como enteros de 32 bits; solo se admiten
+ * %d, %i, %u, %x, %X, %c y sus variantes de ancho.
+ */
+
+#ifndef DLOG_FORMATOS_H_
+#define DLOG_FORMATOS_H_
+
+#define DLOG_FORMATOS(X)	\
+	X(DLOG_ERROR_SPI_LECTURA,	"Fallo al leer el spi.")	\
+	X(DLOG_ERROR_NO_MSG,		"Fallo no hubo mensajes.")	\
+	X(DLOG_ERROR_LECTURA,		"Fallo al leer el modulo can (error %d).")	\
+	X(DLOG_ERROR_TX_LLENOS,		"Error: buffers de transmision llenos (id %u).")	\
+	X(DLOG_ERROR_TX,			"Error: fallo al transmitir (id %u).")	\
+	X(DLOG_ERROR_SPI_ESCRITURA,	"Error: fallo en escritura de spi (id %u).")	\
+	X(DLOG_ERROR_ENVIO,			"Error al enviar (id %u, error %d).")	\
+	X(DLOG_TX_LATENCIA,			"TX id %u, latencia en cola %u ms")	\
+	X(DLOG_ERROR_POOL,			"Pool de recepcion lleno, mensaje descartado (id %u).")	\
+	X(DLOG_ERROR_RTR,			"Cola de transmision llena, pedido remoto sin respuesta (id %u).")	\
+	X(DLOG_SENAL_PERDIDA,		"Senal perdida (id %u, sin mensajes en %u ms).")	\
+	X(DLOG_SENAL_RECUPERADA,	"Senal recuperada (id %u).")
+
+#endif /* DLOG_FORMATOS_H_ */
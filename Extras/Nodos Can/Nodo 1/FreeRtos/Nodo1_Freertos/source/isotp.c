@@ -0,0 +1,361 @@
+/**
+ * @file isotp.c
+ * @brief Transporte segmentado ISO 15765-2 (ISO-TP) sobre CanApi.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ */
+
+#include "isotp.h"
+
+#include <string.h>
+
+#include "can_pool.h"
+
+/* Tipos de trama (nibble alto del PCI) */
+#define ISOTP_SIMPLE		0x0U
+#define ISOTP_PRIMERA		0x1U
+#define ISOTP_CONSECUTIVA	0x2U
+#define ISOTP_FLUJO			0x3U
+
+/* Estado del control de flujo */
+#define ISOTP_FC_SEGUIR		0x0U
+#define ISOTP_FC_ESPERAR	0x1U
+#define ISOTP_FC_DESBORDE	0x2U
+
+/* Datos por trama */
+#define ISOTP_DATOS_SIMPLE		7U
+#define ISOTP_DATOS_PRIMERA		6U
+#define ISOTP_DATOS_CONSECUTIVA	7U
+
+/**
+ * @brief Espera maxima para encolar cada trama (N_As).
+ */
+#define ISOTP_N_AS			pdMS_TO_TICKS(1000)
+
+/* Funciones privadas */
+/**
+ * @brief Encola una trama con el PCI indicado y el resto con relleno.
+ * @param[in] *canal Canal.
+ * @param[in] *pci Bytes de control.
+ * @param[in] largoPci Cantidad de bytes de control.
+ * @param[in] *datos Datos que siguen al PCI.
+ * @param[in] largo Cantidad de datos.
+ */
+static Error_Can_t isotp_enviar(ISOTP_Canal_t *canal, const uint8_t *pci,
+		uint32_t largoPci, const uint8_t *datos, uint32_t largo);
+/**
+ * @brief Envia un control de flujo.
+ */
+static Error_Can_t isotp_controlFlujo(ISOTP_Canal_t *canal, uint8_t estado);
+/**
+ * @brief Espera la proxima trama del canal.
+ * @param[in] *canal Canal.
+ * @param[out] *ref Trama leida, a liberar con CAN_releaseRef().
+ * @param[in] espera Espera maxima.
+ * @return ERROR_CAN_TIMEOUT si no llego.
+ */
+static Error_Can_t isotp_leer(ISOTP_Canal_t *canal, CAN_FrameRef_t *ref,
+		TickType_t espera);
+/**
+ * @brief Espera un control de flujo para seguir enviando.
+ * @param[in] *canal Canal.
+ * @param[out] *bloque Consecutivas hasta el proximo control (0 sin limite).
+ * @param[out] *separacion Espera entre consecutivas [ticks].
+ */
+static Error_Can_t isotp_esperarFlujo(ISOTP_Canal_t *canal, uint32_t *bloque,
+		TickType_t *separacion);
+/**
+ * @brief Pasa el STmin de la norma a ticks, redondeando hacia arriba.
+ */
+static TickType_t isotp_stminTicks(uint8_t stmin);
+
+/* Funciones */
+extern Error_Can_t isotp_open(ISOTP_Canal_t *canal, canid_t idTx,
+		canid_t idRx, uint8_t bloque, uint8_t stmin)
+{
+	// Las subscripciones son por id estandar
+	if ((idTx | idRx) & ~CAN_SFF_MASK)
+		return ERROR_CAN_NOT_FOUND;
+
+	if (bloque == 0 || bloque > ISOTP_BLOQUE_MAX)
+		bloque = ISOTP_BLOQUE_MAX;
+
+	canal->idTx = idTx;
+	canal->idRx = idRx;
+	canal->bloque = bloque;
+	canal->stmin = stmin;
+	canal->tarea = xTaskGetCurrentTaskHandle();
+
+	return CAN_SubscribePolicy((uint16_t) idRx, canal->tarea,
+			CAN_POLITICA_ESPERAR, CAN_PLAZO_DEFECTO);
+}
+
+extern Error_Can_t isotp_close(ISOTP_Canal_t *canal)
+{
+	return CAN_Unsubscribe((uint16_t) canal->idRx, canal->tarea);
+}
+
+extern Error_Can_t isotp_send(ISOTP_Canal_t *canal, const uint8_t *datos,
+		uint32_t largo)
+{
+	uint8_t pci[2];
+	uint32_t enviados, bloque, n;
+	TickType_t separacion;
+	uint8_t secuencia = 1;
+	Error_Can_t error;
+
+	// SF_DL = 0 no es valido, el receptor lo descartaria sin avisar
+	if (largo == 0)
+		return ERROR_CAN_FAILTX;
+
+	if (largo <= ISOTP_DATOS_SIMPLE)
+	{
+		pci[0] = (uint8_t) ((ISOTP_SIMPLE << 4) | largo);
+		return isotp_enviar(canal, pci, 1, datos, largo);
+	}
+
+	if (largo > ISOTP_LARGO_MAX)
+		return ERROR_CAN_MEMORY;
+
+	pci[0] = (uint8_t) ((ISOTP_PRIMERA << 4) | (largo >> 8));
+	pci[1] = (uint8_t) largo;
+	error = isotp_enviar(canal, pci, 2, datos, ISOTP_DATOS_PRIMERA);
+	enviados = ISOTP_DATOS_PRIMERA;
+
+	while (error == ERROR_CAN_OK && enviados < largo)
+	{
+		error = isotp_esperarFlujo(canal, &bloque, &separacion);
+
+		for (n = 0; error == ERROR_CAN_OK && enviados < largo
+				&& (bloque == 0 || n < bloque); n++)
+		{
+			uint32_t parte = largo - enviados;
+
+			if (parte > ISOTP_DATOS_CONSECUTIVA)
+				parte = ISOTP_DATOS_CONSECUTIVA;
+
+			// La primera del bloque ya esta separada por el control de flujo
+			if (n > 0 && separacion > 0)
+				vTaskDelay(separacion);
+
+			pci[0] = (uint8_t) ((ISOTP_CONSECUTIVA << 4) | secuencia);
+			error = isotp_enviar(canal, pci, 1, &datos[enviados], parte);
+
+			enviados += parte;
+			secuencia = (secuencia + 1) & 0x0F;
+		}
+	}
+
+	return error;
+}
+
+extern Error_Can_t isotp_receive(ISOTP_Canal_t *canal, uint8_t *buffer,
+		uint32_t tamano, uint32_t *largo, TickType_t timeout)
+{
+	CAN_FrameRef_t ref;
+	const struct can_frame *f;
+	uint32_t total = 0, recibidos, n;
+	uint8_t secuencia = 1;
+	Error_Can_t error;
+
+	/* Comienzo del mensaje: simple o primera */
+	for (;;)
+	{
+		error = isotp_leer(canal, &ref, timeout);
+		if (error != ERROR_CAN_OK)
+			return error;
+
+		f = can_pool_frame(ref);
+
+		if (f->can_dlc >= 2 && (f->data[0] >> 4) == ISOTP_SIMPLE)
+		{
+			total = f->data[0] & 0x0F;
+
+			if (total == 0 || total > f->can_dlc - 1U)
+			{
+				CAN_releaseRef(ref);
+				continue;
+			}
+			if (total > tamano)
+			{
+				CAN_releaseRef(ref);
+				return ERROR_CAN_MEMORY;
+			}
+
+			memcpy(buffer, &f->data[1], total);
+			CAN_releaseRef(ref);
+			*largo = total;
+
+			return ERROR_CAN_OK;
+		}
+
+		if (f->can_dlc == CAN_MAX_DLEN && (f->data[0] >> 4) == ISOTP_PRIMERA)
+		{
+			total = ((uint32_t) (f->data[0] & 0x0F) << 8) | f->data[1];
+
+			if (total > ISOTP_DATOS_SIMPLE)
+				break;
+		}
+
+		// Consecutivas o controles de una transferencia anterior
+		CAN_releaseRef(ref);
+	}
+
+	if (total > tamano)
+	{
+		CAN_releaseRef(ref);
+		isotp_controlFlujo(canal, ISOTP_FC_DESBORDE);
+		return ERROR_CAN_MEMORY;
+	}
+
+	/* Cada trama se copia una sola vez: del pool al buffer */
+	memcpy(buffer, &f->data[2], ISOTP_DATOS_PRIMERA);
+	CAN_releaseRef(ref);
+	recibidos = ISOTP_DATOS_PRIMERA;
+
+	while (recibidos < total)
+	{
+		error = isotp_controlFlujo(canal, ISOTP_FC_SEGUIR);
+		if (error != ERROR_CAN_OK)
+			return error;
+
+		for (n = 0; recibidos < total && n < canal->bloque; n++)
+		{
+			uint32_t parte = total - recibidos;
+
+			error = isotp_leer(canal, &ref, ISOTP_N_CR);
+			if (error != ERROR_CAN_OK)
+				return error;
+
+			f = can_pool_frame(ref);
+
+			if ((f->data[0] >> 4) != ISOTP_CONSECUTIVA
+					|| (f->data[0] & 0x0F) != secuencia)
+			{
+				CAN_releaseRef(ref);
+				return ERROR_CAN_FAILRX;
+			}
+
+			if (parte > ISOTP_DATOS_CONSECUTIVA)
+				parte = ISOTP_DATOS_CONSECUTIVA;
+			if (f->can_dlc < parte + 1U)
+			{
+				CAN_releaseRef(ref);
+				return ERROR_CAN_FAILRX;
+			}
+
+			memcpy(&buffer[recibidos], &f->data[1], parte);
+			CAN_releaseRef(ref);
+
+			recibidos += parte;
+			secuencia = (secuencia + 1) & 0x0F;
+		}
+	}
+
+	*largo = total;
+
+	return ERROR_CAN_OK;
+}
+
+static Error_Can_t isotp_enviar(ISOTP_Canal_t *canal, const uint8_t *pci,
+		uint32_t largoPci, const uint8_t *datos, uint32_t largo)
+{
+	struct can_frame frame;
+
+	frame.can_id = canal->idTx;
+	frame.can_dlc = CAN_MAX_DLEN;
+	memset(frame.data, ISOTP_RELLENO, sizeof(frame.data));
+	memcpy(frame.data, pci, largoPci);
+	if (largo > 0)
+		memcpy(&frame.data[largoPci], datos, largo);
+
+	return CAN_sendMsg(&frame, ISOTP_N_AS);
+}
+
+static Error_Can_t isotp_controlFlujo(ISOTP_Canal_t *canal, uint8_t estado)
+{
+	uint8_t pci[3];
+
+	pci[0] = (uint8_t) ((ISOTP_FLUJO << 4) | estado);
+	pci[1] = canal->bloque;
+	pci[2] = canal->stmin;
+
+	return isotp_enviar(canal, pci, sizeof(pci), NULL, 0);
+}
+
+static Error_Can_t isotp_leer(ISOTP_Canal_t *canal, CAN_FrameRef_t *ref,
+		TickType_t espera)
+{
+	TimeOut_t inicio;
+	Error_Can_t error;
+
+	vTaskSetTimeOutState(&inicio);
+
+	// Cada lectura espera como mucho 200 ms en la cola de la subscripcion
+	for (;;)
+	{
+		error = CAN_readRef(ref, (uint16_t) canal->idRx, canal->tarea);
+		if (error != ERROR_CAN_QUEUERX)
+			return error;
+		if (xTaskCheckForTimeOut(&inicio, &espera) != pdFALSE)
+			return ERROR_CAN_TIMEOUT;
+	}
+}
+
+static Error_Can_t isotp_esperarFlujo(ISOTP_Canal_t *canal, uint32_t *bloque,
+		TickType_t *separacion)
+{
+	CAN_FrameRef_t ref;
+	const struct can_frame *f;
+	uint32_t esperas = 0;
+	Error_Can_t error;
+
+	for (;;)
+	{
+		error = isotp_leer(canal, &ref, ISOTP_N_BS);
+		if (error != ERROR_CAN_OK)
+			return error;
+
+		f = can_pool_frame(ref);
+
+		if (f->can_dlc < 3 || (f->data[0] >> 4) != ISOTP_FLUJO)
+		{
+			CAN_releaseRef(ref);
+			continue;
+		}
+
+		switch (f->data[0] & 0x0F)
+		{
+		case ISOTP_FC_SEGUIR:
+			*bloque = f->data[1];
+			*separacion = isotp_stminTicks(f->data[2]);
+			CAN_releaseRef(ref);
+			return ERROR_CAN_OK;
+
+		case ISOTP_FC_ESPERAR:
+			CAN_releaseRef(ref);
+			if (++esperas > ISOTP_MAX_ESPERAS)
+				return ERROR_CAN_TIMEOUT;
+			break;
+
+		default:
+			// Desborde o estado reservado: el receptor no acepta el mensaje
+			CAN_releaseRef(ref);
+			return ERROR_CAN_MEMORY;
+		}
+	}
+}
+
+static TickType_t isotp_stminTicks(uint8_t stmin)
+{
+	uint32_t us;
+
+	if (stmin <= 0x7F)
+		us = stmin * 1000U;
+	else if (stmin >= 0xF1 && stmin <= 0xF9)
+		us = (stmin - 0xF0U) * 100U;
+	else
+		us = 0x7FU * 1000U;	// Reservado: la norma indica usar el maximo
+
+	return (TickType_t) ((us * configTICK_RATE_HZ + 999999U) / 1000000U);
+}
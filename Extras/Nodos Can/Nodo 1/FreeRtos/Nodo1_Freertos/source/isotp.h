@@ -0,0 +1,172 @@
+/**
+ * @file isotp.h
+ * @brief Transporte segmentado ISO 15765-2 (ISO-TP) sobre CanApi.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ *
+ * @details Permite enviar bloques de hasta ISOTP_LARGO_MAX bytes (tablas de
+ * calibracion, partes de firmware, volcados de diagnostico) partidos en
+ * tramas de 8 bytes, con direccionamiento normal: cada canal transmite con
+ * una id y recibe con otra, y el canal del otro nodo las usa al reves.
+ *
+ * Tramas (primer byte, PCI):
+ * - Simple (0x0L): hasta 7 bytes en una sola trama.
+ * - Primera (0x1L LL): largo de 12 bits y los primeros 6 bytes.
+ * - Consecutiva (0x2N): 7 bytes mas, con numero de secuencia N de 4 bits.
+ * - Control de flujo (0x3S BS STmin): la envia el receptor despues de la
+ *   primera trama y cada BS consecutivas; S es 0 seguir, 1 esperar o 2
+ *   desborde.
+ *
+ * El canal se suscribe a su id de recepcion con CAN_POLITICA_ESPERAR, y
+ * el mensaje se arma leyendo las referencias del pool (CAN_readRef()): los
+ * datos de cada trama se copian una vez, del pool al buffer de quien
+ * llama, sin un buffer intermedio.
+ * Como la cola de la subscripcion tiene 5 lugares, el bloque anunciado no
+ * pasa de ISOTP_BLOQUE_MAX: el emisor nunca adelanta mas tramas de las
+ * que entran.
+ *
+ * Un canal lo usa una sola tarea, la que llamo a isotp_open(), y es half
+ * duplex: no se envia y recibe a la vez por el mismo canal.
+ *
+ * @code
+ * static ISOTP_Canal_t canal;
+ * static uint8_t tabla[512];
+ * uint32_t largo;
+ *
+ * isotp_open(&canal, 0x708, 0x700, ISOTP_BLOQUE, ISOTP_STMIN);
+ * if (isotp_receive(&canal, tabla, sizeof(tabla), &largo, portMAX_DELAY)
+ *         == ERROR_CAN_OK)
+ *     ...
+ * @endcode
+ */
+
+#ifndef ISOTP_H_
+#define ISOTP_H_
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "CanApi.h"
+#include "can.h"
+
+/**
+ * @brief Largo maximo de un mensaje (12 bits de la primera trama).
+ */
+#define ISOTP_LARGO_MAX		4095U
+
+/**
+ * @brief Bloque maximo que se anuncia, la cola de una subscripcion.
+ */
+#define ISOTP_BLOQUE_MAX	5U
+
+/**
+ * @brief Tramas consecutivas por control de flujo que pide el receptor.
+ */
+#ifndef ISOTP_BLOQUE
+#define ISOTP_BLOQUE		4U
+#endif
+
+/**
+ * @brief Separacion minima entre consecutivas que pide el receptor.
+ *
+ * Codificada como en la norma: 0x00 a 0x7F en ms, 0xF1 a 0xF9 de 100 a
+ * 900 us.
+ */
+#ifndef ISOTP_STMIN
+#define ISOTP_STMIN			0U
+#endif
+
+/**
+ * @brief Espera maxima del control de flujo (N_Bs) y de cada consecutiva
+ * (N_Cr).
+ */
+#define ISOTP_N_BS			pdMS_TO_TICKS(1000)
+#define ISOTP_N_CR			pdMS_TO_TICKS(1000)
+
+/**
+ * @brief Controles de flujo de espera seguidos antes de abandonar.
+ */
+#define ISOTP_MAX_ESPERAS	10U
+
+/**
+ * @brief Relleno de los bytes sin usar de cada trama.
+ */
+#define ISOTP_RELLENO		0xCCU
+
+/**
+ * @brief Canal de transporte entre dos nodos.
+ */
+typedef struct
+{
+	/**
+	 * @brief Id con la que se transmite.
+	 */
+	canid_t idTx;
+	/**
+	 * @brief Id con la que se recibe.
+	 */
+	canid_t idRx;
+	/**
+	 * @brief Bloque que se anuncia al recibir (0 sin limite).
+	 */
+	uint8_t bloque;
+	/**
+	 * @brief Separacion que se anuncia al recibir.
+	 */
+	uint8_t stmin;
+	/**
+	 * @brief Tarea suscripta a idRx.
+	 */
+	TaskHandle_t tarea;
+} ISOTP_Canal_t;
+
+/**
+ * @brief Abre un canal y se suscribe a su id de recepcion.
+ *
+ * Debe llamarse desde la tarea que va a usar el canal.
+ * @param[out] *canal Canal a inicializar.
+ * @param[in] idTx Id estandar de transmision.
+ * @param[in] idRx Id estandar de recepcion.
+ * @param[in] bloque Bloque a anunciar, de 1 a ISOTP_BLOQUE_MAX.
+ * @param[in] stmin Separacion a anunciar.
+ * @return ERROR_CAN_MEMORY si no se pudo crear la subscripcion.
+ */
+extern Error_Can_t isotp_open(ISOTP_Canal_t *canal, canid_t idTx,
+		canid_t idRx, uint8_t bloque, uint8_t stmin);
+/**
+ * @brief Cierra el canal y borra la subscripcion.
+ * @param[in] *canal Canal abierto con isotp_open().
+ */
+extern Error_Can_t isotp_close(ISOTP_Canal_t *canal);
+/**
+ * @brief Envia un mensaje y espera a que el receptor lo acepte entero.
+ * @param[in] *canal Canal abierto.
+ * @param[in] *datos Mensaje.
+ * @param[in] largo Bytes del mensaje, de 1 a ISOTP_LARGO_MAX.
+ * @return ERROR_CAN_FAILTX si largo es 0,
+ * ERROR_CAN_TIMEOUT si falto un control de flujo,
+ * ERROR_CAN_MEMORY si el receptor no tiene lugar, ERROR_CAN_QUEUETX si no
+ * se pudo encolar una trama.
+ */
+extern Error_Can_t isotp_send(ISOTP_Canal_t *canal, const uint8_t *datos,
+		uint32_t largo);
+/**
+ * @brief Recibe un mensaje en el buffer indicado.
+ *
+ * Las tramas sueltas de una transferencia anterior se descartan hasta una
+ * simple o una primera.
+ * @param[in] *canal Canal abierto.
+ * @param[out] *buffer Donde se arma el mensaje.
+ * @param[in] tamano Tamaño del buffer; si el mensaje no entra se le
+ * contesta desborde al emisor.
+ * @param[out] *largo Bytes recibidos.
+ * @param[in] timeout Espera maxima del comienzo del mensaje.
+ * @return ERROR_CAN_TIMEOUT si no llego o se corto, ERROR_CAN_FAILRX si
+ * se perdio una consecutiva, ERROR_CAN_MEMORY si no entraba.
+ */
+extern Error_Can_t isotp_receive(ISOTP_Canal_t *canal, uint8_t *buffer,
+		uint32_t tamano, uint32_t *largo, TickType_t timeout);
+
+#endif /* ISOTP_H_ */
@@ -46,6 +46,10 @@
 
 #include "CanApi.h"
 #include "can.h"
+#include "prof.h"
+#include "dlog.h"
+#include "diag.h"
+#include "tickless.h"
 
 #include "Nodo1.h"
 #include "Nodo2.h"
@@ -68,6 +72,13 @@ extern BaseType_t receiveFromQueue(struct can_frame *dato);
  */
 extern BaseType_t receiveFromQueue_Peek(struct can_frame *dato);
 
+#if CAN_BENCH_FANOUT
+/**
+ * @brief Corre una vez la medicion del fan-out al terminar la inicializacion.
+ */
+static void taskRtos_BenchFanout(void *pvParameters);
+#endif
+
 /*
  * @brief   Application entry point.
  */
@@ -82,10 +93,19 @@ int main(void)
 	BOARD_InitDebugConsole();
 #endif
 
+	prof_init();
+
 	CAN_init();
 	Nodo1_init();
 	Nodo2_init();
 	Nodo3_init();
+	diag_init();
+	tickless_init();
+
+#if CAN_BENCH_FANOUT
+	xTaskCreate(taskRtos_BenchFanout, "Bench", configMINIMAL_STACK_SIZE + 100,
+			NULL, tskIDLE_PRIORITY + 1, NULL);
+#endif
 
 	vTaskStartScheduler();
 
@@ -119,6 +139,65 @@ extern void interrupt_init(void)
 	return;
 }
 
+#if CAN_BENCH_FANOUT
+static void taskRtos_BenchFanout(void *pvParameters)
+{
+	CAN_getEvent();
+	CAN_benchFanout();
+
+	vTaskDelete(NULL);
+
+	return;
+}
+#endif
+
+#if PROF_ENABLE
+void vApplicationTickHook(void)
+{
+	PROF_TICK();
+
+	return;
+}
+#endif
+
+#if DLOG_ENABLE
+void vApplicationIdleHook(void)
+{
+	/* No bloquea: solo escribe si la uart esta libre */
+	dlog_drain();
+
+	return;
+}
+#endif
+
+#if configSUPPORT_STATIC_ALLOCATION
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+		StackType_t **ppxIdleTaskStackBuffer, uint32_t *pulIdleTaskStackSize)
+{
+	static StaticTask_t idleTcb;
+	static StackType_t idlePila[configMINIMAL_STACK_SIZE];
+
+	*ppxIdleTaskTCBBuffer = &idleTcb;
+	*ppxIdleTaskStackBuffer = idlePila;
+	*pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+
+	return;
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer,
+		StackType_t **ppxTimerTaskStackBuffer, uint32_t *pulTimerTaskStackSize)
+{
+	static StaticTask_t timerTcb;
+	static StackType_t timerPila[configTIMER_TASK_STACK_DEPTH];
+
+	*ppxTimerTaskTCBBuffer = &timerTcb;
+	*ppxTimerTaskStackBuffer = timerPila;
+	*pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+
+	return;
+}
+#endif
+
 void vApplicationMallocFailedHook(void)
 {
 	PRINTF("\n\rError: Fallo de memoria dinamica.\n\r");
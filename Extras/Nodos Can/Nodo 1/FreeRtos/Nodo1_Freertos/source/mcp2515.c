@@ -13,6 +13,8 @@
 
 #include "mcp2515.h"
 #include "spi.h"
+#include "can_stats.h"
+#include "prof.h"
 #include "fsl_gpio.h"
 #include "pin_mux.h"
 #include "fsl_port.h"
@@ -584,10 +586,12 @@ typedef struct
 #include "FreeRTOS.h"
 #include "task.h"
 #include "semphr.h"
+#include "rtos_estatico.h"
 
 #define __delay_ms(ms) vTaskDelay(pdMS_TO_TICKS(ms))
 
 SemaphoreHandle_t xMutex;
+RTOS_OBJETO_MEMORIA(StaticSemaphore_t, xMutex);
 
 #elif (!USE_FREERTOS)
 #define __delay_ms(x) delay_ms(x)
@@ -782,7 +786,7 @@ extern void mcp2515_init(void)
 	spi_init();
 
 #if USE_FREERTOS
-	xMutex = xSemaphoreCreateMutex();
+	xMutex = RTOS_MUTEX_CREAR(xMutex);
 	if (xMutex == NULL)
 		PRINTF("\n\rFallo al crear el mutex.\n\r");
 #endif
@@ -800,6 +804,8 @@ static void startSPI(void)
 	 * */
 	CS_LOW;
 
+	CAN_STATS_CS_BEGIN();
+
 	return;
 }
 
@@ -812,6 +818,8 @@ static void endSPI(void)
 	 * */
 	CS_HIGH;
 
+	CAN_STATS_CS_END();
+
 	return;
 }
 
@@ -865,10 +873,10 @@ extern ERROR_t mcp2515_reset(void)
 	setReg.reg = MCP_RXB1CTRL, setReg.value = 0;
 	error = mcp2515_setRegister(setReg);
 
-	/* Habilitamos interrupciones */
+	/* Habilitamos interrupciones (TXnIF avisa a la tarea de transmision) */
 	setReg.reg = MCP_CANINTE;
-	setReg.value = CANINTF_RX0IF | CANINTF_RX1IF | CANINTF_ERRIF
-			| CANINTF_MERRF;
+	setReg.value = CANINTF_RX0IF | CANINTF_RX1IF | CANINTF_TX0IF
+			| CANINTF_TX1IF | CANINTF_TX2IF | CANINTF_ERRIF | CANINTF_MERRF;
 	error = mcp2515_setRegister(setReg);
 	if (error != ERROR_OK)
 		return error;
@@ -1826,6 +1834,8 @@ extern ERROR_t mcp2515_sendMessage(const struct can_frame *frame)
 {
     ERROR_t error = ERROR_OK;  // Inicializamos la variable error
 
+    PROF_BEGIN(PROF_MCP2515_SEND);
+
 #if	USE_FREERTOS
     if (xSemaphoreTake(xMutex, portMAX_DELAY) != pdTRUE) {
         return ERROR_FAILTX; // Retorna un error si no se pudo tomar el mutex
@@ -1869,6 +1879,8 @@ cleanup:
     xSemaphoreGive(xMutex);
 #endif
 
+    PROF_END(PROF_MCP2515_SEND);
+
     return error;
 }
 
@@ -1956,6 +1968,9 @@ extern ERROR_t mcp2515_readMessageWithBufferId(const RXBn rxbn,
 extern ERROR_t mcp2515_readMessage(struct can_frame *frame)
 {
 	ERROR_t error;
+
+	PROF_BEGIN(PROF_MCP2515_READ);
+
 	uint8_t stat = mcp2515_getStatus();
 
 	if (stat & STAT_RX0IF)
@@ -1971,6 +1986,8 @@ extern ERROR_t mcp2515_readMessage(struct can_frame *frame)
 		error = ERROR_NOMSG;
 	}
 
+	PROF_END(PROF_MCP2515_READ);
+
 	return error;
 }
 
@@ -2049,6 +2066,11 @@ extern ERROR_t mcp2515_getInterrupts(void)
 	return error;
 }
 
+extern uint8_t mcp2515_getIntFlags(void)
+{
+	return IntMCP2515.data;
+}
+
 extern void mcp2515_clearInterrupts(void)
 {
 	setRegister_t setReg;
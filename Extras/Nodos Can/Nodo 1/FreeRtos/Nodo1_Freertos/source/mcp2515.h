@@ -681,6 +681,12 @@ extern void mcp2515_clearRXnOVRFlags(void);
  * @return Devuelve el estado de la lectura.
  */
 extern ERROR_t mcp2515_getInterrupts(void);
+/**
+ * @brief Banderas leidas en la ultima llamada a mcp2515_getInterrupts().
+ *
+ * @return Valor del registro CANINTF.
+ */
+extern uint8_t mcp2515_getIntFlags(void);
 /**
  * @brief Obtiene las interrupciones habilitadas desde el modulo can.
  *
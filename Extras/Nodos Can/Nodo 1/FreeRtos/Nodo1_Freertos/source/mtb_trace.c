@@ -0,0 +1,135 @@
+/**
+ * @file mtb_trace.c
+ * @brief Captura de trazas con el Micro Trace Buffer (MTB) del Cortex-M0+.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ */
+
+#include "mtb_trace.h"
+
+#if MTB_TRACE_ENABLE
+
+#include "MKL46Z4.h"
+#include "fsl_debug_console.h"
+
+/*
+ * Debe coincidir con el tamaño reservado en mtb.c.
+ * */
+#if !defined (__MTB_BUFFER_SIZE)
+#define __MTB_BUFFER_SIZE 128
+#endif
+
+#if (__MTB_BUFFER_SIZE < 16) || (__MTB_BUFFER_SIZE & (__MTB_BUFFER_SIZE - 1))
+#error __MTB_BUFFER_SIZE debe ser una potencia de 2 mayor o igual a 16
+#endif
+
+#define MTB_PAQUETE_BYTES	8
+#define MTB_CANT_PAQUETES	(__MTB_BUFFER_SIZE / MTB_PAQUETE_BYTES)
+
+/* Variables */
+static volatile bool capturaArmada = true;
+static volatile bool capturaLista = false;
+
+/* Funciones privadas */
+/**
+ * @brief Calcula el campo MASK del registro MASTER.
+ *
+ * El MTB usa 2^(MASK+4) bytes del buffer.
+ * @return Valor del campo.
+ */
+static uint32_t mtb_trace_mask(void);
+
+/* Funciones */
+extern void mtb_trace_arm(void)
+{
+	capturaLista = false;
+	capturaArmada = true;
+
+	return;
+}
+
+extern void mtb_trace_start(void)
+{
+	if (!capturaArmada)
+		return;
+
+	capturaArmada = false;
+
+	/* Arranca desde el inicio del buffer, sin detencion automatica */
+	MTB->POSITION = 0;
+	MTB->FLOW = 0;
+	MTB->MASTER = MTB_MASTER_EN_MASK | MTB_MASTER_MASK(mtb_trace_mask());
+
+	return;
+}
+
+extern void mtb_trace_stop(void)
+{
+	if (!(MTB->MASTER & MTB_MASTER_EN_MASK))
+		return;
+
+	MTB->MASTER &= ~MTB_MASTER_EN_MASK;
+	capturaLista = true;
+
+	return;
+}
+
+extern bool mtb_trace_ready(void)
+{
+	return capturaLista;
+}
+
+extern void mtb_trace_dump(void)
+{
+	const uint32_t *buffer = (const uint32_t*) MTB->BASE;
+	uint32_t position = MTB->POSITION;
+	uint32_t puntero = (position & MTB_POSITION_POINTER_MASK)
+			/ MTB_PAQUETE_BYTES;
+	uint32_t inicio, cantidad;
+
+	/*
+	 * Si el buffer dio la vuelta el paquete mas viejo esta en el puntero,
+	 * si no los validos van desde el inicio hasta el puntero.
+	 * */
+	if (position & MTB_POSITION_WRAP_MASK)
+	{
+		inicio = puntero;
+		cantidad = MTB_CANT_PAQUETES;
+	}
+	else
+	{
+		inicio = 0;
+		cantidad = puntero;
+	}
+
+	PRINTF("\r\nMTB INICIO %u\r\n", (unsigned) cantidad);
+
+	for (uint32_t i = 0; i < cantidad; i++)
+	{
+		uint32_t n = (inicio + i) % MTB_CANT_PAQUETES;
+
+		PRINTF("%08x %08x\r\n", (unsigned) buffer[2 * n],
+				(unsigned) buffer[2 * n + 1]);
+	}
+
+	PRINTF("MTB FIN\r\n");
+
+	capturaLista = false;
+#if MTB_TRACE_REARMAR
+	capturaArmada = true;
+#endif
+
+	return;
+}
+
+static uint32_t mtb_trace_mask(void)
+{
+	uint32_t mask = 0;
+
+	while ((16U << mask) < __MTB_BUFFER_SIZE)
+		mask++;
+
+	return mask;
+}
+
+#endif /* MTB_TRACE_ENABLE */
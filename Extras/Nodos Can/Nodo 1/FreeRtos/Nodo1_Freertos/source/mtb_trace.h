@@ -0,0 +1,97 @@
+/**
+ * @file mtb_trace.h
+ * @brief Captura de trazas con el Micro Trace Buffer (MTB) del Cortex-M0+.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ *
+ * @details El MTB guarda en ram un paquete de 8 bytes por cada salto no
+ * secuencial del procesador (direccion de origen y de destino), sin
+ * agregar ciclos al codigo medido. mtb.c reserva el buffer al inicio de
+ * la ram; este modulo enciende la captura al entrar a una region, la
+ * detiene al salir y luego vuelca los paquetes crudos por la consola.
+ *
+ * El volcado tiene el formato:
+ * @code
+ * MTB INICIO <cantidad>
+ * <origen> <destino>
+ * ...
+ * MTB FIN
+ * @endcode
+ * y se decodifica en la pc con Herramientas/mtb_decode.py junto con el
+ * elf del proyecto.
+ *
+ * @note El tamaño del buffer se define con __MTB_BUFFER_SIZE (potencia de
+ * 2, 128 bytes por defecto = 16 saltos). Para capturas utiles conviene
+ * definirlo en 1024 o 2048 desde las opciones del proyecto.
+ */
+
+#ifndef MTB_TRACE_H_
+#define MTB_TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Habilitacion de la captura.
+ *
+ * Con '0' los macros de captura no generan codigo.
+ */
+#ifndef MTB_TRACE_ENABLE
+#define MTB_TRACE_ENABLE 0
+#endif
+
+/**
+ * @brief Rearma la captura despues de cada volcado.
+ *
+ * Con '0' se traza solo la primera region y las siguientes se piden con
+ * mtb_trace_arm() (tecla 't' en la consola del diagnostico).
+ */
+#ifndef MTB_TRACE_REARMAR
+#define MTB_TRACE_REARMAR 1
+#endif
+
+#if MTB_TRACE_ENABLE
+
+/**
+ * @brief Prepara la proxima captura.
+ *
+ * Cada captura es de un solo disparo: la region se traza solo si la
+ * captura esta armada, para no pisar el buffer antes de volcarlo.
+ */
+extern void mtb_trace_arm(void);
+/**
+ * @brief Comienza a trazar si la captura esta armada.
+ */
+extern void mtb_trace_start(void);
+/**
+ * @brief Detiene la traza y deja los paquetes listos para volcar.
+ */
+extern void mtb_trace_stop(void);
+/**
+ * @brief Indica si hay una captura lista para volcar.
+ * @return true si hay paquetes sin volcar.
+ */
+extern bool mtb_trace_ready(void);
+/**
+ * @brief Vuelca los paquetes por consola.
+ *
+ * Debe llamarse desde una tarea, fuera de la region trazada. Con
+ * MTB_TRACE_REARMAR deja armada la proxima captura.
+ */
+extern void mtb_trace_dump(void);
+
+#define MTB_TRACE_BEGIN()	mtb_trace_start()
+#define MTB_TRACE_END()		mtb_trace_stop()
+#define MTB_TRACE_DUMP()	do { if (mtb_trace_ready()) mtb_trace_dump(); } while (0)
+
+#else
+
+#define mtb_trace_arm()		((void)0)
+
+#define MTB_TRACE_BEGIN()	((void)0)
+#define MTB_TRACE_END()		((void)0)
+#define MTB_TRACE_DUMP()	((void)0)
+
+#endif /* MTB_TRACE_ENABLE */
+
+#endif /* MTB_TRACE_H_ */
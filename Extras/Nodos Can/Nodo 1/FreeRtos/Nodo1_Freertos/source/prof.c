@@ -0,0 +1,153 @@
+/**
+ * @file prof.c
+ * @brief Medicion de tiempos de ejecucion con el systick.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ */
+
+#include "prof.h"
+
+#if PROF_ENABLE
+
+#include "MKL46Z4.h"
+#include "fsl_debug_console.h"
+#include <string.h>
+
+/* Variables */
+/**
+ * @brief Ticks del systick contados desde el arranque.
+ */
+static volatile uint32_t profTicks = 0;
+/**
+ * @brief Ciclos que consume un PROF_BEGIN/PROF_END vacio.
+ */
+static uint32_t profOverhead = 0;
+/**
+ * @brief Tabla de resultados.
+ */
+static PROF_Region_t tabla[PROF_CANT_REGIONES];
+
+static const char *const nombres[PROF_CANT_REGIONES] =
+{ "mcp2515_sendMessage", "mcp2515_readMessage", "canmsg_interrupt",
+		"NotifySubscribed", "INT a suscriptor", };
+
+/* Funciones */
+extern void prof_init(void)
+{
+	uint32_t inicio;
+
+	prof_reset();
+
+	/* Mide el costo de tomar dos marcas de tiempo seguidas */
+	inicio = prof_now();
+	profOverhead = prof_now() - inicio;
+
+	return;
+}
+
+extern void prof_tick(void)
+{
+	profTicks++;
+
+	return;
+}
+
+extern uint32_t prof_now(void)
+{
+	uint32_t ticks, val, pendiente;
+	uint32_t reload = SysTick->LOAD + 1U;
+
+	/* Repite si el tick se incremento en medio de la lectura */
+	do
+	{
+		ticks = profTicks;
+		val = SysTick->VAL;
+		pendiente = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+	} while (ticks != profTicks);
+
+	/*
+	 * Si el systick ya se recargo pero su interrupcion todavia no se
+	 * atendio (interrupciones deshabilitadas o de mayor prioridad) se
+	 * suma el tick que falta.
+	 * */
+	if (pendiente && val > (reload >> 1))
+		ticks++;
+
+	return ticks * reload + (reload - 1U - val);
+}
+
+extern void prof_record(PROF_REGION_t region, uint32_t inicio)
+{
+	uint32_t ciclos = prof_now() - inicio;
+	uint32_t primask;
+	PROF_Region_t *r;
+
+	if (region >= PROF_CANT_REGIONES)
+		return;
+
+	ciclos = (ciclos > profOverhead) ? (ciclos - profOverhead) : 0;
+
+	/* La region puede medirse tanto desde tareas como desde interrupciones */
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	r = &tabla[region];
+	if (r->cuenta == 0 || ciclos < r->min)
+		r->min = ciclos;
+	if (ciclos > r->max)
+		r->max = ciclos;
+	r->total += ciclos;
+	r->cuenta++;
+
+	__set_PRIMASK(primask);
+
+	return;
+}
+
+extern void prof_get(PROF_REGION_t region, PROF_Region_t *resultado)
+{
+	uint32_t primask;
+
+	if (region >= PROF_CANT_REGIONES)
+		return;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	memcpy(resultado, &tabla[region], sizeof(PROF_Region_t));
+	__set_PRIMASK(primask);
+
+	return;
+}
+
+extern void prof_reset(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	memset(tabla, 0, sizeof(tabla));
+	__set_PRIMASK(primask);
+
+	return;
+}
+
+extern void prof_dump(void)
+{
+	PROF_Region_t r;
+
+	PRINTF("\r\n--- Perfilado (ciclos, overhead %u) ---\r\n",
+			(unsigned) profOverhead);
+	PRINTF("Region                 Cuenta       Min       Max     Media\r\n");
+
+	for (int i = 0; i < PROF_CANT_REGIONES; i++)
+	{
+		prof_get((PROF_REGION_t) i, &r);
+
+		PRINTF("%-20s  %7u  %8u  %8u  %8u\r\n", nombres[i],
+				(unsigned) r.cuenta, (unsigned) r.min, (unsigned) r.max,
+				(unsigned) (r.cuenta ? (r.total / r.cuenta) : 0));
+	}
+
+	return;
+}
+
+#endif /* PROF_ENABLE */
@@ -0,0 +1,109 @@
+/**
+ * @file rtos_estatico.h
+ * @brief Creacion de objetos de FreeRTOS con memoria estatica o dinamica.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ *
+ * @details Con RTOS_ESTATICO en 1 (FreeRTOSConfig.h) cada tarea, semaforo,
+ * timer y grupo de eventos usa memoria reservada en tiempo de compilacion:
+ * el arranque no depende del heap y el consumo de ram de cada modulo queda
+ * en el .map del proyecto (ver Herramientas/ram_reporte.py). Con 0 los
+ * mismos macros crean los objetos en el heap.
+ *
+ * La memoria de cada objeto se declara una sola vez, a nivel de archivo:
+ * @code
+ * RTOS_TAREA_MEMORIA(taskRtos_Nodo2, configMINIMAL_STACK_SIZE);
+ * RTOS_OBJETO_MEMORIA(StaticTimer_t, Timer1);
+ *
+ * status = RTOS_TAREA_CREAR(taskRtos_Nodo2, "Task Nodo 2", NULL, 2, &handle);
+ * Timer1 = RTOS_TIMER_CREAR(Timer1, "Timer", periodo, pdTRUE, NULL, cb);
+ * @endcode
+ */
+
+#ifndef RTOS_ESTATICO_H_
+#define RTOS_ESTATICO_H_
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "timers.h"
+#include "event_groups.h"
+
+#if RTOS_ESTATICO
+
+/**
+ * @brief Pila y tcb de la tarea que ejecuta la funcion indicada.
+ * @param[in] funcion Funcion de la tarea.
+ * @param[in] pila Tamaño de la pila [palabras].
+ */
+#define RTOS_TAREA_MEMORIA(funcion, pila)							\
+	enum { funcion##_pilaLargo = (pila) };							\
+	static StackType_t funcion##_pila[funcion##_pilaLargo];			\
+	static StaticTask_t funcion##_tcb
+
+/**
+ * @brief Memoria del objeto cuyo handle se llama nombre.
+ * @param[in] tipo StaticSemaphore_t, StaticTimer_t o StaticEventGroup_t.
+ */
+#define RTOS_OBJETO_MEMORIA(tipo, nombre)							\
+	static tipo nombre##_mem
+
+#define RTOS_TAREA_CREAR(funcion, texto, param, prioridad, handle)	\
+	rtos_tareaCrear(funcion, texto, funcion##_pilaLargo, param,		\
+			prioridad, funcion##_pila, &funcion##_tcb, handle)
+
+#define RTOS_MUTEX_CREAR(nombre)									\
+	xSemaphoreCreateMutexStatic(&nombre##_mem)
+
+#define RTOS_SEMAFORO_CONTADOR_CREAR(nombre, maximo, inicial)		\
+	xSemaphoreCreateCountingStatic(maximo, inicial, &nombre##_mem)
+
+#define RTOS_TIMER_CREAR(nombre, texto, periodo, recarga, id, callback)	\
+	xTimerCreateStatic(texto, periodo, recarga, id, callback, &nombre##_mem)
+
+#define RTOS_EVENTOS_CREAR(nombre)									\
+	xEventGroupCreateStatic(&nombre##_mem)
+
+/**
+ * @brief Crea una tarea estatica con la misma respuesta que xTaskCreate().
+ */
+static inline BaseType_t rtos_tareaCrear(TaskFunction_t funcion,
+		const char *texto, uint32_t pila, void *param, UBaseType_t prioridad,
+		StackType_t *memPila, StaticTask_t *tcb, TaskHandle_t *handle)
+{
+	TaskHandle_t creada = xTaskCreateStatic(funcion, texto, pila, param,
+			prioridad, memPila, tcb);
+
+	if (handle != NULL)
+		*handle = creada;
+
+	return (creada != NULL) ? pdPASS : pdFAIL;
+}
+
+#else
+
+#define RTOS_TAREA_MEMORIA(funcion, pila)							\
+	enum { funcion##_pilaLargo = (pila) }
+
+/* Sin memoria propia: solo se declara para que el uso sea el mismo */
+#define RTOS_OBJETO_MEMORIA(tipo, nombre)							\
+	extern tipo nombre##_mem
+
+#define RTOS_TAREA_CREAR(funcion, texto, param, prioridad, handle)	\
+	xTaskCreate(funcion, texto, funcion##_pilaLargo, param, prioridad, handle)
+
+#define RTOS_MUTEX_CREAR(nombre)									\
+	xSemaphoreCreateMutex()
+
+#define RTOS_SEMAFORO_CONTADOR_CREAR(nombre, maximo, inicial)		\
+	xSemaphoreCreateCounting(maximo, inicial)
+
+#define RTOS_TIMER_CREAR(nombre, texto, periodo, recarga, id, callback)	\
+	xTimerCreate(texto, periodo, recarga, id, callback)
+
+#define RTOS_EVENTOS_CREAR(nombre)									\
+	xEventGroupCreate()
+
+#endif /* RTOS_ESTATICO */
+
+#endif /* RTOS_ESTATICO_H_ */
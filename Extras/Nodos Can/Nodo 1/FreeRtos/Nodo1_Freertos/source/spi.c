@@ -16,6 +16,7 @@
 #include "fsl_debug_console.h"
 #include "clock_config.h"
 #include "mcp2515.h"
+#include "can_stats.h"
 #include <string.h>
 
 // #define USE_FREERTOS 0
@@ -106,6 +107,8 @@ extern status_t spi_write(uint8_t *tx_buffer, uint16_t n)
 	status = SPI_MasterTransferBlocking(SPI_MASTER_BASE, &masterXfer);
 #endif
 
+	CAN_STATS_SPI(tx_buffer, n, status == kStatus_Success);
+
 	return status;
 }
 
@@ -124,6 +127,8 @@ extern status_t spi_receive(uint8_t *rx_buffer, uint8_t n)
 	status = SPI_MasterTransferBlocking(SPI_MASTER_BASE, &masterXfer);
 #endif
 
+	CAN_STATS_SPI(NULL, n, status == kStatus_Success);
+
 	if (status == kStatus_Success)
 	{
 //		PRINTF("SPI transfer completed successfully. \r\n");
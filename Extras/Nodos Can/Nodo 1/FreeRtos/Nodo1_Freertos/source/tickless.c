@@ -0,0 +1,270 @@
+/**
+ * @file tickless.c
+ * @brief Modo tickless de FreeRTOS con el LPTMR y despertar por CAN.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ */
+
+#include "tickless.h"
+
+#if RTOS_TICKLESS
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "MKL46Z4.h"
+#include "fsl_clock.h"
+#include "fsl_smc.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/**
+ * @brief Interrupcion del mcp2515 (PTA17).
+ */
+#define TICKLESS_CAN_IRQ	PORTA_IRQn
+
+/**
+ * @brief Ticks que entran en el comparador de 16 bits del LPTMR.
+ */
+#define TICKLESS_MAX_TICKS	((TickType_t) ((0xFFFFUL * configTICK_RATE_HZ) / TICKLESS_LPTMR_HZ))
+
+/* Variables */
+static TICKLESS_Stats_t stats;
+
+#if DIAG_ENABLE
+/**
+ * @brief Marca del ultimo despertar por CAN, pendiente de atender.
+ */
+static volatile uint32_t marcaCan;
+static volatile bool pendienteCan = false;
+#endif
+
+/* Funciones privadas */
+/**
+ * @brief Cuentas del LPTMR que dura una cantidad de ticks.
+ */
+static uint32_t tickless_ticksACuentas(TickType_t ticks);
+/**
+ * @brief Ciclos del systick que duran una cantidad de cuentas del LPTMR.
+ * @param[in] cuentas Cuentas del LPTMR.
+ * @param[in] cargaTick Ciclos del systick por tick.
+ */
+static uint32_t tickless_cuentasACiclos(uint32_t cuentas, uint32_t cargaTick);
+/**
+ * @brief Lee el contador del LPTMR.
+ *
+ * En la KL46Z hay que escribir el CNR para que se registre su valor.
+ */
+static uint32_t tickless_leerCuenta(void);
+
+/* Funciones */
+extern void tickless_init(void)
+{
+	/* MCGIRCLK: IRC lento, habilitado tambien en los modos stop */
+	MCG->C2 &= ~MCG_C2_IRCS_MASK;
+	MCG->C1 |= MCG_C1_IRCLKEN_MASK | MCG_C1_IREFSTEN_MASK;
+
+	CLOCK_EnableClock(kCLOCK_Lptmr0);
+	LPTMR0->CSR = 0;
+	LPTMR0->PSR = LPTMR_PSR_PCS(0) | LPTMR_PSR_PBYP_MASK;
+
+	/* Solo despierta a la cpu: no llama a la api de FreeRTOS */
+	EnableIRQ(LPTMR0_IRQn);
+
+	SMC_SetPowerModeProtection(SMC, kSMC_AllowPowerModeVlp);
+
+	return;
+}
+
+extern void tickless_atendido(void)
+{
+#if DIAG_ENABLE
+	uint32_t latencia;
+
+	if (!pendienteCan)
+		return;
+
+	latencia = diag_contador() - marcaCan;
+	pendienteCan = false;
+
+	taskENTER_CRITICAL();
+	if (stats.latencias == 0 || latencia < stats.latenciaMin)
+		stats.latenciaMin = latencia;
+	if (latencia > stats.latenciaMax)
+		stats.latenciaMax = latencia;
+	stats.latenciaTotal += latencia;
+	stats.latencias++;
+	taskEXIT_CRITICAL();
+#endif
+
+	return;
+}
+
+extern void tickless_getStats(TICKLESS_Stats_t *destino)
+{
+	taskENTER_CRITICAL();
+	*destino = stats;
+	taskEXIT_CRITICAL();
+
+	return;
+}
+
+extern void tickless_reset(void)
+{
+	taskENTER_CRITICAL();
+	memset(&stats, 0, sizeof(stats));
+	taskEXIT_CRITICAL();
+
+	return;
+}
+
+/*
+ * Reemplaza a la version de freertos/portable (configUSE_TICKLESS_IDLE en 2).
+ * Se ejecuta en la tarea ociosa con el planificador suspendido.
+ */
+void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime)
+{
+	TickType_t ticks;
+	uint32_t cuentas, cargaTick, ciclos, resto;
+
+	/* La consola necesita a la cpu para cada byte */
+	if ((UART0->S1 & UART0_S1_TC_MASK) == 0)
+	{
+		stats.abortadas++;
+		return;
+	}
+
+	if (xExpectedIdleTime > TICKLESS_MAX_TICKS)
+		xExpectedIdleTime = TICKLESS_MAX_TICKS;
+
+	/* Se detiene el systick: la fraccion del tick en curso queda en VAL */
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	cargaTick = SysTick->LOAD + 1U;
+
+	/* Sin taskENTER_CRITICAL(): la interrupcion pendiente debe despertar */
+	__disable_irq();
+
+	/* Con un tick pendiente la fraccion de VAL ya no es la del tick en curso */
+	if (eTaskConfirmSleepModeStatus() == eAbortSleep
+			|| (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk))
+	{
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+		stats.abortadas++;
+		__enable_irq();
+
+		return;
+	}
+
+	/* El ultimo tick lo completa el systick al reanudarse */
+	ticks = xExpectedIdleTime - 1;
+	cuentas = tickless_ticksACuentas(ticks);
+	LPTMR0->CMR = cuentas - 1U;
+	LPTMR0->CSR = LPTMR_CSR_TIE_MASK | LPTMR_CSR_TEN_MASK;
+
+	/* En VLPS se detiene el reloj de bus y se perderia la conversion */
+	if (ADC0->SC2 & ADC_SC2_ADACT_MASK)
+	{
+		SMC_PreEnterWaitModes();
+		SMC_SetPowerModeWait(SMC);
+		SMC_PostExitWaitModes();
+		stats.enEspera++;
+	}
+	else
+	{
+		SMC_PreEnterStopModes();
+		SMC_SetPowerModeVlps(SMC);
+		SMC_PostExitStopModes();
+		SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+	}
+
+	if (NVIC_GetPendingIRQ(TICKLESS_CAN_IRQ))
+	{
+#if DIAG_ENABLE
+		marcaCan = diag_contador();
+		pendienteCan = true;
+#endif
+		stats.porCan++;
+	}
+	else if (LPTMR0->CSR & LPTMR_CSR_TCF_MASK)
+		stats.porTimer++;
+	else
+		stats.porOtras++;
+
+	/*
+	 * Tiempo desde el inicio del tick en curso: lo que ya habia corrido el
+	 * systick mas lo dormido, sea hasta el vencimiento o hasta el despertar.
+	 */
+	if (LPTMR0->CSR & LPTMR_CSR_TCF_MASK)
+		ciclos = tickless_cuentasACiclos(cuentas, cargaTick);
+	else
+		ciclos = tickless_cuentasACiclos(tickless_leerCuenta(), cargaTick);
+	ciclos += cargaTick - SysTick->VAL;
+
+	/* Detiene el LPTMR (borra CNR y TCF) */
+	LPTMR0->CSR = 0;
+	NVIC_ClearPendingIRQ(LPTMR0_IRQn);
+
+	/*
+	 * Se adelantan los ticks completos y la fraccion se arrastra: el
+	 * systick arranca con lo que falta para el proximo tick y despues
+	 * vuelve a su carga normal, como el port original de FreeRTOS.
+	 */
+	ticks = ciclos / cargaTick;
+	resto = cargaTick - (ciclos % cargaTick);
+	if (ticks > xExpectedIdleTime - 1)
+	{
+		// El ultimo tick ya vencio, lo cuenta el systick en seguida
+		ticks = xExpectedIdleTime - 1;
+		resto = 0;
+	}
+
+	/* Con LOAD en 0 el systick no cuenta: la fraccion minima es de 2 ciclos */
+	if (resto < 2U)
+		resto = 2U;
+
+	SysTick->LOAD = resto - 1U;
+	SysTick->VAL = 0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+	vTaskStepTick(ticks);
+	SysTick->LOAD = cargaTick - 1U;
+
+	stats.dormidas++;
+	stats.ticksDormidos += ticks;
+
+	__enable_irq();
+
+	return;
+}
+
+void LPTMR0_IRQHandler(void)
+{
+	/*
+	 * No deberia llegar: al despertar se detiene el LPTMR con las
+	 * interrupciones deshabilitadas.
+	 * */
+	LPTMR0->CSR = 0;
+
+	return;
+}
+
+static uint32_t tickless_ticksACuentas(TickType_t ticks)
+{
+	return ((uint32_t) ticks * TICKLESS_LPTMR_HZ) / configTICK_RATE_HZ;
+}
+
+static uint32_t tickless_cuentasACiclos(uint32_t cuentas, uint32_t cargaTick)
+{
+	/* Hasta 0xFFFF cuentas por la frecuencia del systick no entra en 32 bits */
+	return (uint32_t) (((uint64_t) cuentas * cargaTick * configTICK_RATE_HZ)
+			/ TICKLESS_LPTMR_HZ);
+}
+
+static uint32_t tickless_leerCuenta(void)
+{
+	LPTMR0->CNR = 0;
+
+	return LPTMR0->CNR & LPTMR_CNR_COUNTER_MASK;
+}
+
+#endif /* RTOS_TICKLESS */
@@ -0,0 +1,112 @@
+/**
+ * @file tickless.h
+ * @brief Modo tickless de FreeRTOS con el LPTMR y despertar por CAN.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ *
+ * @details Con RTOS_TICKLESS en 1 (FreeRTOSConfig.h) la tarea ociosa detiene
+ * el systick y duerme en VLPS hasta el proximo vencimiento de FreeRTOS o
+ * hasta la interrupcion del mcp2515 (PTA17). El tiempo dormido lo mide el
+ * LPTMR con el MCGIRCLK (IRC lento de 32768 Hz, el mismo que usa de
+ * referencia el FLL en modo FEI) y al despertar se adelanta la cuenta de
+ * ticks completos con vTaskStepTick(). La fraccion que sobra, tambien al
+ * despertar antes por CAN, se carga en el systick para el primer tick, por
+ * lo que el reloj del kernel no se atrasa con cada despertar.
+ *
+ * No se duerme mientras la uart de la consola este transmitiendo (el
+ * registro binario y PRINTF necesitan a la cpu para cada byte), y si hay
+ * una conversion del ADC en curso se duerme en WAIT, porque en VLPS el
+ * reloj de bus se detiene y la conversion se pierde.
+ *
+ * Con el diagnostico habilitado se mide la latencia desde que la cpu
+ * despierta por la interrupcion del mcp2515 hasta que el mensaje se
+ * entrego a los suscriptores, con el contador de diag_contador().
+ *
+ * @note En VLPS el TPM2 se detiene, por lo que la carga de cpu del
+ * diagnostico queda calculada sobre el tiempo despierto. Las mediciones
+ * de prof.h no deben abarcar un periodo dormido.
+ */
+
+#ifndef TICKLESS_H_
+#define TICKLESS_H_
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "diag.h"
+
+/**
+ * @brief Frecuencia del LPTMR [Hz] (MCGIRCLK con el IRC lento).
+ */
+#define TICKLESS_LPTMR_HZ	32768U
+
+/**
+ * @brief Estadisticas del modo tickless.
+ */
+typedef struct
+{
+	/** @brief Veces que se durmio (VLPS o WAIT). */
+	uint32_t dormidas;
+	/** @brief Veces que se durmio en WAIT por una conversion del ADC. */
+	uint32_t enEspera;
+	/** @brief Veces que no se durmio (uart ocupada o tarea lista). */
+	uint32_t abortadas;
+	/** @brief Despertares por el vencimiento del LPTMR. */
+	uint32_t porTimer;
+	/** @brief Despertares por la interrupcion del mcp2515. */
+	uint32_t porCan;
+	/** @brief Despertares por cualquier otra interrupcion. */
+	uint32_t porOtras;
+	/** @brief Ticks compensados con vTaskStepTick(). */
+	uint32_t ticksDormidos;
+	/** @brief Mensajes atendidos despues de despertar por CAN. */
+	uint32_t latencias;
+	/** @brief Latencia minima [cuentas de diag_contador()]. */
+	uint32_t latenciaMin;
+	/** @brief Latencia maxima [cuentas de diag_contador()]. */
+	uint32_t latenciaMax;
+	/** @brief Suma de las latencias, para calcular la media. */
+	uint32_t latenciaTotal;
+} TICKLESS_Stats_t;
+
+#if RTOS_TICKLESS
+
+/**
+ * @brief Configura el LPTMR y habilita el modo VLPS.
+ *
+ * Debe llamarse antes de arrancar el planificador.
+ */
+extern void tickless_init(void);
+/**
+ * @brief Registra la latencia desde el despertar por CAN.
+ *
+ * La llama la tarea de recepcion despues de entregar un mensaje; solo
+ * mide el primer mensaje despues de cada despertar por el mcp2515.
+ */
+extern void tickless_atendido(void);
+/**
+ * @brief Copia las estadisticas.
+ * @param[out] destino lugar donde se cargan los datos
+ */
+extern void tickless_getStats(TICKLESS_Stats_t *destino);
+/**
+ * @brief Pone a cero las estadisticas.
+ */
+extern void tickless_reset(void);
+
+#if DIAG_ENABLE
+#define TICKLESS_ATENDIDO()		tickless_atendido()
+#else
+#define TICKLESS_ATENDIDO()		((void)0)
+#endif
+
+#else
+
+#define tickless_init()			((void)0)
+#define tickless_reset()		((void)0)
+
+#define TICKLESS_ATENDIDO()		((void)0)
+
+#endif /* RTOS_TICKLESS */
+
+#endif /* TICKLESS_H_ */
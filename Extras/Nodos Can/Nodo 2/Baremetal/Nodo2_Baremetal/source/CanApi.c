@@ -13,6 +13,9 @@
  * los nodos interactuan directamente con esta capa y no con el mcp2515. Esto permite que se haga
  * mejor uso del recuros y evite colisiones en los mensajes de los nodos.
  * Para esto cada nodo debe generar una subcripcion a una ide determinada y enviar su task handle.
+ * @note Este archivo esta excluido de la compilacion del proyecto (ver .cproject,
+ * excluding="CanApi.c"): solo se mantiene sincronizado con la copia de Quantum Leaps
+ * del mismo nodo, y sus cambios no afectan al binario.
  */
 
 #include "CanApi.h"
@@ -23,12 +26,12 @@
 #include "fsl_debug_console.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #include "can.h"
 #include "mcp2515.h"
 
-#define MAX_RETRY_COUNT 3  // Número máximo de reintentos
-#define INTERRUPT_RETRY_DELAY_MS 1  // Tiempo de espera entre reintentos en ms
+#define SERVICE_MAX_COUNT 4  // Lecturas de banderas por llamado a CAN_service
 
 /* Symbols to be used with GPIO driver */
 #define BOARD_INT_CAN_FGPIO FGPIOA              /*!<@brief FGPIO peripheral base pointer */
@@ -45,7 +48,14 @@
 #define CAN_PERIFERICOS_INIT	perifericos_init
 #define CAN_INTERRUPT_INIT		interrupt_init
 
+#if DEFERRED_INT_ENABLE
+#define CAN_INTERRUPT			CAN_callbackINT
+#define CAN_callbackINT			callbackInterrupt
+
+extern void callbackInterrupt(void);
+#else
 #define CAN_INTERRUPT			canmsg_interrupt
+#endif
 #define CAN_PROCESS_RECEIVE 	canmsg_receive
 
 #if	TIMEOUT_ENABLE
@@ -54,13 +64,71 @@
 extern void callbackTimeout(void);
 #endif
 
-// Recepcion
-#define QUEUE_RECEIVE_LENGTH	5
+// Recepcion (potencia de 2)
+#define QUEUE_RECEIVE_LENGTH	8
 #define QUEUE_RECEIVE_SIZE		sizeof(canMsg_Receive)
-// Transmision
-#define QUEUE_TRANSMISION_LENGTH	10
+// Transmision (potencia de 2)
+#define QUEUE_TRANSMISION_LENGTH	16
 #define QUEUE_TRANSMISION_SIZE		sizeof(canMsg_Transmision)
 
+#if (QUEUE_RECEIVE_LENGTH & (QUEUE_RECEIVE_LENGTH - 1)) \
+		|| (QUEUE_TRANSMISION_LENGTH & (QUEUE_TRANSMISION_LENGTH - 1)) \
+		|| QUEUE_RECEIVE_LENGTH > 128 || QUEUE_TRANSMISION_LENGTH > 128
+#error Los largos de las colas deben ser potencias de 2 hasta 128
+#endif
+
+/**
+ * @brief Cantidad maxima de subscripciones.
+ */
+#ifndef CAN_MAX_SUBS
+#define CAN_MAX_SUBS		8
+#endif
+
+/**
+ * @brief Posiciones del indice por id (potencia de 2).
+ */
+#ifndef CAN_INDICE_SLOTS
+#define CAN_INDICE_SLOTS	16
+#endif
+
+#if (CAN_INDICE_SLOTS & (CAN_INDICE_SLOTS - 1))
+#error CAN_INDICE_SLOTS debe ser una potencia de 2
+#endif
+
+/**
+ * @brief Posicion de una id en el indice.
+ */
+#define CAN_INDICE(id)		(((id) ^ ((id) >> 4)) & (CAN_INDICE_SLOTS - 1))
+
+/**
+ * @brief Cola circular de un productor y un consumidor, sin bloqueo.
+ *
+ * Los indices avanzan libremente y se enmascaran al acceder, por lo que
+ * la cantidad es siempre escritura - lectura (con indices de 8 bits el
+ * largo puede ser hasta 128). Solo el productor modifica escritura y solo
+ * el consumidor lectura, por lo que uno puede estar en una interrupcion
+ * y el otro en el programa principal sin deshabilitar interrupciones.
+ */
+typedef struct
+{
+	/**
+	 * @brief Lugar de los mensajes.
+	 */
+	struct can_frame *datos;
+	/**
+	 * @brief Largo - 1.
+	 */
+	uint8_t mascara;
+	/**
+	 * @brief Mensajes cargados, solo la modifica el productor.
+	 */
+	volatile uint8_t escritura;
+	/**
+	 * @brief Mensajes sacados, solo la modifica el consumidor.
+	 */
+	volatile uint8_t lectura;
+} CAN_Anillo_t;
+
 /**
  * @brief Tipo de subcripcion a los nodos.
  */
@@ -75,13 +143,14 @@ typedef struct CANSubscription
 	 */
 	canid_t subscriberId;
 	/**
-	 * @brief Cola de datos de recepcion.
+	 * @brief Lugar de la cola de recepcion.
 	 */
 	struct can_frame bufferRx[QUEUE_RECEIVE_LENGTH];
 	/**
-	 * @brief Indice de lectura del buffer.
+	 * @brief Cola de recepcion: la carga la interrupcion y la vacia
+	 * CAN_readMsg().
 	 */
-	uint8_t readIndex;
+	CAN_Anillo_t colaRx;
 	/**
 	 * @brief Funcion de callback.
 	 */
@@ -90,6 +159,11 @@ typedef struct CANSubscription
 	 * @brief Puntero al siguiente nodo de la lista.
 	 */
 	struct CANSubscription *next;
+	/**
+	 * @brief Siguiente de la misma posicion del indice, o de la lista de
+	 * libres.
+	 */
+	struct CANSubscription *nextId;
 } CANSubscription_t;
 
 /**
@@ -98,13 +172,37 @@ typedef struct CANSubscription
 static CANSubscription_t *subscriptionList = NULL; // Inicio de la lista de suscripciones
 
 /**
- * @brief Buffer de transmision.
+ * @brief Lugar de las subscripciones.
+ */
+static CANSubscription_t subsPool[CAN_MAX_SUBS];
+/**
+ * @brief Subscripciones del pool que nunca se usaron.
+ */
+static uint8_t subsUsadas = 0;
+/**
+ * @brief Subscripciones borradas, enlazadas por nextId.
+ */
+static CANSubscription_t *subsLibres = NULL;
+/**
+ * @brief Subscripciones por id, enlazadas por nextId.
+ */
+static CANSubscription_t *indiceId[CAN_INDICE_SLOTS];
+
+/**
+ * @brief Lugar de la cola de transmision.
+ */
+static struct can_frame bufferTx[QUEUE_TRANSMISION_LENGTH];
+/**
+ * @brief Cola de transmision: la carga CAN_sendMsg() y la vacia
+ * CAN_eventTx().
  */
-struct can_frame bufferTx[QUEUE_TRANSMISION_LENGTH];
+static CAN_Anillo_t colaTx =
+{ .datos = bufferTx, .mascara = QUEUE_TRANSMISION_LENGTH - 1, };
 /**
- * @brief Indice del buffer de escritura.
+ * @brief Mensajes descartados por cola llena.
  */
-static uint8_t writeIndex = 0;
+static volatile uint32_t descartadosTx = 0;
+static volatile uint32_t descartadosRx = 0;
 
 /**
  * @brief Mensaje de recepcion de tipo can.
@@ -114,11 +212,11 @@ static struct can_frame canMsg_Receive;
 /**
  * @brief Contador de eventos de recepcion.
  */
-static uint8_t EventRx = 0;
+static volatile uint8_t EventRx = 0;
 /**
- * @brief Contador de eventos de transmision.
+ * @brief Se recibio un mensaje desde el ultimo tick (para el timeout).
  */
-static uint8_t EventTx = 0;
+static volatile bool recepcion = false;
 
 /**
  * @brief Tiempo de transmision de mensajes can.
@@ -132,13 +230,19 @@ static uint16_t timerTimeout = TIMER_TIMEOUT;
 /**
  * @brief Funcion de procesamiento de interrupcion.
  */
-static void canmsg_interrupt(void);
+static Error_Can_t canmsg_interrupt(void);
 static Error_Can_t canmsg_receive(void);
 /**
  * @brief Notificación de tareas.
  * @param[in] nodeId Id del mensaje recivido.
  */
 static void NotifySubscribedNodes(void);
+/**
+ * @brief Ciclos del nucleo desde un valor leido del systick.
+ *
+ * Vale mientras no pase mas de un periodo del systick.
+ */
+static uint32_t transfer_ciclos(uint32_t inicio);
 /**
  * @brief Inicializacion de perifericos.
  */
@@ -151,6 +255,38 @@ static void interrupt_init(void);
  * @brief Tiempo de bloqueo.
  */
 static void delay_ms(uint16_t ms);
+/**
+ * @brief Inicializa una cola vacia.
+ * @param[out] *anillo Cola.
+ * @param[in] *datos Lugar de los mensajes.
+ * @param[in] largo Potencia de 2.
+ */
+static void anillo_init(CAN_Anillo_t *anillo, struct can_frame *datos,
+		uint8_t largo);
+/**
+ * @brief Carga un mensaje al final (productor).
+ * @return false si la cola esta llena.
+ */
+static bool anillo_cargar(CAN_Anillo_t *anillo, const struct can_frame *frame);
+/**
+ * @brief Mensaje mas viejo sin sacarlo (consumidor).
+ * @return NULL si la cola esta vacia.
+ */
+static const struct can_frame* anillo_frente(const CAN_Anillo_t *anillo);
+/**
+ * @brief Saca el mensaje mas viejo, ya leido con anillo_frente() (consumidor).
+ */
+static void anillo_sacar(CAN_Anillo_t *anillo);
+/**
+ * @brief Toma una subscripcion del pool en O(1).
+ * @return NULL si no quedan.
+ */
+static CANSubscription_t* subs_alocar(void);
+/**
+ * @brief Busca una subscripcion por el indice.
+ * @return NULL si no existe.
+ */
+static CANSubscription_t* subs_buscar(canid_t nodeId, canid_t subscriberId);
 
 /*
  * ===========================================
@@ -172,9 +308,9 @@ extern void CAN_init(void)
 
 extern Error_Can_t CAN_Subscribe(canid_t nodeId, canid_t subscriberId, can_callback_t callback)
 {
-	CANSubscription_t *current = subscriptionList;
+	CANSubscription_t *current = indiceId[CAN_INDICE(nodeId)];
 
-	// Verificar si ya existe una suscripción para este nodeId y callback
+	// Verificar si ya existe, solo entre las de la misma posicion del indice
 	while (current != NULL)
 	{
 		if (current->nodeId == nodeId && current->callback == callback
@@ -183,103 +319,107 @@ extern Error_Can_t CAN_Subscribe(canid_t nodeId, canid_t subscriberId, can_callb
 			// Si ya existe una suscripción con el mismo nodeId y callback, retornamos un error
 			return ERROR_CAN_ALREADY_SUBSCRIBED;
 		}
-		current = current->next;
+		current = current->nextId;
 	}
 
 	// Crear una nueva suscripción si no existe
-	CANSubscription_t *newSubscription = (CANSubscription_t*) malloc(sizeof(CANSubscription_t));
+	CANSubscription_t *newSubscription = subs_alocar();
 	if (newSubscription == NULL)
 	{
 		return ERROR_CAN_MEMORY;
 	}
 
 	// Carga la informacion en la nueva lista
-	newSubscription->readIndex = 0;
+	anillo_init(&newSubscription->colaRx, newSubscription->bufferRx,
+			QUEUE_RECEIVE_LENGTH);
 	newSubscription->nodeId = nodeId;
 	newSubscription->callback = callback;
 	newSubscription->subscriberId = subscriberId;
 
-	// Insertar al inicio de la lista enlazada
+	// Insertar al inicio de la lista y de su posicion del indice
 	newSubscription->next = subscriptionList;
+	newSubscription->nextId = indiceId[CAN_INDICE(nodeId)];
+
+	// La interrupcion recorre el indice: se publica completa
+	__disable_irq();
 	subscriptionList = newSubscription;
+	indiceId[CAN_INDICE(nodeId)] = newSubscription;
+	__enable_irq();
 
 	return ERROR_CAN_OK;
 }
 
 extern Error_Can_t CAN_Unsubscribe(canid_t nodeId, canid_t subscriberId)
 {
-	CANSubscription_t **current = &subscriptionList;
-
-	while (*current != NULL)
-	{
-		if ((*current)->nodeId == nodeId && (*current)->subscriberId == subscriberId)
-		{
-			CANSubscription_t *toDelete = *current;
-			*current = (*current)->next;
-
-			// Liberar la memoria de la suscripción
-			free(toDelete);
-
-			return ERROR_CAN_OK;
-		}
-
-		current = &(*current)->next;
-	}
+	CANSubscription_t **enIndice = &indiceId[CAN_INDICE(nodeId)];
+	CANSubscription_t **enLista = &subscriptionList;
+	CANSubscription_t *toDelete;
+
+	while (*enIndice != NULL && ((*enIndice)->nodeId != nodeId
+			|| (*enIndice)->subscriberId != subscriberId))
+		enIndice = &(*enIndice)->nextId;
+
+	toDelete = *enIndice;
+	if (toDelete == NULL)
+		return ERROR_CAN_NOT_FOUND;
+
+	while (*enLista != toDelete)
+		enLista = &(*enLista)->next;
+
+	// Se quita de las dos listas sin que la interrupcion las recorra
+	__disable_irq();
+	*enIndice = toDelete->nextId;
+	*enLista = toDelete->next;
+	__enable_irq();
+
+	/*
+	 * Vuelve al pool por nextId: next queda igual, por lo que si se borra
+	 * desde un callback la notificacion sigue por la lista.
+	 */
+	toDelete->nextId = subsLibres;
+	subsLibres = toDelete;
 
-	return ERROR_CAN_NOT_FOUND;
+	return ERROR_CAN_OK;
 }
 
 extern Error_Can_t CAN_sendMsg(struct can_frame *dato)
 {
-	// Verificar si el buffer de transmisión está lleno
-	if (writeIndex >= QUEUE_TRANSMISION_LENGTH)
+	// Los mensajes salen en el mismo orden en que se cargan
+	if (!anillo_cargar(&colaTx, dato))
 	{
+		descartadosTx++;
 		return ERROR_CAN_QUEUETX_FULL; // Error si está lleno
 	}
 
-	// Copiar el mensaje al buffer de transmisión
-	memcpy(&bufferTx[writeIndex], dato, sizeof(struct can_frame));
-	writeIndex++; // Avanzar el índice de escritura
-	EventTx++;		// Genera un evento de transmision
-
 	return ERROR_CAN_OK;
 }
 
 extern Error_Can_t CAN_readMsg(struct can_frame *dato, canid_t nodeId, canid_t subscriberId)
 {
-	CANSubscription_t *current = subscriptionList;
-
-	// Buscar la suscripción correspondiente al nodo y suscriptor
-	while (current != NULL)
-	{
-		if (current->nodeId == nodeId && current->subscriberId == subscriberId)
-		{
-			// Verificar si hay mensajes en el buffer de recepción
-			if (current->readIndex == 0) return ERROR_CAN_QUEUERX_EMPTY;
+	CANSubscription_t *current = subs_buscar(nodeId, subscriberId);
 
-			// Leer el mensaje desde el buffer de recepción
-			memcpy(dato, &current->bufferRx[current->readIndex - 1], sizeof(struct can_frame));
+	if (current == NULL) return ERROR_CAN_NOT_FOUND;
 
-			// Actualizar el índice de lectura
-			current->readIndex--;
+	// El mas viejo de la cola de recepción
+	const struct can_frame *frame = anillo_frente(&current->colaRx);
+	if (frame == NULL) return ERROR_CAN_QUEUERX_EMPTY;
 
-			return ERROR_CAN_OK;
-		}
-		current = current->next;
-	}
+	memcpy(dato, frame, sizeof(struct can_frame));
+	anillo_sacar(&current->colaRx);
 
-	return ERROR_CAN_NOT_FOUND;
+	return ERROR_CAN_OK;
 }
 
 extern Error_Can_t CAN_eventTx(void)
 {
-	if (EventTx == 0) return ERROR_CAN_NO_EVENT_TX;
+	const struct can_frame *frame = anillo_frente(&colaTx);
+	if (frame == NULL) return ERROR_CAN_NO_EVENT_TX;
 
-	ERROR_t status = mcp2515_sendMessage(&bufferTx[writeIndex - 1]);
+	// Si falla queda al frente para el proximo intento
+	ERROR_t status = mcp2515_sendMessage(frame);
 	if (status != ERROR_OK) return ERROR_CAN_FAILTX;	// Fallo al transmitir
 
-	writeIndex--;
-	EventTx--;
+	anillo_sacar(&colaTx);
 
 	return ERROR_CAN_OK;
 }
@@ -296,6 +436,76 @@ extern Error_Can_t CAN_eventRx(void)
 	return ERROR_CAN_OK;
 }
 
+extern bool CAN_transfer(uint32_t presupuesto)
+{
+	const uint32_t inicio = SysTick->VAL;
+	uint32_t ciclos = presupuesto * (CLOCK_GetCoreSysClkFreq() / 1000000U);
+	const struct can_frame *frame;
+	bool completo = true;
+
+	// El tiempo se mide con el systick, no puede pasar de un periodo
+	if (ciclos > SysTick->LOAD)
+		ciclos = SysTick->LOAD;
+
+	/* Transmision: hasta ocupar los 3 buffers del modulo o vaciar la cola */
+	while ((frame = anillo_frente(&colaTx)) != NULL)
+	{
+		if (transfer_ciclos(inicio) >= ciclos)
+			return false;
+
+		// Buffers ocupados o error: queda al frente para el proximo tick
+		if (mcp2515_sendMessage(frame) != ERROR_OK)
+		{
+			completo = false;
+			break;
+		}
+
+		anillo_sacar(&colaTx);
+	}
+
+	/* Recepcion: todos los eventos pendientes */
+	while (EventRx != 0)
+	{
+		if (transfer_ciclos(inicio) >= ciclos)
+			return false;
+
+		NotifySubscribedNodes();
+
+		// La interrupcion del modulo tambien lo modifica
+		__disable_irq();
+		EventRx--;
+		__enable_irq();
+	}
+
+	return completo;
+}
+
+extern Error_Can_t CAN_service(void)
+{
+	// Se atiende al menos una vez: el flanco ya ocurrio
+	for (uint8_t i = 0; i < SERVICE_MAX_COUNT; i++)
+	{
+		// Si el spi falla, volver a leer en seguida no lo resuelve
+		Error_Can_t estado = canmsg_interrupt();
+		if (estado != ERROR_CAN_OK)
+			return estado;
+
+		// Con todas las banderas limpias el modulo libera la linea
+		if (GPIO_PinRead(BOARD_INT_CAN_GPIO, BOARD_INT_CAN_PIN))
+			return ERROR_CAN_OK;
+	}
+
+	return ERROR_CAN_PENDING;
+}
+
+extern void CAN_getDropped(uint32_t *tx, uint32_t *rx)
+{
+	*tx = descartadosTx;
+	*rx = descartadosRx;
+
+	return;
+}
+
 extern bool CAN_getTimer(void)
 {
 	if (timerXtransfer != 0) timerXtransfer--;
@@ -306,8 +516,9 @@ extern bool CAN_getTimer(void)
 	}
 
 #if TIMEOUT_ENABLE
-	if (EventRx)
+	if (recepcion)
 	{
+		recepcion = false;
 		timerTimeout = TIMER_TIMEOUT;
 	}
 	else
@@ -334,7 +545,7 @@ extern bool CAN_getTimer(void)
 
 static Error_Can_t canmsg_receive(void)
 {
-	CANSubscription_t *current = subscriptionList;
+	CANSubscription_t *current;
 
 	ERROR_t estado = mcp2515_readMessage(&canMsg_Receive);
 	if (estado != ERROR_OK)
@@ -346,34 +557,29 @@ static Error_Can_t canmsg_receive(void)
 		else
 		PRINTF("\n\rFallo al leer el modulo can.\n\r");
 
-		return ERROR_CAN_OK;
+		return ERROR_CAN_FAILRX;
 	}
 
-	// Buscar la suscripción correspondiente al nodo y suscriptor
+	// Solo las suscripciones de la posicion del indice de esta id
+	current = indiceId[CAN_INDICE(canMsg_Receive.can_id)];
 	while (current != NULL)
 	{
 		if (current->nodeId == canMsg_Receive.can_id)
 		{
-			// Verifica si hay espacio
-			if (current->readIndex < QUEUE_RECEIVE_LENGTH)
-			{
-				// Leer el mensaje desde el buffer de recepción
-				memcpy(&current->bufferRx[current->readIndex], &canMsg_Receive,
-							sizeof(struct can_frame));
-
-				// Actualizar el índice de lectura
-				current->readIndex++;
-			}
+			// Sin lugar se descarta el que llega, los anteriores no cambian
+			if (!anillo_cargar(&current->colaRx, &canMsg_Receive))
+				descartadosRx++;
 		}
-		current = current->next;
+		current = current->nextId;
 	}
 
 	EventRx++;
+	recepcion = true;
 
 	return ERROR_CAN_OK;
 }
 
-static void canmsg_interrupt(void)
+static Error_Can_t canmsg_interrupt(void)
 {
 	// Leemos las interrupciones generadas
 	ERROR_t error = mcp2515_getInterrupts();
@@ -381,7 +587,7 @@ static void canmsg_interrupt(void)
 	if (error != ERROR_OK)
 	{
 		PRINTF("Fallo al leer la interrupcion\n\r");
-		return;
+		return ERROR_CAN_FAILRX;
 	}
 
 	// Detectamos las interrupciones relevantes
@@ -389,51 +595,30 @@ static void canmsg_interrupt(void)
 	{
 		PRINTF("Error interrupt flag\n\r");
 		mcp2515_clearERRIF();
-		return;
+		return ERROR_CAN_OK;
 	}
 	else if (mcp2515_getIntMERRF())
 	{
 		PRINTF("Message error interrupt flag\n\r");
 		mcp2515_clearMERR();
-		return;
+		return ERROR_CAN_OK;
 	}
 
-	// Interrupciones por recepción de datos (RX0 y RX1)
-	int retryCount = 0;
+	// Recepcion (RX0 y RX1) con la misma lectura de las banderas; lo que
+	// llegue despues deja la linea en bajo y se atiende en otra pasada
+	Error_Can_t estado = ERROR_CAN_OK;
 
-	while (retryCount < MAX_RETRY_COUNT)
-	{
-		if (mcp2515_getIntRX0IF() || mcp2515_getIntRX1IF())
-		{
-			Error_Can_t error = CAN_PROCESS_RECEIVE();
-			if (error != ERROR_CAN_OK)
-			{
-				if (error == ERROR_CAN_NOT_FOUND)
-				PRINTF("\n\rError: no se encontro el id"
-							"con los existentes.\n\r");
-			}
-
-			return;
-		}
+	if (mcp2515_getIntRX0IF())
+		estado = CAN_PROCESS_RECEIVE();
 
-		retryCount++;
-		delay_ms(INTERRUPT_RETRY_DELAY_MS);
+	if (mcp2515_getIntRX1IF() && estado == ERROR_CAN_OK)
+		estado = CAN_PROCESS_RECEIVE();
 
-		// Volvemos a leer las interrupciones para intentar nuevamente
-		error = mcp2515_getInterrupts();
-		if (error != ERROR_OK)
-		{
-			PRINTF("Fallo al leer la interrupcion en el intento %d\n\r", retryCount);
-		}
-	}
+	if (estado == ERROR_CAN_NOT_FOUND)
+		PRINTF("\n\rError: no se encontro el id"
+					"con los existentes.\n\r");
 
-	if (retryCount == MAX_RETRY_COUNT)
-	{
-		// Si alcanzamos el límite de reintentos, reportamos el fallo
-		PRINTF("Error: RX0 y RX1 no procesadas después de %d intentos\n\r", MAX_RETRY_COUNT);
-	}
-
-	return;
+	return estado;
 }
 
 static void NotifySubscribedNodes(void)
@@ -442,7 +627,7 @@ static void NotifySubscribedNodes(void)
 
 	while (current != NULL)
 	{
-		if (current->readIndex > 0)
+		if (anillo_frente(&current->colaRx) != NULL)
 		{
 			// Ejecutar el callback para el nodo suscrito
 			current->callback(current->subscriberId, current->nodeId);
@@ -453,6 +638,17 @@ static void NotifySubscribedNodes(void)
 	return;
 }
 
+static uint32_t transfer_ciclos(uint32_t inicio)
+{
+	uint32_t ahora = SysTick->VAL;
+
+	// Cuenta hacia abajo y se recarga con LOAD al llegar a 0
+	if (ahora <= inicio)
+		return inicio - ahora;
+
+	return inicio + (SysTick->LOAD + 1U) - ahora;
+}
+
 static void perifericos_init(void)
 {
 	ERROR_t error;
@@ -537,6 +733,88 @@ void PORTA_IRQHandler(void)
 	return;
 }
 
+static void anillo_init(CAN_Anillo_t *anillo, struct can_frame *datos,
+		uint8_t largo)
+{
+	anillo->datos = datos;
+	anillo->mascara = largo - 1;
+	anillo->escritura = 0;
+	anillo->lectura = 0;
+
+	return;
+}
+
+static bool anillo_cargar(CAN_Anillo_t *anillo, const struct can_frame *frame)
+{
+	uint8_t escritura = anillo->escritura;
+
+	if ((uint8_t) (escritura - anillo->lectura) > anillo->mascara)
+		return false;
+
+	memcpy(&anillo->datos[escritura & anillo->mascara], frame,
+			sizeof(struct can_frame));
+
+	// El mensaje queda escrito antes de que el consumidor lo vea
+	__DMB();
+	anillo->escritura = escritura + 1;
+
+	return true;
+}
+
+static const struct can_frame* anillo_frente(const CAN_Anillo_t *anillo)
+{
+	uint8_t lectura = anillo->lectura;
+
+	if (anillo->escritura == lectura)
+		return NULL;
+
+	__DMB();
+
+	return &anillo->datos[lectura & anillo->mascara];
+}
+
+static void anillo_sacar(CAN_Anillo_t *anillo)
+{
+	// Termina de leer el mensaje antes de liberar el lugar
+	__DMB();
+	anillo->lectura = anillo->lectura + 1;
+
+	return;
+}
+
+static CANSubscription_t* subs_alocar(void)
+{
+	CANSubscription_t *subs;
+
+	// Primero las borradas, despues las que nunca se usaron
+	if (subsLibres != NULL)
+	{
+		subs = subsLibres;
+		subsLibres = subs->nextId;
+	}
+	else if (subsUsadas < CAN_MAX_SUBS)
+	{
+		subs = &subsPool[subsUsadas++];
+	}
+	else
+	{
+		subs = NULL;
+	}
+
+	return subs;
+}
+
+static CANSubscription_t* subs_buscar(canid_t nodeId, canid_t subscriberId)
+{
+	CANSubscription_t *current = indiceId[CAN_INDICE(nodeId)];
+
+	while (current != NULL && (current->nodeId != nodeId
+			|| current->subscriberId != subscriberId))
+		current = current->nextId;
+
+	return current;
+}
+
 static void delay_ms(uint16_t ms)
 {
 	// Calcula el número de ciclos necesarios
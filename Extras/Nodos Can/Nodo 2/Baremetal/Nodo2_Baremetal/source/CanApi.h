@@ -14,6 +14,21 @@
 
 #define TIMEOUT_ENABLE	1
 
+/**
+ * @brief Interrupcion del modulo diferida.
+ *
+ * En 1 la interrupcion del puerto A solo llama a callbackInterrupt(), que
+ * define la aplicacion, y el spi se atiende despues con CAN_service().
+ */
+#define DEFERRED_INT_ENABLE	0
+
+/**
+ * @brief Tiempo maximo de CAN_transfer() por tick [us].
+ */
+#ifndef CAN_TRANSFER_PRESUPUESTO_US
+#define CAN_TRANSFER_PRESUPUESTO_US	300U
+#endif
+
 /**
  * @brief Tipo de funcion callback.
  */
@@ -31,6 +46,7 @@ typedef enum
 	ERROR_CAN_ALREADY_SUBSCRIBED,
 	ERROR_CAN_NO_EVENT_TX,
 	ERROR_CAN_NO_EVENT_RX,
+	ERROR_CAN_PENDING,
 } Error_Can_t;
 
 /**
@@ -39,12 +55,16 @@ typedef enum
 extern void CAN_init(void);
 /**
  * @brief Envia informacion al buffer de transmision.
+ *
+ * Los mensajes salen al bus en el mismo orden en que se cargan.
  * @param[in] *dato Puntero al dato de tipo can_frame.
  * @return Indica si el dato pudo ser cargado en la cola de datos.
  */
 extern Error_Can_t CAN_sendMsg(struct can_frame *dato);
 /**
  * @brief Recive la informacion desde la cola de datos del propio nodo.
+ *
+ * Devuelve el mensaje mas viejo de la subscripcion.
  * @param[out] *dato Puntero al dato donde cargar la informacion.
  * @param[in] nodeId Id del nodo que se quiere leer.
  * @param[in] taskHandle Indentifica el nodo del que viene.
@@ -55,6 +75,7 @@ extern Error_Can_t CAN_readMsg(struct can_frame *dato, canid_t nodeId, canid_t s
  * @param[in] nodeId Id del nodo al que se subscribe.
  * @param[in] subscriberId Id del nodo que se subscribe.
  * @param[in] callback Funcion de callback cuando se genera el evento.
+ * @return ERROR_CAN_MEMORY si ya hay CAN_MAX_SUBS subscripciones.
  */
 extern Error_Can_t CAN_Subscribe(canid_t nodeId,  canid_t subscriberId, can_callback_t callback);
 /**
@@ -77,6 +98,34 @@ extern Error_Can_t CAN_eventTx(void);
  * siempre y cuando las funciones de callback sean cortas.
  */
 extern Error_Can_t CAN_eventRx(void);
+/**
+ * @brief Procesa todos los eventos pendientes dentro de un presupuesto.
+ *
+ * Transmite hasta que los 3 buffers del modulo queden ocupados o la cola
+ * quede vacia, y despues notifica todos los mensajes recibidos. Lo que no
+ * entra en el presupuesto queda para el proximo llamado, en el mismo orden.
+ * Pensada para llamarse en cada tick del systick.
+ * @param[in] presupuesto Tiempo maximo [us], menor a un periodo del
+ * systick (por ejemplo CAN_TRANSFER_PRESUPUESTO_US).
+ * @return true si no quedo nada pendiente.
+ */
+extern bool CAN_transfer(uint32_t presupuesto);
+/**
+ * @brief Atiende las interrupciones del modulo fuera del isr.
+ *
+ * Lee las banderas y los mensajes recibidos mientras la linea INT siga en
+ * bajo, hasta SERVICE_MAX_COUNT veces. Con DEFERRED_INT_ENABLE se llama
+ * despues de cada callbackInterrupt().
+ * @return ERROR_CAN_PENDING si la linea quedo en bajo y hay que volver a
+ * llamarla, ERROR_CAN_FAILRX si fallo la lectura por spi.
+ */
+extern Error_Can_t CAN_service(void);
+/**
+ * @brief Mensajes descartados por falta de lugar en las colas.
+ * @param[out] *tx Con la cola de transmision llena.
+ * @param[out] *rx Con la cola de recepcion de una subscripcion llena.
+ */
+extern void CAN_getDropped(uint32_t *tx, uint32_t *rx);
 /**
  * @brief Procesa las unidades de tiempo de can.
  */
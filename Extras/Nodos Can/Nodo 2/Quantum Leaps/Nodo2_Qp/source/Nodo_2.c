@@ -49,6 +49,7 @@
 #include "clock_config.h"
 #include "MKL46Z4.h"
 #include "fsl_debug_console.h"
+#include "dlog.h"
 
 #define CAN_NODO_2_ID	20
 
@@ -144,20 +145,15 @@ extern void Nodo2_writeToBus(void)
 
 	if (estado == ERROR_CAN_OK)
 	{
-		PRINTF("\n\rMensaje enviado\n\r");
-		PRINTF("ID\tDLC\tDATA\n\r");
-		PRINTF("%d\t%d\t", canMsg1.can_id, canMsg1.can_dlc);
-
-		for (uint8_t i = 0; i < 8; i++)
-		{
-			PRINTF("%d ", canMsg1.data[i]);
-		}
-		PRINTF("\n\r");
+		DLOG(DLOG_MSG_ENVIADO, canMsg1.can_id, canMsg1.can_dlc,
+				canMsg1.data[0], canMsg1.data[1], canMsg1.data[2],
+				canMsg1.data[3], canMsg1.data[4], canMsg1.data[5],
+				canMsg1.data[6], canMsg1.data[7]);
 	}
 	else
 	{
 		if (estado == ERROR_CAN_QUEUETX_FULL)
-			PRINTF("\n\rError: buffers de transmision llenos.\n\r");
+			DLOG(DLOG_ERROR_TX_LLENOS);
 	}
 
 	return;
@@ -179,26 +175,6 @@ extern void Nodo2_serialPort(void)
 	return;
 }
 //---------------------------------------------------------------------------------------
-extern void Nodo2_xtransfer(void)
-{
-	/*
-	 * Si el spi es lento esto puede demorar por lo que se recomienda
-	 * quitar CAN_eventTx de la rutina del systick. Se esta utilizando
-	 * solo para prueba.
-	 *
-	 * En entorno de depuracion ambas funciones generan una señal de error
-	 * si no hay eventos disponibles por lo que pueden utilizarse para verificar.
-	 * En este caso no vamos a utilizarlas.
-	 */
-	if (CAN_getTimer())
-	{
-		CAN_eventTx();
-		CAN_eventRx();
-	}
-
-	return;
-}
-//---------------------------------------------------------------------------------------
 extern void callbackTimeout(void)
 {
 	// Acciones si sucede esto
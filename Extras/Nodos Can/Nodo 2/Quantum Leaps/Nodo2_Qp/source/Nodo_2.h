@@ -53,9 +53,5 @@ extern void Nodo2_writeToBus(void);
  * @brief Lectura del modulo can.
  */
 extern void Nodo2_serialPort(void);
-/**
- * @brief Transferencia de nodo 2.
- */
-extern void Nodo2_xtransfer(void);
 
 #endif /* NODO_2_H_ */
@@ -32,6 +32,7 @@
 #include "qpc.h"
 
 #include "fsl_debug_console.h"
+#include "dlog.h"
 
 //#include "safe_std.h" // portable "safe" <stdio.h>/<string.h> facilities
 #include <stdlib.h> // for exit()
@@ -58,6 +59,11 @@ void QF_onStartup(void) {}
 void QF_onCleanup(void) {}
 //............................................................................
 void QV_onIdle(void) { /* entered with interrupts DISABLED, see NOTE01 */
+    /* Vacia el registro diferido; con bytes pendientes no se duerme */
+    if (dlog_drain()) {
+        QF_INT_ENABLE();
+        return;
+    }
 #if defined NDEBUG
      /* Put the CPU and peripherals to the low-power mode */
     QV_CPU_SLEEP(); /* atomically go to sleep and enable interrupts */
@@ -0,0 +1,191 @@
+/**
+ * @file dlog.c
+ * @brief Registro diferido de mensajes en formato binario.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ */
+
+#include "dlog.h"
+
+#include "MKL46Z4.h"
+#include "board.h"
+#include "fsl_debug_console.h"
+#include "fsl_lpsci.h"
+
+#if (DLOG_BUFFER_SIZE & (DLOG_BUFFER_SIZE - 1))
+#error DLOG_BUFFER_SIZE debe ser una potencia de 2
+#endif
+
+#define DLOG_MASK			(DLOG_BUFFER_SIZE - 1U)
+#define DLOG_SYNC			0xA5U
+/* Sincronismo, formato, largo y checksum */
+#define DLOG_CABECERA		3U
+#define DLOG_REGISTRO_MAX	(DLOG_CABECERA + DLOG_MAX_ARGS * 5U + 1U)
+
+/* Variables */
+/**
+ * @brief Registros descartados por falta de lugar.
+ */
+static volatile uint32_t descartados = 0;
+
+#if DLOG_ENABLE
+
+static uint8_t buffer[DLOG_BUFFER_SIZE];
+/**
+ * @brief Indices libres (sin mascara) de escritura y lectura.
+ *
+ * head solo lo modifican los productores dentro de una seccion critica;
+ * tail solo lo modifica dlog_drain().
+ */
+static volatile uint32_t head = 0;
+static volatile uint32_t tail = 0;
+/**
+ * @brief Ultimo valor de descartados informado.
+ */
+static uint32_t descartadosInformados = 0;
+
+#else
+
+static const char *const formatos[DLOG_CANT_FORMATOS] =
+{
+	"dlog: %u registros descartados",
+#define DLOG_TEXTO(id, texto)	texto,
+	DLOG_FORMATOS(DLOG_TEXTO)
+#undef DLOG_TEXTO
+};
+
+#endif /* DLOG_ENABLE */
+
+/* Funciones privadas */
+#if DLOG_ENABLE
+/**
+ * @brief Codifica un valor de a 7 bits.
+ * @param[out] destino lugar donde se escribe
+ * @param[in] valor valor a codificar
+ * @return Cantidad de bytes escritos (1 a 5).
+ */
+static uint32_t dlog_codificar(uint8_t *destino, uint32_t valor);
+#endif
+
+/* Funciones */
+extern void dlog_write(DLOG_FMT_t formato, uint32_t cantidad,
+		const uint32_t *args)
+{
+	if (formato >= DLOG_CANT_FORMATOS)
+		return;
+
+	if (cantidad > DLOG_MAX_ARGS)
+		cantidad = DLOG_MAX_ARGS;
+
+#if DLOG_ENABLE
+	uint8_t registro[DLOG_REGISTRO_MAX];
+	uint32_t largo = DLOG_CABECERA;
+	uint8_t suma;
+	uint32_t primask;
+
+	/* El registro se arma fuera de la seccion critica */
+	for (uint32_t i = 0; i < cantidad; i++)
+		largo += dlog_codificar(&registro[largo], args[i]);
+
+	registro[0] = DLOG_SYNC;
+	registro[1] = (uint8_t) formato;
+	registro[2] = (uint8_t) (largo - DLOG_CABECERA);
+
+	suma = 0;
+	for (uint32_t i = 1; i < largo; i++)
+		suma += registro[i];
+	registro[largo++] = (uint8_t) ~suma;
+
+	/*
+	 * El M0+ no tiene LDREX/STREX para reservar lugar sin bloquear, asi que
+	 * la copia se hace con las interrupciones enmascaradas. Son a lo sumo
+	 * unas decenas de bytes y el consumidor nunca ve un registro a medias.
+	 * */
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	if (DLOG_BUFFER_SIZE - (head - tail) < largo)
+	{
+		descartados++;
+	}
+	else
+	{
+		uint32_t h = head;
+
+		for (uint32_t i = 0; i < largo; i++)
+			buffer[(h + i) & DLOG_MASK] = registro[i];
+
+		head = h + largo;
+	}
+
+	__set_PRIMASK(primask);
+#else
+	uint32_t a[DLOG_MAX_ARGS] = { 0 };
+
+	for (uint32_t i = 0; i < cantidad; i++)
+		a[i] = args[i];
+
+	PRINTF(formatos[formato], a[0], a[1], a[2], a[3], a[4], a[5], a[6],
+			a[7], a[8], a[9]);
+	PRINTF("\r\n");
+#endif
+
+	return;
+}
+
+extern bool dlog_drain(void)
+{
+#if DLOG_ENABLE
+	UART0_Type *uart = (UART0_Type*) BOARD_DEBUG_UART_BASEADDR;
+	uint32_t t = tail;
+	uint32_t h;
+
+	/* Informa los descartes con un registro propio, si entra */
+	if (descartados != descartadosInformados
+			&& DLOG_BUFFER_SIZE - (head - t) >= DLOG_CABECERA + 5U + 1U)
+	{
+		uint32_t cantidad = descartados - descartadosInformados;
+
+		descartadosInformados = descartados;
+		dlog_write(DLOG_PERDIDOS, 1, &cantidad);
+	}
+
+	h = head;
+	__DMB();
+
+	while (t != h && (LPSCI_GetStatusFlags(uart) & kLPSCI_TxDataRegEmptyFlag))
+	{
+		LPSCI_WriteByte(uart, buffer[t & DLOG_MASK]);
+		t++;
+	}
+
+	/* Los bytes ya se leyeron antes de liberar el lugar */
+	__DMB();
+	tail = t;
+
+	return t != h;
+#else
+	return false;
+#endif
+}
+
+extern uint32_t dlog_getDropped(void)
+{
+	return descartados;
+}
+
+#if DLOG_ENABLE
+static uint32_t dlog_codificar(uint8_t *destino, uint32_t valor)
+{
+	uint32_t n = 0;
+
+	while (valor >= 0x80U)
+	{
+		destino[n++] = (uint8_t) (valor | 0x80U);
+		valor >>= 7;
+	}
+	destino[n++] = (uint8_t) valor;
+
+	return n;
+}
+#endif
@@ -43,6 +43,7 @@
 #include "can.h"
 
 #include "Nodo_2.h"
+#include "can_ao.h"
 
 enum BlinkySignals {
     SERIE_SIG = Q_USER_SIG,
@@ -105,6 +106,9 @@ int main() {
     QF_init(); // initialize the framework
     QF_poolInit(poolSto, sizeof(poolSto), sizeof(SerieEvt));
 
+    /* Objeto activo de can, antes de que Nodo2_init() habilite su interrupcion. */
+    CanAo_start();
+
     Blinky_ctor(&Blinky_inst); // explicitly call the "constructor"
     static QEvt const *blinky_queueSto[10];
     QACTIVE_START(AO_Blinky,
@@ -117,8 +121,6 @@ int main() {
 //..........................................................................
 void SysTick_Handler(void) {
     QTIMEEVT_TICK_X(0U, &l_SysTick_Handler); // time events at rate 0
-
-    Nodo2_xtransfer();
 }
 
 //================ ask QM to define the Blinky class ================
@@ -177,6 +177,18 @@ status_t DbgConsole_TryGetchar(char *ch)
 
     return kStatus_Fail;
 }
+
+/* See fsl_debug_console.h for documentation of this function. */
+uint32_t DbgConsole_GetDroppedBytes(void)
+{
+    return LOG_GetDroppedBytes();
+}
+
+/* See fsl_debug_console.h for documentation of this function. */
+uint32_t DbgConsole_GetHighWater(void)
+{
+    return LOG_GetHighWater();
+}
 #endif
 
 /* See fsl_debug_console.h for documentation of this function. */
@@ -192,6 +192,20 @@ status_t DbgConsole_Flush(void);
  * @return Indicates get char was successful or not.
  */
 status_t DbgConsole_TryGetchar(char *ch);
+
+/*!
+ * @brief Debug console dropped bytes
+ * PRINTF does not wait when the transmit buffer is full, the log is discarded instead.
+ * @return Returns the number of bytes discarded since init.
+ */
+uint32_t DbgConsole_GetDroppedBytes(void);
+
+/*!
+ * @brief Debug console buffer high water mark
+ * Use it to size DEBUG_CONSOLE_TRANSMIT_BUFFER_LEN.
+ * @return Returns the maximum number of bytes waiting to be sent since init.
+ */
+uint32_t DbgConsole_GetHighWater(void);
 #endif
 
 #endif /* SDK_DEBUGCONSOLE */
@@ -125,6 +125,20 @@ status_t LOG_WaitIdle(void);
  * @return Indicates try getchar was successful or not.
  */
 status_t LOG_TryReadCharacter(uint8_t *ch);
+
+/*!
+ * @brief log dropped bytes
+ * Call this function to get the number of bytes discarded because the buffer was full.
+ * @return dropped bytes since init.
+ */
+uint32_t LOG_GetDroppedBytes(void);
+
+/*!
+ * @brief log buffer high water mark
+ * Call this function to get the maximum number of bytes waiting in the buffer.
+ * @return maximum buffer usage since init.
+ */
+uint32_t LOG_GetHighWater(void);
 #endif
 
 /*!
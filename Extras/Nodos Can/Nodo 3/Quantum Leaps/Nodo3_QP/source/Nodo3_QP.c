@@ -147,17 +147,6 @@ extern void callbackTimeout(void)
 	return;
 }
 //.......................................................................................
-extern void Nodo3_xtransfer(void)
-{
-	if (CAN_getTimer())
-	{
-		CAN_eventTx();
-		CAN_eventRx();
-	}
-
-	return;
-}
-//.......................................................................................
 static void Callback_Nodo1(canid_t SubcriberId, canid_t nodeId)
 {
 	CAN_readMsg(&canMsgRead, nodeId, SubcriberId);
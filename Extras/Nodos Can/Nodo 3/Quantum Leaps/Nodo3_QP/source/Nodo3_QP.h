@@ -40,9 +40,5 @@ extern void Nodo3_reset_can(void);
  * @brief Salida serie del nodo 3.
  */
 extern void Nodo3_salidaSerie(void);
-/**
- * @brief Transferencia de datos tx y rx.
- */
-extern void Nodo3_xtransfer(void);
 
 #endif /* INCLUDES_NODO3_QP_H_ */
@@ -31,6 +31,7 @@
 // Board Support Package implementation for desktop OS (Windows, Linux, MacOS)
 #include "qpc.h"    // QP/C real-time embedded framework
 #include "bsp.h"    // Board Support Package interface
+#include "can_ao.h" // Objeto activo del modulo can
 #include <stdio.h>  // for printf()/fprintf()
 #include <stdlib.h> // for exit()
 
@@ -78,6 +79,8 @@ void BSP_start(void) {
         Q_DIM(Nodo3QueueSto),       // queue length [events]
         (void *)0, 0U,               // no stack storage
         (void *)0);                  // no initialization param
+
+    CanAo_start();
 }
 //............................................................................
 void BSP_ledOff(void) {
@@ -0,0 +1,199 @@
+/**
+ * @file can_ao.c
+ * @brief Objeto activo que atiende el modulo can.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ */
+
+#include "can_ao.h"
+
+#include <stdbool.h>
+
+#include "CanApi.h"
+
+#if !DEFERRED_INT_ENABLE
+#error can_ao requiere DEFERRED_INT_ENABLE en 1
+#endif
+
+/**
+ * @brief Senales propias, solo las recibe este objeto activo.
+ */
+enum CanAoSignals
+{
+	CAN_AO_INT_SIG = Q_USER_SIG,
+	CAN_AO_TIEMPO_SIG,
+};
+
+/**
+ * @brief Objeto activo.
+ */
+typedef struct
+{
+	QActive super;
+	/**
+	 * @brief Proxima transferencia.
+	 */
+	QTimeEvt tiempo;
+} CanAo;
+
+/* Variables */
+static CanAo CanAo_inst;
+
+QActive * const AO_Can = &CanAo_inst.super;
+
+/**
+ * @brief Evento de la interrupcion, estatico para postearlo desde el isr.
+ */
+static QEvt const evtInterrupcion = QEVT_INITIALIZER(CAN_AO_INT_SIG);
+
+/**
+ * @brief Hay un evento de interrupcion en la cola.
+ */
+static volatile bool intPendiente = false;
+
+/**
+ * @brief El objeto activo ya puede recibir eventos.
+ */
+static volatile bool activo = false;
+
+/**
+ * @brief Eventos de interrupcion posteados seguidos sin que el modulo
+ * libere la linea.
+ */
+static uint8_t seguidas = 0;
+
+/**
+ * @brief La atencion del modulo quedo para el evento de tiempo.
+ */
+static bool enEspera = false;
+
+/* Funciones privadas */
+static QState CanAo_initial(CanAo * const me, void const * const par);
+static QState CanAo_activo(CanAo * const me, QEvt const * const e);
+/**
+ * @brief Atiende el modulo y, si la linea sigue en bajo, se vuelve a
+ * postear el evento para no retener el lazo. Despues de
+ * CAN_AO_MAX_SEGUIDAS intentos sin exito se reintenta una vez por tick.
+ */
+static void canAo_atender(CanAo * const me);
+
+/* Funciones */
+extern void CanAo_start(void)
+{
+	static QEvt const *colaSto[4];
+
+	QActive_ctor(&CanAo_inst.super, Q_STATE_CAST(&CanAo_initial));
+	QTimeEvt_ctorX(&CanAo_inst.tiempo, &CanAo_inst.super, CAN_AO_TIEMPO_SIG,
+			0U);
+
+	QACTIVE_START(AO_Can,
+			CAN_AO_PRIORIDAD,
+			colaSto, Q_DIM(colaSto),
+			(void *)0, 0U,
+			(void *)0);
+
+	return;
+}
+
+extern void callbackInterrupt(void)
+{
+	// Antes de iniciar el flanco se atiende en la transicion inicial
+	if (!activo || intPendiente)
+		return;
+
+	intPendiente = true;
+	QACTIVE_POST(AO_Can, &evtInterrupcion, (void *)0);
+
+	return;
+}
+
+static QState CanAo_initial(CanAo * const me, void const * const par)
+{
+	(void)par;
+
+	/*
+	 * El evento de tiempo no es periodico: se rearma al procesarlo, asi
+	 * nunca hay mas de uno en la cola aunque otro objeto activo retenga
+	 * el lazo varios ticks.
+	 */
+	QTimeEvt_armX(&me->tiempo, CAN_AO_PERIODO, 0U);
+
+	activo = true;
+
+	// Un flanco anterior a este punto no genero evento
+	canAo_atender(me);
+
+	return Q_TRAN(&CanAo_activo);
+}
+
+static QState CanAo_activo(CanAo * const me, QEvt const * const e)
+{
+	QState status_;
+
+	switch (e->sig)
+	{
+		case CAN_AO_INT_SIG:
+		{
+			canAo_atender(me);
+
+			// Notifica lo recibido sin esperar al proximo tick
+			CAN_transfer(CAN_TRANSFER_PRESUPUESTO_US);
+			status_ = Q_HANDLED();
+			break;
+		}
+		case CAN_AO_TIEMPO_SIG:
+		{
+			QTimeEvt_armX(&me->tiempo, CAN_AO_PERIODO, 0U);
+
+			// Timeout de recepcion
+			CAN_getTimer();
+
+			if (enEspera)
+				canAo_atender(me);
+
+			CAN_transfer(CAN_TRANSFER_PRESUPUESTO_US);
+			status_ = Q_HANDLED();
+			break;
+		}
+		default:
+		{
+			status_ = Q_SUPER(&QHsm_top);
+			break;
+		}
+	}
+
+	return status_;
+}
+
+static void canAo_atender(CanAo * const me)
+{
+	// Se baja antes de leer: un flanco durante la lectura postea otro
+	intPendiente = false;
+
+	if (CAN_service() == ERROR_CAN_OK)
+	{
+		seguidas = 0;
+		enEspera = false;
+	}
+	else if (seguidas < CAN_AO_MAX_SEGUIDAS)
+	{
+		seguidas++;
+
+		if (!intPendiente)
+		{
+			intPendiente = true;
+			QACTIVE_POST(&me->super, &evtInterrupcion, me);
+		}
+	}
+	else
+	{
+		/*
+		 * Con el spi fallando o la linea trabada no se postea mas: se
+		 * reintenta en cada tick y, si no se recupera, el timeout de
+		 * recepcion avisa a la aplicacion para que reinicie el modulo.
+		 */
+		enEspera = true;
+	}
+
+	return;
+}
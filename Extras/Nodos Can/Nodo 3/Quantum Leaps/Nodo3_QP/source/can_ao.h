@@ -0,0 +1,57 @@
+/**
+ * @file can_ao.h
+ * @brief Objeto activo que atiende el modulo can.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ *
+ * @details Todo el trabajo con el mcp2515 por spi se hace en este objeto
+ * activo, dentro del lazo de QV, y no en las interrupciones:
+ * - La interrupcion del puerto A (linea INT del modulo) solo postea un
+ *   evento estatico; al procesarlo se leen las banderas y los mensajes
+ *   recibidos con CAN_service().
+ * - Un evento de tiempo cuenta el timeout de recepcion (CAN_getTimer()) y
+ *   transmite y notifica lo pendiente con CAN_transfer().
+ *
+ * Asi el systick y el puerto A quedan cortos y la latencia del resto de
+ * las interrupciones no depende del spi. Los callbacks de las
+ * subscripciones y el del timeout tambien se ejecutan en este objeto
+ * activo, por lo que pueden postear eventos o usar la api.
+ *
+ * Requiere DEFERRED_INT_ENABLE en 1 en CanApi.h.
+ */
+
+#ifndef CAN_AO_H_
+#define CAN_AO_H_
+
+#include "qpc.h"
+
+/**
+ * @brief Prioridad de QP, por encima de los objetos de la aplicacion.
+ */
+#define CAN_AO_PRIORIDAD	2U
+
+/**
+ * @brief Ticks entre transferencias.
+ */
+#define CAN_AO_PERIODO		1U
+
+/**
+ * @brief Eventos de interrupcion seguidos antes de pasar a atender el
+ * modulo solo con el tick.
+ */
+#define CAN_AO_MAX_SEGUIDAS	4U
+
+/**
+ * @brief Objeto activo del modulo can.
+ */
+extern QActive * const AO_Can;
+
+/**
+ * @brief Construye e inicia el objeto activo.
+ *
+ * Se llama despues de QF_init() y antes de QF_run(). Si el modulo ya
+ * estaba inicializado atiende lo que haya quedado pendiente.
+ */
+extern void CanAo_start(void);
+
+#endif /* CAN_AO_H_ */
@@ -31,6 +31,7 @@
 #include "qpc.h"                 // QP/C real-time embedded framework
 #include "bsp.h"                 // Board Support Package
 #include "Nodo3_QP.h"            // Archivo del nodo 3
+#include "prof.h"                // Perfilado con el systick
 
 #include <stdio.h>
 #include "board.h"
@@ -59,6 +60,7 @@ int main() {
     Nodo3_reset_can();
 
     SysTick_Config(CLOCK_GetCoreSysClkFreq() / 1000U);
+    prof_init();
 
     QF_init();       // initialize the framework and the underlying RT kernel
     BSP_init();      // initialize the BSP
@@ -68,9 +70,9 @@ int main() {
 //............................................................................
 void SysTick_Handler(void)
 {
-    QF_TICK_X(0U, (void *)0); // QF clock tick processing for rate 0
+    PROF_TICK();
 
-    Nodo3_xtransfer();
+    QF_TICK_X(0U, (void *)0); // QF clock tick processing for rate 0
 
     return;
 }
@@ -13,6 +13,7 @@
 
 #include "mcp2515.h"
 #include "spi.h"
+#include "prof.h"
 #include "fsl_gpio.h"
 #include "pin_mux.h"
 #include "fsl_port.h"
@@ -1809,10 +1810,15 @@ extern ERROR_t mcp2515_sendMessageWithBufferId(const TXBn txbn,
 
 extern ERROR_t mcp2515_sendMessage(const struct can_frame *frame)
 {
+	ERROR_t error;
+
+	PROF_BEGIN(PROF_MCP2515_SEND);
+
 	/* Verifica que no supera la cantidad maxima de bytes */
 	if (frame->can_dlc > CAN_MAX_DLEN)
 	{
-		return ERROR_FAILTX;
+		error = ERROR_FAILTX;
+		goto fin;
 	}
 
 	/* Verificamos que exista lugar disponible en algun buffer (0,1,2) */
@@ -1825,18 +1831,24 @@ extern ERROR_t mcp2515_sendMessage(const struct can_frame *frame)
 
 //		readReg.reg = txbuf->CTRL;
 		readReg.reg = TxnControl[i];
-		ERROR_t error = mcp2515_readRegister(&readReg);
+		error = mcp2515_readRegister(&readReg);
 		if (error != ERROR_OK)
-			return error;
+			goto fin;
 
 		if ((readReg.data & TXB_TXREQ) == 0)
 		{
-			return mcp2515_sendMessageWithBufferId(txBuffers[i], frame);
+			error = mcp2515_sendMessageWithBufferId(txBuffers[i], frame);
+			goto fin;
 		}
 	}
 
 	/* Solo si los 3 buffers estan ocupados */
-	return ERROR_ALLTXBUSY;
+	error = ERROR_ALLTXBUSY;
+
+fin:
+	PROF_END(PROF_MCP2515_SEND);
+
+	return error;
 }
 
 extern ERROR_t mcp2515_readMessageWithBufferId(const RXBn rxbn,
@@ -1927,6 +1939,9 @@ extern ERROR_t mcp2515_readMessageWithBufferId(const RXBn rxbn,
 extern ERROR_t mcp2515_readMessage(struct can_frame *frame)
 {
 	ERROR_t error;
+
+	PROF_BEGIN(PROF_MCP2515_READ);
+
 	uint8_t stat = mcp2515_getStatus();
 
 	if (stat & STAT_RX0IF)
@@ -1942,6 +1957,8 @@ extern ERROR_t mcp2515_readMessage(struct can_frame *frame)
 		error = ERROR_NOMSG;
 	}
 
+	PROF_END(PROF_MCP2515_READ);
+
 	return error;
 }
 
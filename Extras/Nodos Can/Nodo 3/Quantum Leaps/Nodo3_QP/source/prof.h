@@ -0,0 +1,119 @@
+/**
+ * @file prof.h
+ * @brief Medicion de tiempos de ejecucion con el systick.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ *
+ * @details El Cortex-M0+ de la KL46Z no tiene contador de ciclos (DWT),
+ * por lo que se toma el valor de SysTick->VAL junto con una cuenta de
+ * ticks propia para obtener una marca de tiempo en ciclos de reloj.
+ * Cada region medida guarda la cantidad de llamadas y los ciclos
+ * minimos, maximos y totales en una tabla estatica.
+ *
+ * Para usarlo se debe llamar a prof_tick() desde la interrupcion del
+ * systick y encerrar la region con
+ * PROF_BEGIN()/PROF_END() dentro de la misma funcion.
+ *
+ * @note En release (NDEBUG) los macros no generan codigo.
+ */
+
+#ifndef PROF_H_
+#define PROF_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Habilitacion del perfilado.
+ *
+ * Por defecto queda habilitado en debug y deshabilitado en release.
+ */
+#ifndef PROF_ENABLE
+#if defined(NDEBUG)
+#define PROF_ENABLE 0
+#else
+#define PROF_ENABLE 1
+#endif
+#endif
+
+/**
+ * @brief Regiones de codigo medidas.
+ */
+typedef enum
+{
+	PROF_MCP2515_SEND = 0,
+	PROF_MCP2515_READ,
+	PROF_CAN_INTERRUPT,
+	PROF_QV_DISPATCH,
+	PROF_CANT_REGIONES,
+} PROF_REGION_t;
+
+/**
+ * @brief Resultados de una region.
+ */
+typedef struct
+{
+	/** @brief Cantidad de mediciones. */
+	uint32_t cuenta;
+	/** @brief Ciclos minimos. */
+	uint32_t min;
+	/** @brief Ciclos maximos. */
+	uint32_t max;
+	/** @brief Suma de ciclos, para calcular la media. */
+	uint64_t total;
+} PROF_Region_t;
+
+#if PROF_ENABLE
+
+/**
+ * @brief Inicializa la tabla y mide el costo de la propia medicion.
+ */
+extern void prof_init(void);
+/**
+ * @brief Cuenta un tick del systick.
+ *
+ * Debe llamarse una vez por interrupcion del systick.
+ */
+extern void prof_tick(void);
+/**
+ * @brief Marca de tiempo en ciclos de reloj.
+ * @return Ciclos transcurridos desde el arranque (con desborde).
+ */
+extern uint32_t prof_now(void);
+/**
+ * @brief Acumula una medicion sobre una region.
+ * @param[in] region region medida
+ * @param[in] inicio marca de tiempo tomada con prof_now()
+ */
+extern void prof_record(PROF_REGION_t region, uint32_t inicio);
+/**
+ * @brief Copia los resultados de una region.
+ * @param[in] region region a consultar
+ * @param[out] resultado lugar donde se cargan los datos
+ */
+extern void prof_get(PROF_REGION_t region, PROF_Region_t *resultado);
+/**
+ * @brief Pone a cero la tabla.
+ */
+extern void prof_reset(void);
+/**
+ * @brief Imprime la tabla por consola.
+ */
+extern void prof_dump(void);
+
+#define PROF_TICK()				prof_tick()
+#define PROF_BEGIN(region)		uint32_t prof_inicio_##region = prof_now()
+#define PROF_END(region)		prof_record((region), prof_inicio_##region)
+
+#else
+
+#define prof_init()				((void)0)
+#define prof_reset()			((void)0)
+#define prof_dump()				((void)0)
+
+#define PROF_TICK()				((void)0)
+#define PROF_BEGIN(region)		((void)0)
+#define PROF_END(region)		((void)0)
+
+#endif /* PROF_ENABLE */
+
+#endif /* PROF_H_ */
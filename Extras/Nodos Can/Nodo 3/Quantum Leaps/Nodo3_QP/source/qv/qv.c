@@ -44,6 +44,7 @@
 #include "qp_port.h"      // QP port
 #include "qp_pkg.h"       // QP package-scope internal interface
 #include "qsafe.h"        // QP Functional Safety (FuSa) Subsystem
+#include "prof.h"         // perfilado del despacho de eventos
 #ifdef Q_SPY              // QS software tracing enabled?
     #include "qs_port.h"  // QS port
     #include "qs_pkg.h"   // QS facilities for pre-defined trace records
@@ -226,7 +227,9 @@ int_t QF_run(void) {
             // NOTE QActive_get_() performs QS_MEM_APP() before return
 
             // dispatch event (virtual call)
+            PROF_BEGIN(PROF_QV_DISPATCH);
             (*a->super.vptr->dispatch)(&a->super, e, p);
+            PROF_END(PROF_QV_DISPATCH);
     #if (QF_MAX_EPOOL > 0U)
             QF_gc(e);
     #endif
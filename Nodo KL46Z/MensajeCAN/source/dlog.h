@@ -0,0 +1,111 @@
+/**
+ * @file dlog.h
+ * @brief Registro diferido de mensajes en formato binario.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ *
+ * @details En lugar de formatear el texto en el momento (PRINTF), cada
+ * llamada a DLOG() guarda en un buffer circular un registro compacto con
+ * el numero de formato y sus argumentos. El buffer se vacia por la uart
+ * en tiempo ocioso con dlog_drain() y en la pc se expanden los registros
+ * a texto con Herramientas/dlog_expand.py, que lee la misma tabla de
+ * formatos (dlog_formatos.h).
+ *
+ * Cada registro tiene el formato:
+ * @code
+ * 0xA5 <formato> <largo> <argumentos...> <checksum>
+ * @endcode
+ * donde los argumentos van codificados de a 7 bits (el bit 7 indica que
+ * sigue otro byte), por lo que los valores chicos ocupan un solo byte, y
+ * el checksum es el complemento de la suma de los bytes desde el formato.
+ *
+ * El buffer tiene un unico consumidor (dlog_drain) y puede escribirse
+ * desde cualquier contexto, incluso interrupciones.
+ *
+ * @note Con DLOG_ENABLE en '0' los registros se imprimen en el momento con
+ * PRINTF, para poder leerlos con una terminal comun.
+ */
+
+#ifndef DLOG_H_
+#define DLOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "dlog_formatos.h"
+
+/**
+ * @brief Habilitacion del registro binario.
+ */
+#ifndef DLOG_ENABLE
+#define DLOG_ENABLE 1
+#endif
+
+/**
+ * @brief Tamaño del buffer en bytes (potencia de 2).
+ */
+#ifndef DLOG_BUFFER_SIZE
+#define DLOG_BUFFER_SIZE 512
+#endif
+
+/**
+ * @brief Cantidad maxima de argumentos por registro.
+ */
+#define DLOG_MAX_ARGS 10
+
+/**
+ * @brief Numeros de formato.
+ *
+ * DLOG_PERDIDOS lo genera el propio modulo cuando se descartan registros
+ * por falta de espacio; el resto sale de dlog_formatos.h en orden.
+ */
+typedef enum
+{
+	DLOG_PERDIDOS = 0,
+#define DLOG_ID(id, texto)	id,
+	DLOG_FORMATOS(DLOG_ID)
+#undef DLOG_ID
+	DLOG_CANT_FORMATOS,
+} DLOG_FMT_t;
+
+/**
+ * @brief Guarda un registro en el buffer.
+ *
+ * Si no hay lugar el registro se descarta y se cuenta.
+ * @param[in] formato numero de formato
+ * @param[in] cantidad cantidad de argumentos (hasta DLOG_MAX_ARGS)
+ * @param[in] args argumentos
+ */
+extern void dlog_write(DLOG_FMT_t formato, uint32_t cantidad,
+		const uint32_t *args);
+/**
+ * @brief Envia por la uart los bytes pendientes sin bloquear.
+ *
+ * Escribe solo mientras el registro de transmision este libre, por lo
+ * que debe llamarse repetidamente desde el tiempo ocioso.
+ * @return true si quedan bytes por enviar.
+ */
+extern bool dlog_drain(void);
+/**
+ * @brief Cantidad de registros descartados desde el arranque.
+ * @return Registros descartados.
+ */
+extern uint32_t dlog_getDropped(void);
+
+/**
+ * @brief Guarda un registro con sus argumentos.
+ *
+ * Los argumentos se convierten a uint32_t, por ejemplo:
+ * @code
+ * DLOG(DLOG_MSG_ENVIADO, msg.can_id, msg.can_dlc);
+ * @endcode
+ */
+#define DLOG(formato, ...)	\
+	do	\
+	{	\
+		const uint32_t dlog_args_[] = { 0, ##__VA_ARGS__ };	\
+		dlog_write((formato), sizeof(dlog_args_) / sizeof(uint32_t) - 1,	\
+				&dlog_args_[1]);	\
+	} while (0)
+
+#endif /* DLOG_H_ */
@@ -0,0 +1,24 @@
+/**
+ * @file dlog_formatos.h
+ * @brief Tabla de formatos del registro diferido.
+ * @author Zuliani, Agustin
+ * @date 19/10/26
+ *
+ * @details Cada entrada tiene el nombre del formato y el texto, con la
+ * sintaxis de printf. El numero de formato es la posicion en la tabla
+ * (empezando en 1), por lo que las entradas nuevas se agregan al final.
+ * Herramientas/dlog_expand.py lee este mismo archivo para expandir los
+ * registros.
+ *
+ * @note Los argumentos viajan como enteros de 32 bits; solo se admiten
+ * %d, %i, %u, %x, %X, %c y sus variantes de ancho.
+ */
+
+#ifndef DLOG_FORMATOS_H_
+#define DLOG_FORMATOS_H_
+
+#define DLOG_FORMATOS(X)	\
+	X(DLOG_MSG_ENVIADO,		"Mensaje enviado ID=%u DLC=%u DATA=%u %u %u %u %u %u %u %u")	\
+	X(DLOG_ERROR_ENVIO,		"Error al enviar (error %d).")
+
+#endif /* DLOG_FORMATOS_H_ */
@@ -43,6 +43,7 @@
 /* TODO: insert other include files here. */
 #include "spi.h"
 #include "mcp2515.h"
+#include "dlog.h"
 
 /* TODO: insert other definitions and declarations here. */
 //// Periodo de envio de mensajes can.
@@ -129,6 +130,8 @@ int main(void) {
 
 			canmsg_escritura();
 		}
+
+		dlog_drain();	// Envia el registro en el tiempo libre
 	}
 	return 0;
 }
@@ -147,16 +150,12 @@ static void canmsg_escritura(void) {
 	estado = mcp2515_sendMessage(&canMsg1);
 
 	if (estado == ERROR_OK) {
-		PRINTF("\nMensaje enviado\n\r");
-		PRINTF("ID\tDLC\tDATA\n\r");
-		PRINTF("%d\t%d\t", canMsg1.can_id, canMsg1.can_dlc);
-
-		for (uint8_t i = 0; i < 8; i++) {
-			PRINTF("%d ", canMsg1.data[i]);
-		}
-		PRINTF("\n\r");
+		DLOG(DLOG_MSG_ENVIADO, canMsg1.can_id, canMsg1.can_dlc,
+				canMsg1.data[0], canMsg1.data[1], canMsg1.data[2],
+				canMsg1.data[3], canMsg1.data[4], canMsg1.data[5],
+				canMsg1.data[6], canMsg1.data[7]);
 	} else {
-		PRINTF("\nError al enviar\n\r");
+		DLOG(DLOG_ERROR_ENVIO, estado);
 	}
 
 	return;
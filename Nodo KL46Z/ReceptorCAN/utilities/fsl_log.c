@@ -174,6 +174,10 @@ typedef struct _log_buffer
 #ifdef DEBUG_CONSOLE_TRANSFER_NON_BLOCKING
 /* A global log buffer */
 static log_buffer_t s_log_buffer;
+/* Bytes discarded because the buffer was full */
+static volatile uint32_t s_logDroppedBytes;
+/* Maximum buffer usage since init */
+static volatile uint16_t s_logHighWater;
 #endif /* DEBUG_CONSOLE_TRANSFER_NON_BLOCKING */
 
 /* lock definition */
@@ -272,6 +276,8 @@ status_t LOG_Init(uint32_t baseAddr, uint8_t device, uint32_t baudRate, uint32_t
 #ifdef DEBUG_CONSOLE_TRANSFER_NON_BLOCKING
     /* memset the global queue */
     memset(&s_log_buffer, 0U, sizeof(s_log_buffer));
+    s_logDroppedBytes = 0U;
+    s_logHighWater = 0U;
     /* init callback for NON-BLOCKING */
     io.callBack = LOG_Transferred;
     /* io init function */
@@ -319,12 +325,25 @@ int LOG_Push(uint8_t *buf, size_t size)
     assert(buf != NULL);
 
 #ifdef DEBUG_CONSOLE_TRANSFER_NON_BLOCKING
+    uint32_t regPrimask;
+    int result;
+
     /* push to buffer */
     LOG_BufPush(buf, size);
+    /*
+     * Start a transfer only if the TX interrupt is idle. The pop position is read in the same
+     * critical section, otherwise the interrupt could send it first and it would be sent twice.
+     */
+    regPrimask = DisableGlobalIRQ();
     buf = LOG_BufGetNextAvaliableLog(&size);
-#endif /* DEBUG_CONSOLE_TRANSFER_NON_BLOCKING */
+    result = LOG_Pop(buf, size);
+    EnableGlobalIRQ(regPrimask);
+
+    return result;
+#else
     /* pop log */
     return LOG_Pop(buf, size);
+#endif /* DEBUG_CONSOLE_TRANSFER_NON_BLOCKING */
 }
 
 int LOG_Pop(uint8_t *buf, size_t size)
@@ -470,27 +489,21 @@ static status_t LOG_EchoCharacter(uint8_t *ch, bool isGetChar, int *index)
 static int LOG_BufPush(uint8_t *buf, size_t size)
 {
     uint32_t pushIndex = 0U, i = 0U;
-    bool pushAvaliable = false;
+    uint32_t regPrimask;
 
     /* take mutex lock function */
     LOG_TAKE_MUTEX_SEMAPHORE_BLOCKING(s_logPushSemaphore);
+    /*
+     * The TX interrupt pops from the same buffer, so the log is copied before the total index is
+     * updated and both are done with interrupts masked. This also makes push safe from ISRs in
+     * bare-metal, where the mutex is empty.
+     */
+    regPrimask = DisableGlobalIRQ();
+    /* check the buffer if have enough space to store the log */
     if (size <= (DEBUG_CONSOLE_TRANSMIT_BUFFER_LEN - s_log_buffer.totalIndex))
     {
         /* get push index */
         pushIndex = s_log_buffer.pushIndex;
-        s_log_buffer.pushIndex += size;
-        /* check index overflow */
-        LOG_CHECK_BUFFER_INDEX_OVERFLOW(s_log_buffer.pushIndex);
-        /* update push/total index value */
-        s_log_buffer.totalIndex += size;
-        pushAvaliable = true;
-    }
-    /* release mutex lock function */
-    LOG_GIVE_MUTEX_SEMAPHORE(s_logPushSemaphore);
-
-    /* check the buffer if have enough space to store the log */
-    if (pushAvaliable)
-    {
         for (i = size; i > 0; i--)
         {
             /* copy log to buffer, the buffer only support a fixed length argument, if the log argument
@@ -501,11 +514,24 @@ static int LOG_BufPush(uint8_t *buf, size_t size)
             /* check index overflow */
             LOG_CHECK_BUFFER_INDEX_OVERFLOW(pushIndex);
         }
+        /* update push/total index value */
+        s_log_buffer.pushIndex = pushIndex;
+        s_log_buffer.totalIndex += size;
+        /* record the maximum usage */
+        if (s_log_buffer.totalIndex > s_logHighWater)
+        {
+            s_logHighWater = s_log_buffer.totalIndex;
+        }
     }
     else
     {
+        /* the log is dropped instead of waiting for the TX interrupt */
+        s_logDroppedBytes += size;
         size = 0U;
     }
+    EnableGlobalIRQ(regPrimask);
+    /* release mutex lock function */
+    LOG_GIVE_MUTEX_SEMAPHORE(s_logPushSemaphore);
 
     return size;
 }
@@ -559,12 +585,16 @@ static uint8_t *LOG_BufPop(size_t *size)
 static void LOG_Transferred(size_t *size, bool receive, bool transmit)
 {
     uint8_t *addr = NULL;
+    uint32_t regPrimask;
 
     if (transmit)
     {
+        /* a higher priority ISR may push while the buffer is popped */
+        regPrimask = DisableGlobalIRQ();
         addr = LOG_BufPop(size);
         /* continue pop log from buffer */
         LOG_Pop(addr, *size);
+        EnableGlobalIRQ(regPrimask);
     }
 
     if (receive)
@@ -576,6 +606,16 @@ static void LOG_Transferred(size_t *size, bool receive, bool transmit)
 #endif /* DEBUG_CONSOLE_TRANSFER_NON_BLOCKING */
 
 #ifdef DEBUG_CONSOLE_TRANSFER_NON_BLOCKING
+uint32_t LOG_GetDroppedBytes(void)
+{
+    return s_logDroppedBytes;
+}
+
+uint32_t LOG_GetHighWater(void)
+{
+    return s_logHighWater;
+}
+
 status_t LOG_TryReadCharacter(uint8_t *ch)
 {
     if (NULL != ch)